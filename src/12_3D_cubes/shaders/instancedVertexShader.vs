@@ -0,0 +1,31 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aPositionScale;   // per instance: translation, uniform scale
+layout (location = 4) in vec4 aAxisSpeed;       // per instance: rotation axis (normalized), angular speed (radians/s)
+
+out vec3 ourColor;
+out vec2 TexCoord;
+
+uniform float time;
+uniform mat4 view;
+uniform mat4 projection;
+
+// Rotation of a vector around a unit axis (Rodrigues' formula)
+vec3 rotate(vec3 v, vec3 axis, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    return v * c + cross(axis, v) * s + axis * dot(axis, v) * (1.0 - c);
+}
+
+void main()
+{
+    // model = translate * rotate(time * speed) * scale, evaluated here instead of on the CPU for each object
+    vec3 worldPos = rotate(aPos * aPositionScale.w, aAxisSpeed.xyz, time * aAxisSpeed.w) + aPositionScale.xyz;
+    gl_Position = projection * view * vec4(worldPos, 1.0f);
+    ourColor = aColor;
+    TexCoord = aTexCoord;
+}
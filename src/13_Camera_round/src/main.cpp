@@ -19,7 +19,12 @@
 #include "auxiliar.hpp"     // chronometer, fps
 #include "shader.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <random>
+#include <string>
+#include <vector>
 
 // Settings (typedef and global data section) --------------------
 
@@ -33,11 +38,20 @@ void processInput(GLFWwindow *window);
 
 void printOGLdata();
 void printFrameData(int &frameCount, int fps);
+std::vector<float> animatedInstances(unsigned count, const glm::vec3 *cubePositions);
 
 // Function definitions --------------------
 
-int main()
+// Usage: exe [--instances N]
+//      --instances N: animated-instance mode. The translation, rotation axis, angular speed and scale of each cube are
+//                     uploaded once; the vertex shader builds the model transform from the time uniform, so the CPU
+//                     cost and the data sent per frame don't depend on N. The first 10 instances are the usual cubes.
+int main(int argc, char **argv)
 {
+    unsigned numInstances = 0;
+    for(int i = 1; i < argc; ++i)
+        if(std::string(argv[i]) == "--instances" && i + 1 < argc) numInstances = (unsigned)std::stoul(argv[++i]);
+
     // glfw: initialize and configure
     if (!glfwInit())
     {
@@ -98,6 +112,9 @@ int main()
     Shader myProgram(
                 "../../../src/13_Camera_round/shaders/vertexShader.vs",
                 "../../../src/13_Camera_round/shaders/fragmentShader.fs" );
+    Shader instancedProgram(
+                "../../../src/13_Camera_round/shaders/instancedVertexShader.vs",
+                "../../../src/13_Camera_round/shaders/fragmentShader.fs" );
 
     // ----- Set up vertex data, buffers, and configure vertex attributes
     float vertices0[] = {
@@ -194,6 +211,37 @@ int main()
     glBindVertexArray(0);                       // unbind VAO (not usual)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);   // unbind EBO
 
+    // ----- Animated instances: static per-instance data (never updated), one instanced draw per frame
+    unsigned instanceVAO = 0, instanceVBO = 0;
+    if(numInstances)
+    {
+        std::vector<float> instances = animatedInstances(numInstances, cubePositions);
+
+        glGenVertexArrays(1, &instanceVAO);
+        glGenBuffers(1, &instanceVBO);
+        glBindVertexArray(instanceVAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)nullptr);                // position attribute
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));     // texture coords
+        glEnableVertexAttribArray(2);
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(float), instances.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)nullptr);                // translation, scale
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));     // axis, angular speed
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        std::cout << "Animated instances: " << numInstances << " (" << instances.size() * sizeof(float) / 1024 << " KB uploaded once)" << std::endl;
+    }
+
     // ----- Load and create a texture
     unsigned texture1, texture2;
     int width, height, numberChannels;
@@ -245,6 +293,9 @@ int main()
     myProgram.UseProgram();
     glUniform1i(glGetUniformLocation(myProgram.ID, "texture1"), 0);
     glUniform1i(glGetUniformLocation(myProgram.ID, "texture2"), 1);
+    instancedProgram.UseProgram();
+    glUniform1i(glGetUniformLocation(instancedProgram.ID, "texture1"), 0);
+    glUniform1i(glGetUniformLocation(instancedProgram.ID, "texture2"), 1);
 
     // ----- Other operations
     stdTime chron;
@@ -285,18 +336,31 @@ int main()
         projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f); // If it doesn't change each frame, it can be placed outside the render loop
         glUniformMatrix4fv(glGetUniformLocation(myProgram.ID, "projection"), 1, GL_FALSE, &projection[0][0]);
 
-        glBindVertexArray(VAO);
+        if(numInstances)
+        {
+            instancedProgram.UseProgram();
+            glUniform1f(glGetUniformLocation(instancedProgram.ID, "time"), (float)chron.GetTime());
+            glUniformMatrix4fv(glGetUniformLocation(instancedProgram.ID, "view"), 1, GL_FALSE, &view[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(instancedProgram.ID, "projection"), 1, GL_FALSE, &projection[0][0]);
 
-        for(unsigned i = 0; i < 10; i++)
+            glBindVertexArray(instanceVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6*2*3, numInstances);
+        }
+        else
         {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            model = glm::rotate(model, (float)chron.GetTime() * glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
-            model = glm::scale(model, glm::vec3(1.0, 1.0, 1.0));
-            glUniformMatrix4fv(glGetUniformLocation(myProgram.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-            glDrawArrays(GL_TRIANGLES, 0, 6*2*3);
-            //glDrawElements(GL_TRIANGLES, 3*12, GL_UNSIGNED_INT, nullptr);
+            glBindVertexArray(VAO);
+
+            for(unsigned i = 0; i < 10; i++)
+            {
+                glm::mat4 model = glm::mat4(1.0f);
+                model = glm::translate(model, cubePositions[i]);
+                model = glm::rotate(model, (float)chron.GetTime() * glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
+                model = glm::scale(model, glm::vec3(1.0, 1.0, 1.0));
+                glUniformMatrix4fv(glGetUniformLocation(myProgram.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+
+                glDrawArrays(GL_TRIANGLES, 0, 6*2*3);
+                //glDrawElements(GL_TRIANGLES, 3*12, GL_UNSIGNED_INT, nullptr);
+            }
         }
 
         // -----------------
@@ -312,8 +376,11 @@ int main()
     // ----- De-allocate all resources
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &instanceVAO);
+    glDeleteBuffers(1, &instanceVBO);
     //glDeleteBuffers(1, &EBO);
     glDeleteProgram(myProgram.ID);
+    glDeleteProgram(instancedProgram.ID);
 
     glfwTerminate();
 
@@ -356,3 +423,34 @@ void printFrameData(int &frameCount, int fps)
 
     std::cout << "FPS: " << fps << '\r';                // FPS
 }
+
+// Per-instance data for the animated-instance mode: translation + scale, rotation axis + angular speed (8 floats).
+// The first 10 instances are the usual cubes; the rest are smaller cubes spread randomly in a box that grows with count.
+std::vector<float> animatedInstances(unsigned count, const glm::vec3 *cubePositions)
+{
+    std::vector<float> data;
+    data.reserve(count * 8);
+
+    glm::vec3 cubeAxis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    float extent = std::max(5.0f, std::cbrt((float)count) * 0.75f);
+
+    for(unsigned i = 0; i < count; i++)
+    {
+        glm::vec3 position, axis = cubeAxis;
+        float scale = 1.0f, speed = glm::radians(20.0f * i);
+        if(i >= 10)
+        {
+            position = glm::vec3(unit(rng), unit(rng), unit(rng)) * extent;
+            axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+            scale = 0.25f + 0.125f * (unit(rng) + 1.0f);
+            speed = glm::radians(60.0f * unit(rng));
+        }
+        else position = cubePositions[i];
+
+        data.insert(data.end(), { position.x, position.y, position.z, scale, axis.x, axis.y, axis.z, speed });
+    }
+
+    return data;
+}
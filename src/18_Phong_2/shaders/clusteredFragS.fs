@@ -0,0 +1,84 @@
+#version 330 core
+
+// Phong lighting with many point lights (clustered forward shading, see ClusteredLights)
+
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform vec3 objectColor;
+uniform vec3 camPos;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform samplerBuffer  lightData;       // 2 texels per light: position + radius, color * intensity
+uniform usamplerBuffer clusterGrid;     // per cluster: offset, count
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterDims;              // tiles x, tiles y, depth slices
+uniform float sliceScale;               // slice = log(depth) * sliceScale + sliceBias
+uniform float sliceBias;
+uniform int   numLights;
+uniform bool  bruteForce;               // loop over every light (for comparison)
+
+// Shadows: shadows.glsl (shadowsEnabled, sunDirection, sunColor, sunVisibility()), inserted by Shader
+
+vec3 pointLight(int index, vec3 norm, vec3 viewDir)
+{
+    vec4 posRadius = texelFetch(lightData, 2 * index);
+    vec3 color = texelFetch(lightData, 2 * index + 1).rgb;
+
+    vec3 toLight = posRadius.xyz - FragPos;
+    float dist = length(toLight);
+    if(dist >= posRadius.w) return vec3(0.0);
+
+    // Smooth window so the light reaches exactly 0 at its radius
+    float ratio = dist / posRadius.w;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / (1.0 + dist * dist);
+
+    vec3 lightDir = toLight / dist;
+    float diff = max(dot(norm, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), 32);
+
+    return (diff + 0.5 * spec) * attenuation * color;
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(camPos - FragPos);
+    vec3 color = vec3(0.1);                 // ambient
+
+    if(bruteForce)
+    {
+        for(int i = 0; i < numLights; ++i)
+            color += pointLight(i, norm, viewDir);
+    }
+    else
+    {
+        // Cluster of this fragment
+        vec4 viewPos = view * vec4(FragPos, 1.0);
+        vec4 clip = projection * viewPos;
+        vec2 ndc = clip.xy / clip.w;
+
+        ivec2 tile = clamp(ivec2((ndc * 0.5 + 0.5) * vec2(clusterDims.xy)), ivec2(0), clusterDims.xy - 1);
+        int slice = clamp(int(log(-viewPos.z) * sliceScale + sliceBias), 0, clusterDims.z - 1);
+        int cluster = (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+
+        uvec2 range = texelFetch(clusterGrid, cluster).rg;
+        for(uint i = 0u; i < range.y; ++i)
+            color += pointLight(int(texelFetch(lightIndices, int(range.x + i)).r), norm, viewDir);
+    }
+
+    if(shadowsEnabled)
+    {
+        vec3 sunDir = -normalize(sunDirection);
+        float sunDiffuse = max(dot(norm, sunDir), 0.0);
+        float sunSpecular = 0.5 * pow(max(dot(viewDir, reflect(-sunDir, norm)), 0.0), 32);
+        float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+        color += (sunDiffuse + sunSpecular) * sunColor * sunVisibility(FragPos, viewDepth);
+    }
+
+    FragColor = vec4(color * objectColor, 1.0f);
+}
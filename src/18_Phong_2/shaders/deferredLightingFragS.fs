@@ -0,0 +1,111 @@
+#version 330 core
+
+// Lighting pass of the deferred renderer: one Phong light (as lightingFragS.fs) or the point lights of the pixel's
+// cluster (as clusteredFragS.fs)
+
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormalShininess;
+uniform sampler2D gDepth;
+
+uniform mat4 invView;
+uniform mat4 invProjection;
+uniform vec3 camPos;
+
+uniform vec3 lightPos;
+uniform vec3 lightColor;
+uniform bool useClusters;
+
+uniform samplerBuffer  lightData;       // see ClusteredLights
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterDims;
+uniform float sliceScale;
+uniform float sliceBias;
+
+// Shadows: shadows.glsl (shadowsEnabled, sunDirection, sunColor, sunVisibility()), inserted by Shader
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+vec3 pointLight(int index, vec3 fragPos, vec3 norm, vec3 viewDir, float specularStrength, float shininess)
+{
+    vec4 posRadius = texelFetch(lightData, 2 * index);
+    vec3 color = texelFetch(lightData, 2 * index + 1).rgb;
+
+    vec3 toLight = posRadius.xyz - fragPos;
+    float dist = length(toLight);
+    if(dist >= posRadius.w) return vec3(0.0);
+
+    float ratio = dist / posRadius.w;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / (1.0 + dist * dist);
+
+    vec3 lightDir = toLight / dist;
+    float diff = max(dot(norm, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), shininess);
+
+    return (diff + specularStrength * spec) * attenuation * color;
+}
+
+void main()
+{
+    float depth = texture(gDepth, TexCoord).r;
+    if(depth == 1.0) discard;                       // background
+
+    vec4 albedoSpecular = texture(gAlbedoSpecular, TexCoord);
+    vec4 normalShininess = texture(gNormalShininess, TexCoord);
+    vec3 albedo = albedoSpecular.rgb;
+    float specularStrength = albedoSpecular.a;
+    float shininess = normalShininess.b * 256.0;
+    vec3 norm = octDecode(normalShininess.rg * 2.0 - 1.0);
+
+    // Position from depth
+    vec4 viewPos = invProjection * vec4(vec3(TexCoord, depth) * 2.0 - 1.0, 1.0);
+    viewPos /= viewPos.w;
+    vec3 fragPos = vec3(invView * viewPos);
+    vec3 viewDir = normalize(camPos - fragPos);
+
+    vec3 color;
+    if(useClusters)
+    {
+        color = vec3(0.1);                          // ambient
+
+        ivec2 tile = clamp(ivec2(TexCoord * vec2(clusterDims.xy)), ivec2(0), clusterDims.xy - 1);
+        int slice = clamp(int(log(-viewPos.z) * sliceScale + sliceBias), 0, clusterDims.z - 1);
+        int cluster = (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+
+        uvec2 range = texelFetch(clusterGrid, cluster).rg;
+        for(uint i = 0u; i < range.y; ++i)
+            color += pointLight(int(texelFetch(lightIndices, int(range.x + i)).r), fragPos, norm, viewDir, specularStrength, shininess);
+    }
+    else
+    {
+        vec3 ambient = 0.1 * lightColor;
+
+        vec3 lightDir = normalize(lightPos - fragPos);
+        vec3 diffuse = max(dot(norm, lightDir), 0.0) * lightColor;
+
+        float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), shininess);
+        vec3 specular = specularStrength * spec * lightColor;
+
+        color = ambient + diffuse + specular;
+    }
+
+    if(shadowsEnabled)
+    {
+        vec3 sunDir = -normalize(sunDirection);
+        float sunDiffuse = max(dot(norm, sunDir), 0.0);
+        float sunSpecular = specularStrength * pow(max(dot(viewDir, reflect(-sunDir, norm)), 0.0), shininess);
+        color += (sunDiffuse + sunSpecular) * sunColor * sunVisibility(fragPos, -viewPos.z);
+    }
+
+    FragColor = vec4(color * albedo, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+// Depth pre-pass: position-only vertex stream, no fragment shader. gl_Position must match vertexShader.vs bit for bit
+// (the shading pass tests depth with GL_EQUAL), hence the same expression and "invariant" in both shaders.
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+// Depth pre-pass for PackedVertices (position-only stream): decodePosition() is generated by PackedVertices::shaderPrelude().
+// gl_Position must match vertexShaderPacked.vs bit for bit (see depthPrepass.vs).
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+invariant gl_Position;
+
+void main()
+{
+    vec3 pos = decodePosition();
+
+    gl_Position = projection * view * model * vec4(pos, 1.0f);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+
+// Geometry pass of the deferred renderer: material and normal to the G-buffer (see DeferredRenderer)
+
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormalShininess;
+
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform vec3  objectColor;
+uniform float specularStrength = 0.5;
+uniform float shininess = 32.0;
+
+// Octahedral encoding: unit vector -> [-1, 1]^2
+vec2 octEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if(n.z < 0.0) e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e;
+}
+
+void main()
+{
+    gAlbedoSpecular  = vec4(objectColor, specularStrength);
+    gNormalShininess = vec4(octEncode(normalize(Normal)) * 0.5 + 0.5, shininess / 256.0, 0.0);
+}
@@ -0,0 +1,106 @@
+#version 430 core
+
+// Frustum and Hi-Z occlusion culling of every object of a GpuScene. Each invocation writes the draw command of one object
+// (instanceCount 0 if culled), so the commands keep the object order and baseInstance is the object index.
+
+layout (local_size_x = 64) in;
+
+struct Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+    vec4 color;
+    vec4 sphere;            // world space center, radius
+    uint mesh;
+};
+
+struct Mesh
+{
+    uint  indexCount;
+    uint  firstIndex;
+    int   baseVertex;
+    float radius;
+};
+
+struct DrawCommand          // DrawElementsIndirectCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Objects  { Object objects[]; };
+layout (std430, binding = 1) readonly buffer Meshes   { Mesh meshes[]; };
+layout (std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };
+layout (std430, binding = 3) buffer Counters           { uint visibleCount, frustumCulled, occlusionCulled; };
+
+uniform vec4 frustum[6];    // inward normal, distance
+uniform uint numObjects;
+
+// Occlusion against the previous frame's depth (see HiZBuffer)
+uniform bool      occlusionCulling;
+uniform sampler2D hiZ;
+uniform mat4      hiZViewProjection;
+uniform vec2      hiZSize;
+uniform int       hiZLevels;
+
+// Bounding box (of the bounding sphere) behind the depth already drawn there?
+bool occluded(vec4 sphere)
+{
+    vec3 boxMin = vec3(1.0), boxMax = vec3(0.0);        // window coordinates
+    for(int i = 0; i < 8; ++i)
+    {
+        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = hiZViewProjection * vec4(corner, 1.0);
+        if(clip.w <= 0.0) return false;                 // crosses the camera plane
+        vec3 window = clip.xyz / clip.w * 0.5 + 0.5;
+        boxMin = min(boxMin, window);
+        boxMax = max(boxMax, window);
+    }
+
+    // Pixels covered, and the level where they are at most 2x2 texels
+    ivec2 first = ivec2(clamp(boxMin.xy, 0.0, 1.0) * hiZSize);
+    ivec2 last  = min(ivec2(clamp(boxMax.xy, 0.0, 1.0) * hiZSize), ivec2(hiZSize) - 1);
+    int size = max(last.x - first.x, last.y - first.y) + 1;
+    int level = min(int(ceil(log2(float(size)))), hiZLevels - 1);
+
+    ivec2 levelSize = max(ivec2(hiZSize) >> level, ivec2(1));
+    first = min(first >> level, levelSize - 1);
+    last  = min(last >> level, levelSize - 1);
+
+    float farthest = 0.0;
+    for(int y = first.y; y <= last.y; ++y)
+        for(int x = first.x; x <= last.x; ++x)
+            farthest = max(farthest, texelFetch(hiZ, ivec2(x, y), level).r);
+
+    return boxMin.z > farthest;
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if(i >= numObjects) return;
+
+    vec4 sphere = objects[i].sphere;
+    bool visible = true;
+    for(int p = 0; p < 6; ++p)
+        visible = visible && dot(frustum[p].xyz, sphere.xyz) + frustum[p].w >= -sphere.w;
+
+    if(!visible) atomicAdd(frustumCulled, 1u);
+    else if(occlusionCulling && occluded(sphere))
+    {
+        visible = false;
+        atomicAdd(occlusionCulled, 1u);
+    }
+
+    Mesh mesh = meshes[objects[i].mesh];
+    commands[i].count         = mesh.indexCount;
+    commands[i].instanceCount = visible ? 1u : 0u;
+    commands[i].firstIndex    = mesh.firstIndex;
+    commands[i].baseVertex    = mesh.baseVertex;
+    commands[i].baseInstance  = i;
+
+    if(visible) atomicAdd(visibleCount, 1u);
+}
@@ -0,0 +1,32 @@
+#version 430 core
+
+// Phong lighting (as lightingFragS.fs) with the color of the object coming from gpuDrivenVS.vs
+
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+flat in vec3 ObjectColor;
+
+uniform vec3 lightColor;
+uniform vec3 lightPos;
+uniform vec3 camPos;
+
+void main()
+{
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor;
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor;
+
+    float specularStrength = 0.5;
+    vec3 viewDir = normalize(camPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * lightColor;
+
+    FragColor = vec4((ambient + diffuse + specular) * ObjectColor, 1.0);
+}
@@ -0,0 +1,36 @@
+#version 430 core
+
+// Vertex shader of GpuScene: the per object data is read from the objects buffer (see gpuCull.cs)
+
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec3 aNormal;
+layout (location = 4) in uint aObject;      // instanced attribute: baseInstance of the draw command
+
+struct Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+    vec4 color;
+    vec4 sphere;
+    uint mesh;
+};
+
+layout (std430, binding = 0) readonly buffer Objects { Object objects[]; };
+
+out vec3 FragPos;
+out vec3 Normal;
+flat out vec3 ObjectColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    mat4 model = objects[aObject].model;
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(objects[aObject].normalMatrix) * aNormal;
+    ObjectColor = objects[aObject].color.rgb;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 430 core
+
+// One level of the Hi-Z pyramid (see HiZBuffer). Each texel keeps the farthest depth of the texels it covers: 2x2 of the
+// previous level, plus the extra row/column when the previous level has an odd size.
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D depth;                                // level 0: depth buffer copy
+layout (r32f, binding = 0) readonly  uniform image2D src;      // previous level
+layout (r32f, binding = 1) writeonly uniform image2D dst;
+uniform int level;
+
+void main()
+{
+    ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 dstSize = imageSize(dst);
+    if(any(greaterThanEqual(pos, dstSize))) return;
+
+    float farthest;
+    if(level == 0)
+        farthest = texelFetch(depth, pos, 0).r;
+    else
+    {
+        ivec2 srcSize = imageSize(src);
+        ivec2 first = pos * 2;
+        ivec2 last = min(first + 1 + ivec2(equal(pos, dstSize - 1)) * (srcSize & 1), srcSize - 1);
+
+        farthest = 0.0;
+        for(int y = first.y; y <= last.y; ++y)
+            for(int x = first.x; x <= last.x; ++x)
+                farthest = max(farthest, imageLoad(src, ivec2(x, y)).r);
+    }
+
+    imageStore(dst, pos, vec4(farthest));
+}
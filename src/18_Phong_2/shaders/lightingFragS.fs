@@ -11,6 +11,9 @@ uniform vec3 objectColor;
 uniform vec3 lightColor;
 uniform vec3 lightPos;
 uniform vec3 camPos;
+uniform mat4 view;
+
+// Shadows: shadows.glsl (shadowsEnabled, sunDirection, sunColor, sunVisibility()), inserted by Shader
 
 //uniform sampler2D texture1;  // more: sampler1D, sampler3D
 //uniform sampler2D texture2;
@@ -24,7 +27,7 @@ void main()
     // Diffuse lighting
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(lightPos - FragPos);
-    float diffuse = max(dot(norm, lightDir), 0.0) * lightColor;
+    vec3 diffuse = max(dot(norm, lightDir), 0.0) * lightColor;
 
     // Specular lighting
     float specularStrength = 0.5;
@@ -34,7 +37,18 @@ void main()
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     vec3 specular = specularStrength * spec * lightColor;
 
-    vec3 color = (ambient + diffuse + specular) * objectColor;
+    vec3 color = ambient + diffuse + specular;
+
+    if(shadowsEnabled)
+    {
+        vec3 sunDir = -normalize(sunDirection);
+        float sunDiffuse = max(dot(norm, sunDir), 0.0);
+        float sunSpecular = specularStrength * pow(max(dot(viewDir, reflect(-sunDir, norm)), 0.0), shininess);
+        float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+        color += (sunDiffuse + sunSpecular) * sunColor * sunVisibility(FragPos, viewDepth);
+    }
+
+    color *= objectColor;
     FragColor = vec4(color, 1.0f);
 
     //FragColor = vec4(ourColor, 1.0f);
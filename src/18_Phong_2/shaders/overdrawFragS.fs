@@ -0,0 +1,10 @@
+#version 330 core
+
+// Overdraw count (see OverdrawView): each fragment adds 1 to the count target (additive blending)
+
+out float Count;
+
+void main()
+{
+    Count = 1.0;
+}
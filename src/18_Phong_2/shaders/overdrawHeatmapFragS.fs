@@ -0,0 +1,31 @@
+#version 330 core
+
+// Overdraw heatmap (see OverdrawView): fragments per pixel -> color. 0 black, 1 blue, 2 green, 3 yellow, 4 orange,
+// maxCount or more red to white
+
+in vec2 TexCoord;
+out vec4 FragColor;
+
+uniform sampler2D overdrawCount;
+uniform float maxCount;
+
+const vec3 ramp[6] = vec3[6](
+    vec3(0.0, 0.0, 0.0),
+    vec3(0.0, 0.2, 1.0),
+    vec3(0.0, 0.8, 0.2),
+    vec3(1.0, 1.0, 0.0),
+    vec3(1.0, 0.5, 0.0),
+    vec3(1.0, 0.0, 0.0) );
+
+void main()
+{
+    float count = texture(overdrawCount, TexCoord).r;
+
+    vec3 color;
+    if(count < 5.0)
+        color = mix(ramp[int(count)], ramp[min(int(count) + 1, 5)], fract(count));
+    else
+        color = mix(ramp[5], vec3(1.0), clamp((count - 5.0) / max(maxCount - 5.0, 1.0), 0.0, 1.0));
+
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Depth only pass (shadow maps) for PackedVertices: decodePosition() is generated by PackedVertices::shaderPrelude()
+
+uniform mat4 model;
+uniform mat4 lightSpace;
+
+void main()
+{
+    gl_Position = lightSpace * model * vec4(decodePosition(), 1.0f);
+}
@@ -0,0 +1,30 @@
+// Directional light with cascaded shadow maps (see CascadedShadowMaps). Fragment prelude of the lit shaders: inserted
+// after their #version line by Shader (CascadedShadowMaps::shaderPrelude()).
+
+uniform bool  shadowsEnabled;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4  lightSpace[4];
+uniform float cascadeSplits[4];         // far view depth of each cascade
+uniform int   numCascades;
+uniform float shadowTexel;              // 1 / resolution
+uniform vec3  sunDirection;
+uniform vec3  sunColor = vec3(0.6);
+
+// Light reaching the point (1: lit, 0: shadow). 3x3 PCF over the 2x2 hardware filtered comparisons.
+float sunVisibility(vec3 worldPos, float viewDepth)
+{
+    if(viewDepth > cascadeSplits[numCascades - 1]) return 1.0;
+
+    int cascade = 0;
+    while(cascade < numCascades - 1 && viewDepth > cascadeSplits[cascade]) ++cascade;
+
+    vec4 lightPos = lightSpace[cascade] * vec4(worldPos, 1.0);
+    vec3 coord = lightPos.xyz / lightPos.w * 0.5 + 0.5;
+
+    float visibility = 0.0;
+    for(int y = -1; y <= 1; ++y)
+        for(int x = -1; x <= 1; ++x)
+            visibility += texture(shadowMap, vec4(coord.xy + vec2(x, y) * shadowTexel, cascade, coord.z - 0.0005));
+    return visibility / 9.0;
+}
+
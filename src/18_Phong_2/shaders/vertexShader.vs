@@ -15,6 +15,8 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 normalMatrix;
 
+invariant gl_Position;          // same depth as depthPrepass.vs
+
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
@@ -0,0 +1,23 @@
+#version 330 core
+
+// Vertex inputs and decodePosition(), decodeNormal(), decodeTexCoord() are generated by PackedVertices::shaderPrelude()
+
+out vec3 FragPos;
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat3 normalMatrix;
+
+invariant gl_Position;          // same depth as depthPrepassPacked.vs
+
+void main()
+{
+    vec3 pos = decodePosition();
+
+    gl_Position = projection * view * model * vec4(pos, 1.0f);
+    FragPos = vec3(model * vec4(pos, 1.0));
+
+    Normal = normalMatrix * decodeNormal();
+}
@@ -0,0 +1,893 @@
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include "GL/glew.h"
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include "glad/glad.h"
+#endif
+#include "GLFW/glfw3.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "benchmarks.hpp"
+#include "meshImporter.hpp"
+#include "vertexFormat.hpp"
+#include "streamBuffer.hpp"
+#include "clusteredLights.hpp"
+#include "shadowMaps.hpp"
+#include "gpuScene.hpp"
+#include "hiZ.hpp"
+#include "occlusionRasterizer.hpp"
+#include "softRasterizer.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+#include "frameArena.hpp"
+#include "floatingOrigin.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const std::string shadersDir = "../../../src/18_Phong_2/shaders/";
+const unsigned maxBruteForceLights = 1000;      // looping over more lights per fragment takes seconds per frame
+const double   screenHeight = 600;              // window height, to express position errors in pixels
+
+// Camera looking at a square grid of instances centered at the origin
+void gridCamera(GLFWwindow *window, unsigned instances, glm::mat4 &view, glm::mat4 &projection)
+{
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    float side = std::ceil(std::sqrt((float)instances));
+
+    view = glm::lookAt(glm::vec3(0.0f, 0.0f, side * 1.3f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    projection = glm::perspective(glm::radians(45.0f), (float)width / (float)std::max(height, 1), 0.1f, side * 4.0f);
+}
+
+glm::mat4 gridModel(unsigned i, unsigned instances)
+{
+    unsigned side = (unsigned)std::ceil(std::sqrt((float)instances));
+    glm::vec3 pos((float)(i % side) - (side - 1) * 0.5f, (float)(i / side) - (side - 1) * 0.5f, 0.0f);
+    return glm::translate(glm::mat4(1.0f), pos);
+}
+
+// Animated height field as a triangle soup (interleaved position + normal), square of side 2 centered at the origin
+void writeWave(float *dst, unsigned numTriangles, float time)
+{
+    unsigned side = std::max(1u, (unsigned)std::sqrt(numTriangles / 2.0f));
+    unsigned written = 0;
+
+    auto vertex = [&](unsigned i, unsigned j)
+    {
+        float x = 2.0f * i / side - 1.0f, z = 2.0f * j / side - 1.0f;
+        float y = 0.1f * std::sin(4.0f * x + time) * std::cos(4.0f * z + time);
+        float dx = 0.4f * std::cos(4.0f * x + time) * std::cos(4.0f * z + time);      // dy/dx
+        float dz = -0.4f * std::sin(4.0f * x + time) * std::sin(4.0f * z + time);     // dy/dz
+        glm::vec3 n = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+        float v[6] = { x, y, z, n.x, n.y, n.z };
+        std::copy(v, v + 6, dst);
+        dst += 6;
+    };
+
+    for(unsigned k = 0; k < side * side && written + 2 <= numTriangles; ++k, written += 2)
+    {
+        unsigned i = k % side, j = k / side;
+        vertex(i, j);     vertex(i, j + 1); vertex(i + 1, j);
+        vertex(i + 1, j); vertex(i, j + 1); vertex(i + 1, j + 1);
+    }
+
+    for(; written < numTriangles; ++written)        // degenerate padding
+        for(int v = 0; v < 3; ++v) vertex(0, 0);
+}
+
+} // anonymous namespace end
+
+void benchmarkVertexFormats(GLFWwindow *window, const MeshData &mesh, unsigned frames, unsigned instances)
+{
+    VertexInput input{ mesh.vertices.data(), mesh.numVertices(), MeshData::stride, 0, 3, -1 };
+    const VertexFormat formats[2] = { VertexFormat::floats(), VertexFormat::packed() };
+    const char *names[2] = { "float", "packed" };
+
+    glm::mat4 view, projection;
+    gridCamera(window, instances, view, projection);
+
+    // Fit the mesh in a unit box
+    glm::vec3 size = mesh.maxBound - mesh.minBound;
+    float maxSize = std::max(size.x, std::max(size.y, size.z));
+    glm::mat4 fit = glm::scale(glm::mat4(1.0f), glm::vec3(maxSize > 0.0f ? 0.9f / maxSize : 1.0f));
+    fit = glm::translate(fit, -(mesh.minBound + mesh.maxBound) * 0.5f);
+
+    unsigned query;
+    glGenQueries(1, &query);
+    glfwSwapInterval(0);                    // Don't let vsync hide the differences
+    glEnable(GL_DEPTH_TEST);
+
+    std::cout << "Vertex format benchmark: " << mesh.numVertices() << " vertices, " << mesh.numTriangles() << " triangles, " <<
+                 instances << " instances, " << frames << " frames" << std::endl;
+
+    for(int f = 0; f < 2; ++f)
+    {
+        PackedVertices packed(input, formats[f]);
+        Shader program((shadersDir + "vertexShaderPacked.vs").c_str(), (shadersDir + "lightingFragS.fs").c_str(), packed.shaderPrelude(),
+                       CascadedShadowMaps::shaderPrelude(shadersDir));
+
+        unsigned VAO, VBO, EBO;
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, packed.data.size(), packed.data.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned), mesh.indices.data(), GL_STATIC_DRAW);
+        packed.setupAttributes();
+
+        program.UseProgram();
+        program.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
+        program.setVec3("lightColor",  1.0f, 1.0f, 1.0f);
+        program.setVec3("lightPos", 0.0f, 5.0f, 10.0f);
+        program.setVec3("camPos", glm::vec3(glm::inverse(view)[3]));
+        program.setMat4("view", view);
+        program.setMat4("projection", projection);
+        packed.setUniforms(program);
+
+        double gpuTime = 0, frameTime = 0;
+        const unsigned warmUp = 10;
+
+        for(unsigned frame = 0; frame < frames + warmUp; ++frame)
+        {
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            for(unsigned i = 0; i < instances; ++i)
+            {
+                glm::mat4 model = gridModel(i, instances) * fit;
+                program.setMat4("model", model);
+                program.setMat3("normalMatrix", glm::mat3(glm::transpose(glm::inverse(model))));
+                glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, nullptr);
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);      // waits for the GPU
+
+            if(frame >= warmUp)
+            {
+                gpuTime += elapsed / 1e6;
+                frameTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+            }
+        }
+
+        gpuTime /= frames;
+        frameTime /= frames;
+        double vertexBytes = (double)packed.data.size() * instances;            // fetched at least once per instance
+
+        std::cout << std::fixed << std::setprecision(3) <<
+                     "    - " << std::setw(6) << names[f] << ": " << packed.stride << " bytes/vertex" <<
+                     " | VBO " << packed.data.size() / 1024.0 << " KB" <<
+                     " | GPU " << gpuTime << " ms" <<
+                     " | frame " << frameTime << " ms" <<
+                     " | vertex bandwidth " << vertexBytes / (gpuTime / 1e3) / 1e9 << " GB/s" << std::endl;
+
+        glBindVertexArray(0);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    glDeleteQueries(1, &query);
+    glfwSwapInterval(1);
+}
+
+void benchmarkStreaming(GLFWwindow *window, double megabytesPerSecond, unsigned frames)
+{
+    const size_t vertexSize = 6 * sizeof(float);
+    unsigned numTriangles = (unsigned)(megabytesPerSecond * 1e6 / 60.0 / (3 * vertexSize));
+    size_t frameBytes = numTriangles * 3 * vertexSize;
+    const char *names[3] = { "glBufferData", "orphan + SubData", "persistent map" };
+
+    Shader program((shadersDir + "vertexShader.vs").c_str(), (shadersDir + "lightingFragS.fs").c_str(), "",
+                   CascadedShadowMaps::shaderPrelude(shadersDir));
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.5f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)std::max(height, 1), 0.1f, 10.0f);
+
+    program.UseProgram();
+    program.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
+    program.setVec3("lightColor",  1.0f, 1.0f, 1.0f);
+    program.setVec3("lightPos", 1.2f, 1.0f, 2.0f);
+    program.setVec3("camPos", 0.0f, 1.5f, 2.0f);
+    program.setMat4("view", view);
+    program.setMat4("projection", projection);
+    program.setMat4("model", glm::mat4(1.0f));
+    program.setMat3("normalMatrix", glm::mat3(1.0f));
+
+    glfwSwapInterval(0);
+    glEnable(GL_DEPTH_TEST);
+
+    std::cout << "Streaming benchmark: " << frameBytes / 1e6 << " MB/frame (" << megabytesPerSecond << " MB/s at 60 fps), " <<
+                 frames << " frames" << std::endl;
+
+    std::vector<float> cpuVertices(numTriangles * 3 * 6);
+
+    for(int mode = 0; mode < 3; ++mode)
+    {
+        StreamBuffer *stream = nullptr;
+        unsigned VBO = 0;
+
+        if(mode == 0) glGenBuffers(1, &VBO);
+        else
+        {
+            stream = new StreamBuffer(frameBytes + vertexSize, 3, mode == 2);
+            if(mode == 2 && !stream->isPersistent())
+            {
+                std::cout << "    - " << names[mode] << ": not supported (needs GL 4.4)" << std::endl;
+                delete stream;
+                continue;
+            }
+            VBO = stream->ID;
+        }
+
+        unsigned VAO;
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexSize, (void *)nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, vertexSize, (void *)(3 * sizeof(float)));
+        glEnableVertexAttribArray(3);
+
+        double frameTime = 0, uploadTime = 0, waitTime = 0, totalBytes = 0;
+        const unsigned warmUp = 10;
+        std::chrono::high_resolution_clock::time_point benchStart;
+
+        for(unsigned frame = 0; frame < frames + warmUp; ++frame)
+        {
+            if(frame == warmUp) benchStart = std::chrono::high_resolution_clock::now();
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // Write this frame's vertices
+            float time = frame / 60.0f;
+            GLint first = 0;
+
+            if(mode == 0)
+            {
+                writeWave(cpuVertices.data(), numTriangles, time);
+                glBufferData(GL_ARRAY_BUFFER, frameBytes, cpuVertices.data(), GL_STATIC_DRAW);     // as the examples do
+            }
+            else
+            {
+                stream->beginFrame();
+                size_t offset;
+                float *dst = (float *)stream->allocate(frameBytes, offset, vertexSize);
+                writeWave(dst, numTriangles, time);
+                stream->flush();
+                first = (GLint)(offset / vertexSize);
+                if(frame >= warmUp) waitTime += stream->waitTime * 1e3;
+            }
+
+            if(frame >= warmUp)
+            {
+                uploadTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+                totalBytes += frameBytes;
+            }
+
+            glDrawArrays(GL_TRIANGLES, first, numTriangles * 3);
+            if(stream) stream->endFrame();
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+
+            if(frame >= warmUp)
+                frameTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+        }
+
+        glFinish();
+        double seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - benchStart).count() / 1e6;
+
+        std::cout << std::fixed << std::setprecision(3) <<
+                     "    - " << std::setw(16) << names[mode] << ": " << totalBytes / seconds / 1e6 << " MB/s" <<
+                     " | frame " << frameTime / frames << " ms" <<
+                     " | write + upload " << uploadTime / frames << " ms" <<
+                     " | fence wait " << waitTime / frames << " ms" << std::endl;
+
+        glBindVertexArray(0);
+        glDeleteVertexArrays(1, &VAO);
+        if(stream) delete stream;
+        else glDeleteBuffers(1, &VBO);
+    }
+
+    glfwSwapInterval(1);
+}
+
+void benchmarkClusteredLights(GLFWwindow *window, unsigned maxLights, unsigned frames)
+{
+    const unsigned instances = 256;
+    MeshData sphere;
+    makeSphere(sphere, 32, 64);
+
+    glm::mat4 view, projection;
+    gridCamera(window, instances, view, projection);
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    float aspect = (float)width / (float)std::max(height, 1);
+    float side = std::ceil(std::sqrt((float)instances));
+    float farPlane = side * 4.0f;
+    projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, farPlane);
+
+    Shader program((shadersDir + "vertexShader.vs").c_str(), (shadersDir + "clusteredFragS.fs").c_str(), "",
+                   CascadedShadowMaps::shaderPrelude(shadersDir));
+    ClusteredLights clusters;
+
+    unsigned VAO, VBO, EBO, query;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenQueries(1, &query);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sphere.vertices.size() * sizeof(float), sphere.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.indices.size() * sizeof(unsigned), sphere.indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MeshData::stride * sizeof(float), (void *)nullptr);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, MeshData::stride * sizeof(float), (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+
+    program.UseProgram();
+    program.setVec3("objectColor", 1.0f, 1.0f, 1.0f);
+    program.setVec3("camPos", glm::vec3(glm::inverse(view)[3]));
+    program.setMat4("view", view);
+    program.setMat4("projection", projection);
+
+    glfwSwapInterval(0);
+    glEnable(GL_DEPTH_TEST);
+
+    std::cout << "Clustered lighting benchmark: " << instances << " spheres, " << clusters.numClusters() << " clusters, " <<
+                 frames << " frames per light count" << std::endl;
+
+    std::vector<unsigned> counts;
+    for(unsigned n = 1; n < maxLights; n *= 10) counts.push_back(n);
+    counts.push_back(maxLights);
+
+    for(unsigned numLights : counts)
+    {
+        // Random lights around the grid. The radius shrinks as they multiply, so the lights affecting each point stay bounded.
+        std::mt19937 rng(numLights);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        float radius = glm::clamp(0.8f * side / std::cbrt((float)numLights), 0.5f, side);
+
+        std::vector<PointLight> lights(numLights);
+        for(PointLight &light : lights)
+        {
+            light.position = glm::vec3((unit(rng) - 0.5f) * side, (unit(rng) - 0.5f) * side, unit(rng) * 2.0f - 0.5f);
+            light.radius = radius;
+            light.color = glm::vec3(unit(rng), unit(rng), unit(rng));
+            light.intensity = 2.0f;
+        }
+
+        double times[2][2] = { { 0, 0 }, { 0, 0 } };       // [clustered, brute force][CPU assignment, GPU]
+
+        for(int bruteForce = 0; bruteForce < 2; ++bruteForce)
+        {
+            if(bruteForce && numLights > maxBruteForceLights) continue;
+            program.UseProgram();
+            program.setBool("bruteForce", bruteForce);
+
+            const unsigned warmUp = 5;
+            for(unsigned frame = 0; frame < frames + warmUp; ++frame)
+            {
+                frameArena.beginFrame();                    // ClusteredLights::update() keeps its per-frame data there
+                glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                clusters.update(lights, view, glm::radians(45.0f), aspect, 0.1f, farPlane);     // redone each frame, as with a moving camera
+                program.UseProgram();
+                clusters.bind(program, 1);                  // unit 0: shadowMap (unused, but samplers of different types can't share a unit)
+                glBindVertexArray(VAO);
+
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                for(unsigned i = 0; i < instances; ++i)
+                {
+                    glm::mat4 model = glm::scale(gridModel(i, instances), glm::vec3(0.9f));
+                    program.setMat4("model", model);
+                    program.setMat3("normalMatrix", glm::mat3(glm::transpose(glm::inverse(model))));
+                    glDrawElements(GL_TRIANGLES, (GLsizei)sphere.indices.size(), GL_UNSIGNED_INT, nullptr);
+                }
+                glEndQuery(GL_TIME_ELAPSED);
+
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+                if(frame >= warmUp)
+                {
+                    times[bruteForce][0] += clusters.assignTime;
+                    times[bruteForce][1] += elapsed / 1e6;
+                }
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(3) <<
+                     "    - " << std::setw(5) << numLights << " lights (radius " << radius << "): assignment " << times[0][0] / frames << " ms" <<
+                     " | light indices " << clusters.numLightIndices() << " (max " << clusters.maxLightsPerCluster() << " per cluster)" <<
+                     " | GPU clustered " << times[0][1] / frames << " ms";
+        if(numLights <= maxBruteForceLights) std::cout << " | GPU brute force " << times[1][1] / frames << " ms";
+        std::cout << std::endl;
+    }
+
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteQueries(1, &query);
+    glfwSwapInterval(1);
+}
+
+void benchmarkGpuDriven(GLFWwindow *window, unsigned maxObjects, unsigned frames)
+{
+    if(!GpuScene::supported())
+    {
+        std::cout << "GPU driven benchmark: needs OpenGL 4.3" << std::endl;
+        return;
+    }
+
+    glState.invalidate();           // previous benchmarks used raw gl* calls
+
+    MeshData spheres[3];
+    makeSphere(spheres[0], 8, 16);
+    makeSphere(spheres[1], 12, 24);
+    makeSphere(spheres[2], 16, 32);
+
+    Shader perObjectProgram((shadersDir + "vertexShader.vs").c_str(), (shadersDir + "lightingFragS.fs").c_str(), "",
+                            CascadedShadowMaps::shaderPrelude(shadersDir));
+    unsigned query;
+    glGenQueries(1, &query);
+
+    glfwSwapInterval(0);
+    glState.enable(GL_DEPTH_TEST);
+
+    std::cout << "GPU driven rendering benchmark: " << frames << " frames per object count (camera sees ~1/4 of the grid)" << std::endl;
+
+    std::vector<unsigned> counts;
+    for(unsigned n = 1024; n < maxObjects; n *= 4) counts.push_back(n);
+    counts.push_back(maxObjects);
+
+    for(unsigned numObjects : counts)
+    {
+        GpuScene scene;
+        unsigned meshIds[3];
+        for(int m = 0; m < 3; ++m) meshIds[m] = scene.addMesh(spheres[m]);
+
+        std::mt19937 rng(numObjects);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for(unsigned i = 0; i < numObjects; ++i)
+            scene.addObject(meshIds[i % 3], glm::scale(gridModel(i, numObjects), glm::vec3(0.9f)), glm::vec3(unit(rng), unit(rng), unit(rng)));
+        scene.build();
+
+        glm::mat4 view, projection;
+        gridCamera(window, numObjects / 4, view, projection);
+        glm::vec3 camPos = glm::vec3(glm::inverse(view)[3]);
+
+        for(Shader *program : { &perObjectProgram, &scene.getProgram() })
+        {
+            program->UseProgram();
+            program->setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+            program->setVec3("lightPos", camPos + glm::vec3(0.0f, 5.0f, 0.0f));
+            program->setVec3("camPos", camPos);
+        }
+
+        const char *names[2] = { "per object", "multi-draw" };
+        double times[2][2] = { { 0, 0 }, { 0, 0 } };       // [per object, multi-draw][CPU submission, GPU]
+
+        for(int mode = 0; mode < 2; ++mode)
+        {
+            const unsigned warmUp = 5;
+            for(unsigned frame = 0; frame < frames + warmUp; ++frame)
+            {
+                glState.clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                auto start = std::chrono::high_resolution_clock::now();
+                if(mode == 0) scene.drawPerObject(perObjectProgram, view, projection);
+                else scene.draw(view, projection);
+                double submit = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+                glEndQuery(GL_TIME_ELAPSED);
+
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+                if(frame >= warmUp)
+                {
+                    times[mode][0] += submit;
+                    times[mode][1] += elapsed / 1e6;
+                }
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(3) << "    - " << std::setw(5) << numObjects << " objects (" << scene.countVisible() << " visible)";
+        for(int mode = 0; mode < 2; ++mode)
+            std::cout << " | " << names[mode] << ": CPU " << times[mode][0] / frames << " ms, GPU " << times[mode][1] / frames << " ms";
+        std::cout << std::endl;
+    }
+
+    glDeleteQueries(1, &query);
+    glfwSwapInterval(1);
+}
+
+void benchmarkOcclusion(GLFWwindow *window, unsigned side, unsigned layers, unsigned frames)
+{
+    if(!GpuScene::supported())
+    {
+        std::cout << "Occlusion culling benchmark: needs OpenGL 4.3" << std::endl;
+        return;
+    }
+
+    glState.invalidate();           // previous benchmarks used raw gl* calls
+
+    MeshData box;
+    makeBox(box);
+
+    GpuScene scene;
+    unsigned boxMesh = scene.addMesh(box);
+    std::mt19937 rng(side * layers);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for(unsigned layer = 0; layer < layers; ++layer)
+        for(unsigned i = 0; i < side * side; ++i)
+        {
+            glm::vec3 pos = glm::vec3(gridModel(i, side * side)[3]) * 1.2f - glm::vec3(0.0f, 0.0f, 1.5f * layer);
+            scene.addObject(boxMesh, glm::translate(glm::mat4(1.0f), pos), glm::vec3(unit(rng), unit(rng), unit(rng)));
+        }
+    scene.build();
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, side * 0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)std::max(height, 1), 0.1f, side + layers * 2.0f);
+    glm::vec3 camPos = glm::vec3(glm::inverse(view)[3]);
+
+    Shader perObjectProgram((shadersDir + "vertexShader.vs").c_str(), (shadersDir + "lightingFragS.fs").c_str(), "",
+                            CascadedShadowMaps::shaderPrelude(shadersDir));
+    for(Shader *program : { &perObjectProgram, &scene.getProgram() })
+    {
+        program->UseProgram();
+        program->setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+        program->setVec3("lightPos", camPos + glm::vec3(0.0f, 5.0f, 0.0f));
+        program->setVec3("camPos", camPos);
+    }
+
+    HiZBuffer hiZ;
+    OcclusionRasterizer rasterizer;
+    unsigned query;
+    glGenQueries(1, &query);
+
+    glfwSwapInterval(0);
+    glState.enable(GL_DEPTH_TEST);
+
+    std::cout << "Occlusion culling benchmark: " << scene.numObjects() << " cubes (" << side << " x " << side << " x " << layers << "), " <<
+                 frames << " frames per mode" << std::endl;
+
+    const char *names[3] = { "frustum", "frustum + Hi-Z", "frustum + CPU" };
+    for(int mode = 0; mode < 3; ++mode)
+    {
+        double gpuTime = 0, cpuTime = 0;
+        const unsigned warmUp = 5;
+        for(unsigned frame = 0; frame < frames + warmUp; ++frame)
+        {
+            glState.clearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            if(mode == 2)
+            {
+                rasterizer.clear(projection * view);
+                for(unsigned i = 0; i < scene.numObjects(); ++i) rasterizer.addOccluder(scene.getModel(i));
+                rasterizer.build();
+                scene.drawPerObject(perObjectProgram, view, projection, &rasterizer);
+            }
+            else
+            {
+                scene.draw(view, projection, mode == 1 ? &hiZ : nullptr);
+                if(mode == 1) hiZ.build(width, height, projection * view);
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+            double cpu = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            if(frame >= warmUp)
+            {
+                gpuTime += elapsed / 1e6;
+                cpuTime += cpu;
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(3) << "    - " << std::setw(15) << names[mode] << ": ";
+        if(mode == 2)
+        {
+            const OcclusionRasterizer::Stats &stats = rasterizer.getStats();
+            std::cout << stats.occluders << " occluders (" << stats.triangles << " triangles, " << stats.rasterTime << " ms) | " <<
+                         scene.numObjects() - stats.tested << " frustum culled | " << stats.occluded << " occlusion culled | " <<
+                         stats.tested - stats.occluded << " drawn";
+        }
+        else
+        {
+            GpuScene::CullStats stats = scene.readStats();
+            std::cout << stats.frustumCulled << " frustum culled | " << stats.occlusionCulled << " occlusion culled | " << stats.visible << " drawn";
+        }
+        std::cout << " | CPU " << cpuTime / frames << " ms | GPU " << gpuTime / frames << " ms" << std::endl;
+    }
+
+    glDeleteQueries(1, &query);
+    glfwSwapInterval(1);
+}
+
+void benchmarkSoftRasterizer(unsigned frames)
+{
+    // Textured cube: makeBox() plus texture coordinates from the position on each face (position, normal, uv)
+    MeshData box, sphere;
+    makeBox(box);
+    makeSphere(sphere, 64, 128);
+
+    std::vector<float> cube;
+    for(size_t v = 0; v < box.numVertices(); ++v)
+    {
+        const float *src = &box.vertices[v * MeshData::stride];
+        int axis = std::abs(src[3]) > 0.5f ? 0 : (std::abs(src[4]) > 0.5f ? 1 : 2);
+        cube.insert(cube.end(), src, src + MeshData::stride);
+        cube.push_back(src[(axis + 1) % 3] + 0.5f);
+        cube.push_back(src[(axis + 2) % 3] + 0.5f);
+    }
+    VertexInput cubeInput{ cube.data(), box.numVertices(), 8, 0, 3, 6 };
+    VertexInput sphereInput{ sphere.vertices.data(), sphere.numVertices(), MeshData::stride, 0, 3, -1 };
+
+    // Checkerboard
+    const int texSize = 256;
+    std::vector<unsigned char> texels(texSize * texSize * 4);
+    for(int y = 0; y < texSize; ++y)
+        for(int x = 0; x < texSize; ++x)
+        {
+            unsigned char c = ((x / 32 + y / 32) % 2) ? 255 : 60;
+            unsigned char *t = &texels[(y * texSize + x) * 4];
+            t[0] = c; t[1] = c; t[2] = (unsigned char)(c / 2 + 64); t[3] = 255;
+        }
+    SoftTexture texture(texSize, texSize, texels.data());
+
+    const unsigned cubes = 400, spheres = 64;
+    const int resolutions[3][2] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+    std::vector<unsigned> threadCounts = { 1 };
+    if(std::thread::hardware_concurrency() > 1) threadCounts.push_back(std::thread::hardware_concurrency());
+
+    std::cout << "Software rasterizer benchmark: " << cubes << " textured cubes (" << cubes * 12 << " triangles) | " << spheres <<
+                 " spheres (" << spheres * sphere.numTriangles() << " triangles) | " << frames << " frames per mode" << std::endl;
+
+    for(const int *resolution : resolutions)
+        for(unsigned threads : threadCounts)
+        {
+            SoftRasterizer rasterizer(resolution[0], resolution[1], threads);
+            rasterizer.setCullBackFaces(true);
+
+            const char *names[3] = { "cubes, nearest", "cubes, bilinear", "spheres" };
+            for(int mode = 0; mode < 3; ++mode)
+            {
+                unsigned instances = mode == 2 ? spheres : cubes;
+                glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, std::sqrt((float)instances) * (mode == 2 ? 1.6f : 1.3f)), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)resolution[0] / resolution[1], 0.1f, 100.0f);
+                rasterizer.setCamera(view, projection);
+
+                PhongShading shading;
+                shading.objectColor = glm::vec3(1.0f, 0.5f, 0.31f);
+                shading.lightPos    = glm::vec3(0.0f, 5.0f, 20.0f);
+                shading.camPos      = glm::vec3(glm::inverse(view)[3]);
+                shading.texture     = mode == 2 ? nullptr : &texture;
+                shading.filter      = mode == 0 ? SOFT_NEAREST : SOFT_BILINEAR;
+
+                double setupTime = 0, rasterTime = 0;
+                size_t triangles = 0, pixels = 0;
+                for(unsigned frame = 0; frame < frames; ++frame)
+                {
+                    rasterizer.clear(glm::vec3(0.2f, 0.3f, 0.3f));
+                    for(unsigned i = 0; i < instances; ++i)
+                    {
+                        glm::mat4 model = glm::rotate(gridModel(i, instances), 0.1f * frame + i, glm::vec3(1.0f, 0.3f, 0.5f));
+                        if(mode == 2) rasterizer.draw(sphereInput, sphere.indices.data(), sphere.indices.size(), model, shading);
+                        else          rasterizer.draw(cubeInput, box.indices.data(), box.indices.size(), model, shading);
+                    }
+                    rasterizer.finish();
+
+                    const SoftRasterizer::Stats &stats = rasterizer.getStats();
+                    setupTime  += stats.setupTime;
+                    rasterTime += stats.rasterTime;
+                    triangles  += stats.triangles;
+                    pixels     += stats.pixelsShaded;
+                }
+
+                std::cout << std::fixed << std::setprecision(2) << "    - " << resolution[0] << "x" << resolution[1] << ", " << threads <<
+                             " thread(s), " << std::setw(15) << names[mode] << ": " << (setupTime + rasterTime) / frames << " ms/frame | " <<
+                             triangles / (setupTime + rasterTime) / 1e3 << " Mtri/s | " << pixels / rasterTime / 1e3 << " Mpix/s" << std::endl;
+            }
+        }
+}
+
+void benchmarkCameraRelative(unsigned objects, unsigned frames)
+{
+    const double distances[] = { 0, 1e3, 1e4, 1e5, 1e6, 1e7 };
+    const glm::dvec3 direction = glm::normalize(glm::dvec3(0.6, 0.1, 0.8));
+    const glm::vec3 corner(0.5f);                           // vertex whose error is measured (unit cube corner)
+    const double focal = screenHeight / 2 / std::tan(glm::radians(45.0 / 2));   // pixels
+
+    // Objects in front of the camera, site-local
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<glm::dvec3> local(objects);
+    for(glm::dvec3 &position : local)
+        position = glm::dvec3(unit(rng) * 40 - 20, unit(rng) * 7 - 2, -5 - unit(rng) * 75);
+
+    std::vector<glm::mat4> modelViews(objects);
+    std::vector<glm::vec3> floatWorld(objects);
+    std::vector<glm::dvec3> world(objects);
+
+    std::cout << "Camera-relative benchmark: " << objects << " objects, " << frames << " frames per mode (model-view matrix per object)" << std::endl;
+
+    for(double distance : distances)
+    {
+        glm::dvec3 site = direction * distance;
+        glm::dvec3 camera = site + glm::dvec3(0.0, 1.7, 0.0);
+        for(unsigned i = 0; i < objects; ++i)
+        {
+            world[i] = site + local[i];
+            floatWorld[i] = glm::vec3(world[i]);
+        }
+
+        glm::dmat4 referenceView = glm::lookAt(camera, camera + glm::dvec3(0, 0, -1), glm::dvec3(0, 1, 0));
+        double times[2] = { 0, 0 }, maxError[2] = { 0, 0 }, maxPixels[2] = { 0, 0 };
+
+        for(int mode = 0; mode < 2; ++mode)
+        {
+            for(unsigned frame = 0; frame < frames; ++frame)
+            {
+                std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+                if(mode == 0)
+                {
+                    // Float world space: the view translation and the object positions are large floats
+                    glm::vec3 eye(camera);
+                    glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+                    for(unsigned i = 0; i < objects; ++i)
+                        modelViews[i] = glm::translate(view, floatWorld[i]);
+                }
+                else
+                {
+                    // Camera-relative: double subtraction per object, small floats afterwards
+                    FloatingOrigin origin;
+                    origin.update(camera);
+                    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+                    for(unsigned i = 0; i < objects; ++i)
+                        modelViews[i] = glm::translate(view, origin.toRender(world[i]));
+                }
+                times[mode] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+            }
+
+            for(unsigned i = 0; i < objects; ++i)
+            {
+                glm::dvec3 reference = glm::dvec3(referenceView * glm::translate(glm::dmat4(1.0), world[i]) * glm::dvec4(glm::dvec3(corner), 1.0));
+                glm::dvec3 actual = glm::dvec3(glm::vec3(modelViews[i] * glm::vec4(corner, 1.0f)));
+                double error = glm::length(actual - reference);
+                maxError[mode] = std::max(maxError[mode], error);
+                maxPixels[mode] = std::max(maxPixels[mode], error * focal / -reference.z);
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(0) << "    - " << std::setw(8) << distance << " m: float " << std::setprecision(2) <<
+                     times[0] * 1e6 / frames / objects << " ns/object, error " << std::setprecision(4) << maxError[0] * 1000 << " mm (" <<
+                     maxPixels[0] << " px) | camera-relative " << std::setprecision(2) << times[1] * 1e6 / frames / objects <<
+                     " ns/object, error " << std::setprecision(4) << maxError[1] * 1000 << " mm (" << maxPixels[1] << " px)" << std::endl;
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+void benchmarkMemoryBudget(GLFWwindow *window, unsigned tiles, int tileSize, size_t budgetMB, unsigned frames)
+{
+    glState.invalidate();
+
+    // One mipmapped RGBA8 texture per tile of a ring the camera travels along; the tiles near the camera are needed
+    const unsigned workingSet = 16;
+    const float    speed = 0.25f;                       // tiles per frame
+    std::vector<unsigned char> pixels((size_t)tileSize * tileSize * 4);
+    std::vector<unsigned> textures(tiles, 0);
+    unsigned streamIns = 0;
+
+    auto streamIn = [&](unsigned tile)
+    {
+        std::fill(pixels.begin(), pixels.end(), (unsigned char)(tile * 37));
+        glGenTextures(1, &textures[tile]);
+        glState.bindTexture(0, GL_TEXTURE_2D, textures[tile]);
+        gpuMemory.texImage2D(textures[tile], GL_TEXTURE_2D, 0, GL_RGBA8, tileSize, tileSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data(), "tiles");
+        gpuMemory.generateMipmap(textures[tile], GL_TEXTURE_2D);
+        gpuMemory.setStreamable(textures[tile], [&textures, tile]()
+        {
+            glDeleteTextures(1, &textures[tile]);
+            glState.deletedTexture(textures[tile]);
+            gpuMemory.deletedTexture(textures[tile]);
+            textures[tile] = 0;
+        });
+        ++streamIns;
+    };
+
+    glfwSwapInterval(0);
+    std::cout << "Memory budget benchmark: " << tiles << " tiles of " << tileSize << "^2 RGBA8 + mips, " << workingSet <<
+                 " tiles around the camera, " << frames << " frames per mode" << std::endl;
+
+    for(int mode = 0; mode < 2; ++mode)
+    {
+        size_t budget = mode ? budgetMB << 20 : 0;
+        gpuMemory.setBudget(budget);
+        unsigned evictionsBefore = gpuMemory.getTotals().evictions;
+        streamIns = 0;
+        size_t peak = 0;
+        double cpuTime = 0;
+
+        for(unsigned frame = 0; frame < frames; ++frame)
+        {
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            gpuMemory.beginFrame();
+
+            unsigned first = (unsigned)(frame * speed);
+            for(unsigned i = 0; i < workingSet; ++i)
+            {
+                unsigned tile = (first + i) % tiles;
+                if(!textures[tile]) streamIn(tile);
+                gpuMemory.touch(textures[tile]);
+            }
+            cpuTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+
+            peak = std::max(peak, gpuMemory.getTotals().total());
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+
+        std::cout << std::fixed << std::setprecision(1) << "    " << (mode ? "budget " + std::to_string(budgetMB) + " MB" : "no budget   ") <<
+                     " | peak " << peak / 1048576.0 << " MB | stream-ins " << streamIns << " | evictions " <<
+                     gpuMemory.getTotals().evictions - evictionsBefore << " | CPU " << std::setprecision(3) << cpuTime / frames <<
+                     " ms/frame" << std::defaultfloat << std::setprecision(6) << std::endl;
+
+        for(unsigned &texture : textures)                   // next mode starts empty
+            if(texture)
+            {
+                glDeleteTextures(1, &texture);
+                glState.deletedTexture(texture);
+                gpuMemory.deletedTexture(texture);
+                texture = 0;
+            }
+    }
+    gpuMemory.setBudget(0);
+}
@@ -0,0 +1,44 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include <cstddef>
+
+struct GLFWwindow;
+struct MeshData;
+
+// Benchmarks run from the command line (see main.cpp). They use the current GL context of the window and print a report.
+
+// Draw the same mesh with the float and the packed (quantized) vertex formats; compare vertex bytes, GPU time and frame time
+void benchmarkVertexFormats(GLFWwindow *window, const MeshData &mesh, unsigned frames = 300, unsigned instances = 64);
+
+// Stream dynamic vertex data (animated wave, position + normal) at megabytesPerSecond (assuming 60 fps) through
+// glBufferData reallocation, StreamBuffer with orphaning + glBufferSubData, and the persistently mapped StreamBuffer
+void benchmarkStreaming(GLFWwindow *window, double megabytesPerSecond = 100, unsigned frames = 600);
+
+// Light a grid of spheres with 1, 10, 100... maxLights point lights using ClusteredLights; report CPU assignment time and
+// GPU time, compared with looping over every light in the fragment shader (up to 1000 lights)
+void benchmarkClusteredLights(GLFWwindow *window, unsigned maxLights = 10000, unsigned frames = 60);
+
+// Draw grids of 1024, 4096... maxObjects spheres (3 tessellations) with one draw call per object and with GpuScene
+// (compute culling + one multi-draw indirect); report CPU submission time, GPU time and visible objects
+void benchmarkGpuDriven(GLFWwindow *window, unsigned maxObjects = 16384, unsigned frames = 60);
+
+// Dense block of side x side x layers cubes seen from the front (12_3D_cubes scaled up). Draw it with GpuScene using frustum
+// culling only, frustum + Hi-Z occlusion culling (previous frame's depth), and the CPU path with OcclusionRasterizer;
+// report how many objects each stage rejects and the GPU time
+void benchmarkOcclusion(GLFWwindow *window, unsigned side = 32, unsigned layers = 16, unsigned frames = 60);
+
+// SoftRasterizer (no GL needed): a grid of textured cubes (nearest and bilinear) and a grid of finely tessellated spheres
+// at 3 resolutions, with 1 thread and with every hardware thread; report Mtri/s (setup + raster) and Mpix/s (raster)
+void benchmarkSoftRasterizer(unsigned frames = 10);
+
+// CPU only: build the model-view matrices of objects around a camera placed 0, 10^3... 10^7 m from the world origin, with
+// float world positions and with double world positions made camera-relative before the conversion (FloatingOrigin).
+// Report the time per object and the largest position error against a double precision reference (view space and pixels)
+void benchmarkCameraRelative(unsigned objects = 100000, unsigned frames = 20);
+
+// Stream tiles (mipmapped textures, registered as streamable in gpuMemory) around a camera moving along a ring, once with
+// no budget and once with budgetMB. Report the peak GPU memory, the textures streamed in and the LRU evictions
+void benchmarkMemoryBudget(GLFWwindow *window, unsigned tiles = 96, int tileSize = 512, size_t budgetMB = 48, unsigned frames = 600);
+
+#endif
@@ -1,9 +1,11 @@
 #include "camera.hpp"
 #include "glad/glad.h"
 #include <vector>
+#include <limits>
 
 Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch)
-    : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), fov(FOV)
+    : MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), fov(FOV),
+      cachedYaw(std::numeric_limits<float>::quiet_NaN()), viewValid(false)     // NaN: never equal, the first update builds
 {
     Position = position;
     WorldUp = up;
@@ -13,34 +15,47 @@ Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch)
 }
 
 Camera::Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch)
-    : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), fov(FOV)
+    : MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), fov(FOV),
+      cachedYaw(std::numeric_limits<float>::quiet_NaN()), viewValid(false)     // NaN: never equal, the first update builds
 {
-    Position = glm::vec3(posX, posY, posZ);
+    Position = glm::dvec3(posX, posY, posZ);
     WorldUp = glm::vec3(upX, upY, upZ);
     Yaw = yaw;
     Pitch = pitch;
     updateCameraVectors();
 }
 
-glm::mat4 Camera::GetViewMatrix()
+glm::mat4 Camera::GetViewMatrix(const glm::dvec3 &origin)
 {
-    return glm::lookAt(Position, Position + Front, Up);
+    updateCameraVectors();
+
+    glm::dvec3 offset = Position - origin;
+    if(viewValid && offset == cachedOffset) return view;
+
+    // Inverse of the camera transform: transposed rotation (rows: right, up, -front), then -(Position - origin)
+    view = glm::mat4(glm::transpose(glm::mat3_cast(orientation)));
+    view[3] = glm::vec4(-(glm::mat3(view) * glm::vec3(offset)), 1.0f);
+    cachedOffset = offset;
+    viewValid = true;
+    return view;
 }
 
 void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
 {
+    updateCameraVectors();
+
     float velocity = MovementSpeed * deltaTime;
     if(direction == FORWARD)
-        Position += Front * velocity;
+        Position += glm::dvec3(Front * velocity);
     if(direction == BACKWARD)
-        Position -= Front * velocity;
+        Position -= glm::dvec3(Front * velocity);
     if(direction == LEFT)
-        Position -= Right * velocity;
+        Position -= glm::dvec3(Right * velocity);
     if(direction == RIGHT)
-        Position += Right * velocity;
+        Position += glm::dvec3(Right * velocity);
 }
 
-void Camera::ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch = true)
+void Camera::ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch)
 {
     //xoffset *= MouseSensitivity;
     //yoffset *= MouseSensitivity;
@@ -55,8 +70,6 @@ void Camera::ProcessMouseMovement(float xoffset, float yoffset, bool constrainPi
         if(Pitch < -89.0f)
             Pitch = -89.0f;
     }
-
-    updateCameraVectors();
 }
 
 void Camera::ProcessMouseScroll(float yoffset)
@@ -68,14 +81,24 @@ void Camera::ProcessMouseScroll(float yoffset)
         fov = 45.0f;
 }
 
+const glm::quat &Camera::getOrientation() { updateCameraVectors(); return orientation; }
+
 void Camera::updateCameraVectors()
 {
-    glm::vec3 front;
-    front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-    front.y = sin(glm::radians(Pitch));
-    front.z = sin(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-    Front   = glm::normalize(front);
-
-    Right   = glm::normalize(glm::cross(Front, WorldUp));
-    Up      = glm::normalize(glm::cross(Right, Front));
+    if(Yaw == cachedYaw && Pitch == cachedPitch && WorldUp == cachedWorldUp) return;
+
+    // Yaw around WorldUp, then pitch around the camera's X; the default orientation (yaw -90) looks down -Z
+    orientation = glm::angleAxis(glm::radians(-(Yaw + 90.0f)), glm::normalize(WorldUp)) *
+                  glm::angleAxis(glm::radians(Pitch), glm::vec3(1.0f, 0.0f, 0.0f));
+
+    // Basis vectors straight from the rotation (unit length and orthogonal, no normalize/cross needed)
+    glm::mat3 rotation = glm::mat3_cast(orientation);
+    Right = rotation[0];
+    Up    = rotation[1];
+    Front = -rotation[2];
+
+    cachedYaw = Yaw;
+    cachedPitch = Pitch;
+    cachedWorldUp = WorldUp;
+    viewValid = false;                  // rebuilt by GetViewMatrix()
 }
@@ -3,6 +3,7 @@
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
 
 // Camera options options
 enum Camera_Movement { FORWARD, BACKWARD, LEFT, RIGHT };
@@ -14,17 +15,20 @@ const float SPEED       =  2.5f;
 const float SENSITIVITY =  0.1f;
 const float FOV        =  45.0f;   // fov
 
-// Class that processes input and calculates the corresponding Euler angles, vectors and matrices for use in OpenGL
+// Class that processes input and calculates the corresponding orientation, vectors and matrices for use in OpenGL.
+// Input is only accumulated: ProcessMouseMovement() adds the offsets to the Euler angles, which can also be written directly.
+// The orientation quaternion, the vectors and the view matrix are rebuilt lazily, once, the first time they're needed after
+// the angles change (usually once per frame, however many cursor events arrived), instead of on every event.
 class Camera
 {
 public:
     // camera attributes
-    glm::vec3 Position;
-    glm::vec3 Front;
+    glm::dvec3 Position;                // world position, double precision (see FloatingOrigin)
+    glm::vec3 Front;                    // refreshed by GetViewMatrix() and ProcessKeyboard()
     glm::vec3 Up;
     glm::vec3 Right;
-    glm::vec3 WorldUp;
-    // euler angles
+    glm::vec3 WorldUp;                  // yaw axis
+    // euler angles (degrees), yaw -90 and pitch 0 look down -Z
     float Yaw;
     float Pitch;
     // camera options
@@ -38,20 +42,31 @@ public:
     // constructor with scalar values
     Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch);
 
-    // Returns view matrix
-    glm::mat4 GetViewMatrix();
+    // Returns view matrix of the space centered at origin (render space, see FloatingOrigin). The camera's offset from
+    // the origin is computed in double; the matrix is cached while the offset and the orientation don't change.
+    glm::mat4 GetViewMatrix(const glm::dvec3 &origin = glm::dvec3(0.0));
 
     // Processes input received from any keyboard-like input system
     void ProcessKeyboard(Camera_Movement direction, float deltaTime);
 
-    // Processes input received from a mouse input system
-    void ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch);
+    // Processes input received from a mouse input system (accumulated, no trigonometry)
+    void ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
 
     // Processes input received from a mouse scroll-wheel event
     void ProcessMouseScroll(float yoffset);
 
+    const glm::quat &getOrientation();
+
 private:
-    // Calculate front vector from the updated Euler angles
+    // Derived state, and the inputs it was built from
+    glm::quat  orientation;
+    glm::mat4  view;
+    float      cachedYaw, cachedPitch;
+    glm::vec3  cachedWorldUp;
+    glm::dvec3 cachedOffset;            // Position - origin of the cached view
+    bool       viewValid;
+
+    // Calculate the orientation and its vectors if the Euler angles (or WorldUp) changed
     void updateCameraVectors();
 };
 
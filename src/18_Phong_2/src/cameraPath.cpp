@@ -0,0 +1,232 @@
+#include "cameraPath.hpp"
+#include "camera.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+const unsigned WARM_UP_FRAMES = 10;         // drawn at the first key before the path starts, not measured
+
+double now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 1e3;
+}
+
+// Camera yaw/pitch (degrees) <-> orientation (rotation of the -Z front)
+glm::quat yawPitchToQuat(float yaw, float pitch)
+{
+    return glm::angleAxis(glm::radians(-(yaw + 90.0f)), glm::vec3(0, 1, 0)) * glm::angleAxis(glm::radians(pitch), glm::vec3(1, 0, 0));
+}
+
+// Logarithm of a unit quaternion and exponential of a pure one (w = 0)
+glm::quat quatLog(const glm::quat &q)
+{
+    float angle = std::acos(glm::clamp(q.w, -1.0f, 1.0f));
+    float s = std::sin(angle);
+    float k = s > 1e-6f ? angle / s : 1.0f;
+    return glm::quat(0.0f, q.x * k, q.y * k, q.z * k);
+}
+
+glm::quat quatExp(const glm::quat &q)
+{
+    float angle = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+    float k = angle > 1e-6f ? std::sin(angle) / angle : 1.0f;
+    return glm::quat(std::cos(angle), q.x * k, q.y * k, q.z * k);
+}
+
+// Cubic Hermite between keys i and i + 1 with Catmull-Rom tangents (finite differences over the neighbour keys, scaled
+// by the key times, so uneven key spacing doesn't change the speed abruptly at the keys)
+template<typename T>
+T catmullRom(const std::vector<CameraPath::Key> &keys, T CameraPath::Key::*member, unsigned i, float u)
+{
+    auto tangent = [&](unsigned k)
+    {
+        unsigned a = k ? k - 1 : k, b = std::min<unsigned>(k + 1, (unsigned)keys.size() - 1);
+        return (keys[b].*member - keys[a].*member) / (keys[b].time - keys[a].time);
+    };
+
+    float dt = keys[i + 1].time - keys[i].time;
+    float u2 = u * u, u3 = u2 * u;
+    return (2 * u3 - 3 * u2 + 1) * keys[i].*member + (u3 - 2 * u2 + u) * dt * tangent(i) +
+           (-2 * u3 + 3 * u2) * keys[i + 1].*member + (u3 - u2) * dt * tangent(i + 1);
+}
+
+} // anonymous namespace end
+
+// ----- CameraPath ---------------
+
+bool CameraPath::load(const std::string &path)
+{
+    keys.clear();
+    controls.clear();
+
+    std::ifstream file(path);
+    if(!file.is_open())
+    {
+        std::cout << "ERROR::CAMERAPATH::CANNOT_READ: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for(unsigned lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        line = line.substr(0, line.find('#'));
+        if(line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        std::istringstream in(line);
+        Key key;
+        float yaw, pitch;
+        if(!(in >> key.time >> key.position.x >> key.position.y >> key.position.z >> yaw >> pitch >> key.fov) ||
+           (!keys.empty() && key.time <= keys.back().time))
+        {
+            std::cout << "ERROR::CAMERAPATH::BAD_KEY: " << path << ":" << lineNumber << std::endl;
+            keys.clear();
+            return false;
+        }
+        in >> key.label;
+        if(key.label.empty()) key.label = "key " + std::to_string(keys.size());
+
+        key.orientation = yawPitchToQuat(yaw, pitch);
+        if(!keys.empty() && glm::dot(key.orientation, keys.back().orientation) < 0)
+            key.orientation = -key.orientation;             // same hemisphere as the previous key: shortest turn
+        keys.push_back(key);
+    }
+
+    if(keys.size() < 2)
+    {
+        std::cout << "ERROR::CAMERAPATH::FEWER_THAN_2_KEYS: " << path << std::endl;
+        keys.clear();
+        return false;
+    }
+
+    // Squad control points: s_i = q_i * exp(-(log(q_i^-1 * q_i+1) + log(q_i^-1 * q_i-1)) / 4), the end keys are their own
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        const glm::quat &q = keys[i].orientation;
+        if(i == 0 || i == keys.size() - 1) { controls.push_back(q); continue; }
+
+        glm::quat inverse = glm::conjugate(q);
+        glm::quat sum = quatLog(inverse * keys[i + 1].orientation) + quatLog(inverse * keys[i - 1].orientation);
+        controls.push_back(glm::normalize(q * quatExp(sum * -0.25f)));
+    }
+
+    return true;
+}
+
+unsigned CameraPath::getSegment(float time) const
+{
+    if(keys.size() < 2) return 0;
+    auto next = std::upper_bound(keys.begin() + 1, keys.end() - 1, time, [](float t, const Key &key) { return t < key.time; });
+    return (unsigned)(next - keys.begin()) - 1;
+}
+
+void CameraPath::apply(float time, Camera &cam) const
+{
+    if(keys.empty()) return;
+
+    glm::vec3 position = keys[0].position;
+    glm::quat orientation = keys[0].orientation;
+    float fov = keys[0].fov;
+
+    if(keys.size() > 1)
+    {
+        time = glm::clamp(time, keys.front().time, keys.back().time);
+        unsigned i = getSegment(time);
+        float u = (time - keys[i].time) / (keys[i + 1].time - keys[i].time);
+
+        position = catmullRom(keys, &Key::position, i, u);
+        fov = catmullRom(keys, &Key::fov, i, u);
+
+        // squad(q_i, q_i+1, s_i, s_i+1, u) = slerp(slerp(q_i, q_i+1, u), slerp(s_i, s_i+1, u), 2u(1 - u)). glm::mix
+        // doesn't flip to the shortest arc (that would break the continuity at the keys)
+        glm::quat path = glm::mix(keys[i].orientation, keys[i + 1].orientation, u);
+        glm::quat control = glm::mix(controls[i], controls[i + 1], u);
+        orientation = glm::normalize(glm::mix(path, control, 2 * u * (1 - u)));
+    }
+
+    glm::vec3 front = orientation * glm::vec3(0, 0, -1);
+    cam.Position = position;
+    cam.Yaw   = glm::degrees(std::atan2(front.z, front.x));
+    cam.Pitch = glm::degrees(std::asin(glm::clamp(front.y, -1.0f, 1.0f)));
+    cam.fov   = fov;
+    cam.ProcessMouseMovement(0.0f, 0.0f, true);             // clamps the pitch
+}
+
+// ----- FlyThrough ---------------
+
+FlyThrough::FlyThrough(const CameraPath &path, double timeStep)
+    : path(path), timeStep(timeStep), frame(0), lastEnd(0), segmentTimes(path.getNumSegments())
+{
+    numFrames = WARM_UP_FRAMES + (unsigned)std::ceil(path.getDuration() / timeStep) + 1;
+}
+
+double FlyThrough::getTime() const
+{
+    if(frame < WARM_UP_FRAMES) return 0;
+    return std::min((frame - WARM_UP_FRAMES) * timeStep, (double)path.getDuration());
+}
+
+void FlyThrough::setCamera(Camera &cam) const
+{
+    path.apply((float)getTime(), cam);
+}
+
+void FlyThrough::endFrame()
+{
+    if(done()) return;
+
+    double end = now();
+    if(frame >= WARM_UP_FRAMES && !segmentTimes.empty())
+        segmentTimes[path.getSegment((float)getTime())].push_back(end - lastEnd);
+    lastEnd = end;
+    ++frame;
+}
+
+bool FlyThrough::done() const
+{
+    return frame >= numFrames;
+}
+
+void FlyThrough::report() const
+{
+    struct Row { unsigned segment; double mean, p50, p95, max; size_t frames; };
+    std::vector<Row> rows;
+    std::vector<double> all;
+
+    for(unsigned i = 0; i < segmentTimes.size(); ++i)
+    {
+        std::vector<double> sorted = segmentTimes[i];
+        if(sorted.empty()) continue;
+        std::sort(sorted.begin(), sorted.end());
+        all.insert(all.end(), sorted.begin(), sorted.end());
+
+        double sum = 0;
+        for(double time : sorted) sum += time;
+        rows.push_back({ i, sum / sorted.size(), sorted[(sorted.size() - 1) / 2], sorted[(size_t)((sorted.size() - 1) * 0.95)],
+                         sorted.back(), sorted.size() });
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.mean > b.mean; });
+
+    const std::vector<CameraPath::Key> &keys = path.getKeys();
+    std::cout << "Fly-through: " << all.size() << " frames, " << path.getDuration() << " s of path, step " << timeStep * 1000 <<
+                 " ms. Segments, slowest first (frame time, ms):" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for(const Row &row : rows)
+        std::cout << "    " << std::setw(2) << row.segment << " " << std::setw(12) << keys[row.segment].label << " -> " << std::left <<
+                     std::setw(12) << keys[row.segment + 1].label << std::right << " | " << std::setw(4) << row.frames << " frames | mean " <<
+                     std::setw(7) << row.mean << " | p50 " << std::setw(7) << row.p50 << " | p95 " << std::setw(7) << row.p95 <<
+                     " | max " << std::setw(7) << row.max << std::endl;
+
+    double sum = 0;
+    for(double time : all) sum += time;
+    if(!all.empty())
+        std::cout << "Fly-through: mean " << sum / all.size() << " ms (" << all.size() * 1000 / sum << " fps)" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
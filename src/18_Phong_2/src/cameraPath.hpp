@@ -0,0 +1,66 @@
+#ifndef CAMERAPATH_HPP
+#define CAMERAPATH_HPP
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <string>
+#include <vector>
+
+class Camera;
+
+// Camera animation through a list of keys loaded from a text file, one key per line ('#' starts a comment):
+//      time  x y z  yaw pitch  fov  [label]
+// time in seconds (increasing), yaw/pitch/fov in degrees with the same meaning as in Camera. Between keys, the position
+// follows a Catmull-Rom spline and the orientation a squad (spherical quadrangle) interpolation of the key quaternions,
+// so both are smooth through the keys. Camera has no roll, so the orientation is applied as yaw and pitch.
+class CameraPath
+{
+public:
+    struct Key
+    {
+        float       time;
+        glm::vec3   position;
+        glm::quat   orientation;
+        float       fov;
+        std::string label;
+    };
+
+    bool  load(const std::string &path);               // false (and prints why) if the file can't be used
+
+    void  apply(float time, Camera &cam) const;         // Sets cam to the path position at time (clamped to the path)
+
+    float    getDuration() const { return keys.empty() ? 0 : keys.back().time; }
+    unsigned getNumSegments() const { return keys.size() > 1 ? (unsigned)keys.size() - 1 : 0; }
+    unsigned getSegment(float time) const;              // Segment i goes from key i to key i + 1
+    const std::vector<Key> &getKeys() const { return keys; }
+
+private:
+    std::vector<Key>       keys;
+    std::vector<glm::quat> controls;                    // squad control quaternion of each key
+};
+
+// Timed fly-through of a CameraPath (--flythrough, see main.cpp). The path time advances a fixed step per frame, so each
+// segment always takes the same frames; the frame times (wall clock between endFrame() calls) are collected per segment
+// and report() prints their statistics, slowest segment first, to find the viewpoints that are expensive to draw.
+class FlyThrough
+{
+public:
+    FlyThrough(const CameraPath &path, double timeStep = 1.0 / 60);
+
+    double getTime() const;                             // Path (and animation) time of the current frame
+    void   setCamera(Camera &cam) const;
+
+    void   endFrame();                                  // Call before swapping buffers
+    bool   done() const;
+    void   report() const;
+
+private:
+    const CameraPath &path;
+    double   timeStep;
+    unsigned frame, numFrames;
+    double   lastEnd;
+    std::vector<std::vector<double>> segmentTimes;      // ms
+};
+
+#endif
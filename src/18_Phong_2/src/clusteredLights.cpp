@@ -0,0 +1,163 @@
+#include "clusteredLights.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+#include "frameArena.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+
+const unsigned MIN_LIGHTS_PER_THREAD = 64;     // below this, threads cost more than they save
+
+} // anonymous namespace end
+
+ClusteredLights::ClusteredLights(unsigned tilesX, unsigned tilesY, unsigned slices, unsigned threads)
+    : assignTime(0), tilesX(std::max(tilesX, 1u)), tilesY(std::max(tilesY, 1u)), slices(std::max(slices, 1u)),
+      numThreads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      numLights(0), maxPerCluster(0), nearPlane(0.1f), farPlane(100.0f),
+      grid(2 * numClusters(), 0), sliceLights(this->slices), clusterLights(numClusters())
+{
+    const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+
+    for(unsigned i = 0; i < 3; ++i)
+    {
+        buffers[i] = BufferHandle::generate();
+        textures[i] = TextureHandle::generate();
+        upload(i, nullptr, 0);
+        glState.bindTexture(0, GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+    }
+}
+
+void ClusteredLights::update(const std::vector<PointLight> &lights, const glm::mat4 &view, float fovy, float aspect, float nearDistance, float farDistance)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    nearPlane = nearDistance;
+    farPlane = farDistance;
+    numLights = (unsigned)lights.size();
+
+    float tanHalfY = std::tan(fovy / 2.0f);
+    float tanHalfX = tanHalfY * aspect;
+    float sliceScale = slices / std::log(farPlane / nearPlane);
+
+    // Light data and view space bounding spheres (x, y, distance along the view direction, radius)
+    lightData.resize(2 * lights.size());
+    std::pmr::vector<glm::vec4> viewSpheres(lights.size(), frameArena.resource());
+
+    for(std::vector<unsigned> &list : sliceLights) list.clear();
+
+    for(unsigned i = 0; i < lights.size(); ++i)
+    {
+        const PointLight &light = lights[i];
+        lightData[2 * i]     = glm::vec4(light.position, light.radius);
+        lightData[2 * i + 1] = glm::vec4(light.color * light.intensity, 0.0f);
+
+        glm::vec3 pos = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        viewSpheres[i] = glm::vec4(pos.x, pos.y, -pos.z, light.radius);
+
+        // Depth slices touched
+        float minDepth = -pos.z - light.radius, maxDepth = -pos.z + light.radius;
+        if(maxDepth < nearPlane || minDepth > farPlane) continue;
+
+        int first = (int)(std::log(std::max(minDepth, nearPlane) / nearPlane) * sliceScale);
+        int last  = (int)(std::log(std::min(maxDepth, farPlane) / nearPlane) * sliceScale);
+        first = std::max(first, 0);
+        last  = std::min(last, (int)slices - 1);
+        for(int s = first; s <= last; ++s) sliceLights[s].push_back(i);
+    }
+
+    // Screen tiles touched, one range of slices per thread (each thread only writes the clusters of its slices)
+    unsigned threads = std::min(numThreads, std::max(1u, numLights / MIN_LIGHTS_PER_THREAD));
+    threads = std::min(threads, slices);
+
+    if(threads <= 1) assignSlices(0, slices, viewSpheres, tanHalfX, tanHalfY);
+    else
+    {
+        std::vector<std::thread> pool;
+        for(unsigned t = 0; t < threads; ++t)
+            pool.emplace_back(&ClusteredLights::assignSlices, this, slices * t / threads, slices * (t + 1) / threads,
+                              std::cref(viewSpheres), tanHalfX, tanHalfY);
+        for(std::thread &thread : pool) thread.join();
+    }
+
+    // Compact the lists: grid (offset, count) + indices
+    indices.clear();
+    maxPerCluster = 0;
+    for(unsigned c = 0; c < clusterLights.size(); ++c)
+    {
+        grid[2 * c]     = (unsigned)indices.size();
+        grid[2 * c + 1] = (unsigned)clusterLights[c].size();
+        maxPerCluster = std::max(maxPerCluster, grid[2 * c + 1]);
+        indices.insert(indices.end(), clusterLights[c].begin(), clusterLights[c].end());
+    }
+
+    assignTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+
+    upload(0, lightData.data(), lightData.size() * sizeof(glm::vec4));
+    upload(1, grid.data(), grid.size() * sizeof(unsigned));
+    upload(2, indices.data(), indices.size() * sizeof(unsigned));
+}
+
+void ClusteredLights::assignSlices(unsigned firstSlice, unsigned lastSlice, const std::pmr::vector<glm::vec4> &viewSpheres, float tanHalfX, float tanHalfY)
+{
+    for(unsigned s = firstSlice; s < lastSlice; ++s)
+    {
+        for(unsigned c = s * tilesX * tilesY; c < (s + 1) * tilesX * tilesY; ++c)
+            clusterLights[c].clear();
+
+        float sliceNear = nearPlane * std::pow(farPlane / nearPlane, (float)s / slices);
+        float sliceFar  = nearPlane * std::pow(farPlane / nearPlane, (float)(s + 1) / slices);
+
+        for(unsigned i : sliceLights[s])
+        {
+            const glm::vec4 &sphere = viewSpheres[i];
+
+            // Part of the sphere's bounding box inside the slice, projected to NDC (x / depth is monotonic in depth)
+            float d0 = std::max(sliceNear, sphere.z - sphere.w);
+            float d1 = std::min(sliceFar,  sphere.z + sphere.w);
+
+            float minX = std::min((sphere.x - sphere.w) / d0, (sphere.x - sphere.w) / d1) / tanHalfX;
+            float maxX = std::max((sphere.x + sphere.w) / d0, (sphere.x + sphere.w) / d1) / tanHalfX;
+            float minY = std::min((sphere.y - sphere.w) / d0, (sphere.y - sphere.w) / d1) / tanHalfY;
+            float maxY = std::max((sphere.y + sphere.w) / d0, (sphere.y + sphere.w) / d1) / tanHalfY;
+            if(maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) continue;
+
+            int x0 = std::max(0, (int)((minX * 0.5f + 0.5f) * tilesX)), x1 = std::min((int)tilesX - 1, (int)((maxX * 0.5f + 0.5f) * tilesX));
+            int y0 = std::max(0, (int)((minY * 0.5f + 0.5f) * tilesY)), y1 = std::min((int)tilesY - 1, (int)((maxY * 0.5f + 0.5f) * tilesY));
+
+            for(int y = y0; y <= y1; ++y)
+                for(int x = x0; x <= x1; ++x)
+                    clusterLights[(s * tilesY + y) * tilesX + x].push_back(i);
+        }
+    }
+}
+
+void ClusteredLights::upload(unsigned i, const void *data, size_t size)
+{
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, buffers[i]);
+    gpuMemory.bufferData(buffers[i], GL_COPY_WRITE_BUFFER, std::max(size, (size_t)16), nullptr, GL_STREAM_DRAW, "clustered lights");   // orphan (texture buffers can't be empty)
+    if(data && size) glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+}
+
+void ClusteredLights::bind(const Shader &program, unsigned firstUnit) const
+{
+    const char *samplers[3] = { "lightData", "clusterGrid", "lightIndices" };
+
+    for(unsigned i = 0; i < 3; ++i)
+    {
+        glState.bindTexture(firstUnit + i, GL_TEXTURE_BUFFER, textures[i]);
+        program.setInt(samplers[i], firstUnit + i);
+    }
+
+    float sliceScale = slices / std::log(farPlane / nearPlane);
+    glUniform3i(glGetUniformLocation(program.ID, "clusterDims"), tilesX, tilesY, slices);
+    program.setFloat("sliceScale", sliceScale);
+    program.setFloat("sliceBias", -std::log(nearPlane) * sliceScale);
+    program.setInt("numLights", numLights);
+}
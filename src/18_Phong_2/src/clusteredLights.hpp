@@ -0,0 +1,67 @@
+#ifndef CLUSTEREDLIGHTS_HPP
+#define CLUSTEREDLIGHTS_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+#include "glHandle.hpp"
+
+#include <memory_resource>
+#include <vector>
+
+class Shader;
+
+struct PointLight
+{
+    glm::vec3 position;             // world space
+    float     radius;               // the light has no effect beyond this distance
+    glm::vec3 color;
+    float     intensity;
+};
+
+// Clustered forward shading. The view frustum is split in froxels (tilesX x tilesY screen tiles x slices exponential
+// depth slices) and each light is assigned to the froxels its bounding sphere touches (CPU, multithreaded: each thread
+// fills a range of slices). Lights, per cluster (offset, count) and light indices are uploaded to texture buffers, so
+// it works with GL 3.3. The fragment shader (clusteredFragS.fs) only loops over the lights of its cluster.
+class ClusteredLights
+{
+public:
+    ClusteredLights(unsigned tilesX = 16, unsigned tilesY = 9, unsigned slices = 24, unsigned threads = 0);
+
+    ClusteredLights(const ClusteredLights &) = delete;
+    ClusteredLights &operator=(const ClusteredLights &) = delete;
+
+    // Assign lights to clusters and upload the result. Same frustum as glm::perspective(fovy, aspect, nearPlane, farPlane).
+    void update(const std::vector<PointLight> &lights, const glm::mat4 &view, float fovy, float aspect, float nearPlane, float farPlane);
+
+    // Bind the 3 texture buffers to firstUnit, firstUnit + 1, firstUnit + 2 and set the uniforms of clusteredFragS.fs
+    void bind(const Shader &program, unsigned firstUnit = 0) const;
+
+    unsigned numClusters() const { return tilesX * tilesY * slices; }
+    size_t   numLightIndices() const { return indices.size(); }
+    unsigned maxLightsPerCluster() const { return maxPerCluster; }
+
+    double   assignTime;            // ms spent in the CPU assignment of the last update()
+
+private:
+    unsigned tilesX, tilesY, slices, numThreads;
+    unsigned numLights, maxPerCluster;
+    float    nearPlane, farPlane;
+
+    std::vector<glm::vec4>              lightData;      // per light: position + radius, color * intensity
+    std::vector<unsigned>               grid;           // per cluster: offset, count
+    std::vector<unsigned>               indices;        // light indices, grouped by cluster
+    std::vector<std::vector<unsigned>>  sliceLights;    // lights touching each slice
+    std::vector<std::vector<unsigned>>  clusterLights;  // lights of each cluster (reused every frame)
+
+    BufferHandle  buffers[3];                           // lights (RGBA32F), grid (RG32UI), indices (R32UI)
+    TextureHandle textures[3];
+
+    void assignSlices(unsigned firstSlice, unsigned lastSlice, const std::pmr::vector<glm::vec4> &viewSpheres, float tanHalfX, float tanHalfY);
+    void upload(unsigned i, const void *data, size_t size);
+};
+
+#endif
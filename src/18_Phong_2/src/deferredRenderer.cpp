@@ -0,0 +1,78 @@
+#include "deferredRenderer.hpp"
+#include "clusteredLights.hpp"
+#include "shadowMaps.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+
+namespace
+{
+
+const std::string shadersDir = "../../../src/18_Phong_2/shaders/";
+
+const unsigned GBUFFER_FIRST_UNIT = 8;          // G-buffer textures: units 8..10. Cluster data: 11..13. Shadow map: 14.
+
+} // anonymous namespace end
+
+DeferredRenderer::DeferredRenderer()
+    : emptyVAO(VertexArrayHandle::generate())
+{
+    lightingProgram = new Shader((shadersDir + "fullscreenVS.vs").c_str(), (shadersDir + "deferredLightingFragS.fs").c_str(), "",
+                                 CascadedShadowMaps::shaderPrelude(shadersDir));
+
+    glState.useProgram(lightingProgram->ID);
+    lightingProgram->setInt("gAlbedoSpecular",   GBUFFER_FIRST_UNIT);
+    lightingProgram->setInt("gNormalShininess",  GBUFFER_FIRST_UNIT + 1);
+    lightingProgram->setInt("gDepth",            GBUFFER_FIRST_UNIT + 2);
+
+    // Samplers of different types can't share a unit, even unused ones
+    lightingProgram->setInt("lightData",         GBUFFER_FIRST_UNIT + 3);
+    lightingProgram->setInt("clusterGrid",       GBUFFER_FIRST_UNIT + 4);
+    lightingProgram->setInt("lightIndices",      GBUFFER_FIRST_UNIT + 5);
+    lightingProgram->setInt("shadowMap",         GBUFFER_FIRST_UNIT + 6);
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    delete lightingProgram;
+}
+
+void DeferredRenderer::beginGeometryPass()
+{
+    glState.enable(GL_DEPTH_TEST);
+    glState.depthMask(true);
+    glState.clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+void DeferredRenderer::lightingPass(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &camPos,
+                                    const glm::vec3 &lightPos, const glm::vec3 &lightColor, const GBuffer &gbuffer,
+                                    const ClusteredLights *clusters, const CascadedShadowMaps *shadows)
+{
+    glState.useProgram(lightingProgram->ID);
+    glState.bindTexture(GBUFFER_FIRST_UNIT,     GL_TEXTURE_2D, gbuffer.albedoSpecular);
+    glState.bindTexture(GBUFFER_FIRST_UNIT + 1, GL_TEXTURE_2D, gbuffer.normalShininess);
+    glState.bindTexture(GBUFFER_FIRST_UNIT + 2, GL_TEXTURE_2D, gbuffer.depthStencil);
+
+    lightingProgram->setMat4("invView", glm::inverse(view));
+    lightingProgram->setMat4("invProjection", glm::inverse(projection));
+    lightingProgram->setVec3("camPos", camPos);
+    lightingProgram->setVec3("lightPos", lightPos);
+    lightingProgram->setVec3("lightColor", lightColor);
+    lightingProgram->setBool("useClusters", clusters != nullptr);
+    if(clusters) clusters->bind(*lightingProgram, GBUFFER_FIRST_UNIT + 3);
+    if(shadows) shadows->bind(*lightingProgram, GBUFFER_FIRST_UNIT + 6);
+    else lightingProgram->setBool("shadowsEnabled", false);
+
+    glState.disable(GL_DEPTH_TEST);             // every pixel is shaded once; background pixels are discarded
+    glState.bindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glState.enable(GL_DEPTH_TEST);
+}
+
+void DeferredRenderer::copyDepth(unsigned gbufferFBO, int width, int height)
+{
+    glState.bindFramebuffer(GL_READ_FRAMEBUFFER, gbufferFBO);
+    glState.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
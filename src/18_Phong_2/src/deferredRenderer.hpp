@@ -0,0 +1,57 @@
+#ifndef DEFERREDRENDERER_HPP
+#define DEFERREDRENDERER_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+#include "glHandle.hpp"
+
+class Shader;
+class ClusteredLights;
+class CascadedShadowMaps;
+
+// Deferred shading. The geometry pass (programs using gbufferFragS.fs) writes a compact G-buffer:
+//      RT0  RGBA8      albedo, specular strength
+//      RT1  RGB10_A2   octahedral normal (rg), shininess / 256 (b)
+//      D24S8           depth (the position is reconstructed from it)
+// i.e. 12 bytes per pixel. The lighting pass is a full screen triangle that shades every pixel once, either with a
+// single Phong light (as lightingFragS.fs) or with the point lights of the screen tile/depth cluster (as clusteredFragS.fs).
+// The G-buffer targets are transient textures of the render graph (see main.cpp), created with the formats below.
+class DeferredRenderer
+{
+public:
+    static const GLenum ALBEDO_FORMAT = GL_RGBA8, NORMAL_FORMAT = GL_RGB10_A2, DEPTH_FORMAT = GL_DEPTH24_STENCIL8;
+
+    struct GBuffer
+    {
+        unsigned albedoSpecular, normalShininess, depthStencil;
+    };
+
+    DeferredRenderer();
+    ~DeferredRenderer();
+
+    DeferredRenderer(const DeferredRenderer &) = delete;
+    DeferredRenderer &operator=(const DeferredRenderer &) = delete;
+
+    void beginGeometryPass();                   // Clear the bound G-buffer, depth state for the geometry
+
+    // Shade the G-buffer into the bound framebuffer. clusters: point lights (nullptr: lightPos/lightColor Phong light).
+    // shadows: adds the shadowed directional light.
+    void lightingPass(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &camPos,
+                      const glm::vec3 &lightPos, const glm::vec3 &lightColor, const GBuffer &gbuffer,
+                      const ClusteredLights *clusters = nullptr, const CascadedShadowMaps *shadows = nullptr);
+
+    // G-buffer depth (framebuffer gbufferFBO) -> default framebuffer, so forward passes can follow
+    void copyDepth(unsigned gbufferFBO, int width, int height);
+
+    unsigned bytesPerPixel() const { return 12; }
+
+private:
+    VertexArrayHandle emptyVAO;                 // core profile needs a VAO even without attributes
+    Shader           *lightingProgram;
+};
+
+#endif
@@ -0,0 +1,13 @@
+#include "floatingOrigin.hpp"
+
+FloatingOrigin::FloatingOrigin(double rebaseDistance) : origin(0.0), rebaseDistance(rebaseDistance), rebases(0) { }
+
+bool FloatingOrigin::update(const glm::dvec3 &camera)
+{
+    if(rebaseDistance < 0 || camera == origin) return false;
+    if(rebaseDistance > 0 && glm::length(camera - origin) < rebaseDistance) return false;
+
+    origin = camera;
+    ++rebases;
+    return true;
+}
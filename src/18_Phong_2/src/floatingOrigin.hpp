@@ -0,0 +1,32 @@
+#ifndef FLOATINGORIGIN_HPP
+#define FLOATINGORIGIN_HPP
+
+#include "glm/glm.hpp"
+
+// World positions are doubles (glm::dvec3); the renderer works in floats relative to an origin that follows the camera
+// ("render space" = world - origin, subtracted in double before the conversion to float). Far from the world origin
+// (10^5 - 10^6 m) float world coordinates only have centimeters to decimeters of resolution and the image jitters; near
+// the floating origin they keep full precision.
+//  - rebaseDistance 0: the origin is the camera position every frame (camera-relative rendering)
+//  - rebaseDistance > 0: the origin jumps to the camera when the camera gets further than that (floating origin rebasing)
+//  - rebaseDistance < 0: the origin stays at the world origin (plain float world space, for comparison)
+// Data in render space that is kept across frames must be re-derived after a rebase (update() returns true).
+class FloatingOrigin
+{
+public:
+    FloatingOrigin(double rebaseDistance = 0);
+
+    bool update(const glm::dvec3 &camera);              // Call once per frame, before using the origin; true if it moved
+
+    const glm::dvec3 &get() const { return origin; }
+    unsigned getRebases() const { return rebases; }
+
+    glm::vec3 toRender(const glm::dvec3 &world) const { return glm::vec3(world - origin); }
+
+private:
+    glm::dvec3 origin;
+    double     rebaseDistance;
+    unsigned   rebases;
+};
+
+#endif
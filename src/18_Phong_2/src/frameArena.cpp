@@ -0,0 +1,87 @@
+#include "frameArena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <new>
+
+FrameArena frameArena;
+
+FrameArena::FrameArena(size_t size)
+    : current(0), adapter(*this), renderThread(std::this_thread::get_id())
+{
+    for(Buffer &buffer : buffers)
+    {
+        buffer.data = new unsigned char[size];
+        buffer.size = size;
+    }
+}
+
+FrameArena::~FrameArena()
+{
+    for(Buffer &buffer : buffers)
+    {
+        for(const Block &block : buffer.overflow) ::operator delete(block.data, std::align_val_t(block.alignment));
+        delete[] buffer.data;
+    }
+}
+
+void FrameArena::beginFrame()
+{
+    if(std::this_thread::get_id() != renderThread)
+        std::cout << "ERROR::FRAMEARENA::NOT_RENDER_THREAD" << std::endl;
+
+    // The biggest frame so far sets the size of every buffer
+    size_t peak = buffers[current].needed;
+    for(const Buffer &buffer : buffers) peak = std::max(peak, buffer.size);
+
+    lastStats = stats;
+    stats = Stats();
+    current = (current + 1) % FRAME_ARENA_BUFFERS;
+
+    Buffer &buffer = buffers[current];
+    for(const Block &block : buffer.overflow) ::operator delete(block.data, std::align_val_t(block.alignment));
+    buffer.overflow.clear();
+
+    if(buffer.size < peak)
+    {
+        size_t size = buffer.size;
+        while(size < peak) size *= 2;
+        delete[] buffer.data;
+        buffer.data = new unsigned char[size];
+        buffer.size = size;
+        ++stats.heapAllocations;
+    }
+    buffer.used = buffer.needed = 0;
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    Buffer &buffer = buffers[current];
+    ++stats.allocations;
+
+    size_t padding = (alignment - (uintptr_t)(buffer.data + buffer.used) % alignment) % alignment;
+    if(buffer.used + padding + bytes <= buffer.size)
+    {
+        void *data = buffer.data + buffer.used + padding;
+        buffer.used += padding + bytes;
+        buffer.needed += padding + bytes;
+        stats.bytes += padding + bytes;
+        return data;
+    }
+
+    // Full: from the heap, until the buffer grows
+    void *data = ::operator new(bytes, std::align_val_t(alignment));
+    buffer.overflow.push_back({ data, alignment });
+    buffer.needed += bytes + alignment;
+    stats.bytes += bytes;
+    ++stats.heapAllocations;
+    return data;
+}
+
+size_t FrameArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for(const Buffer &buffer : buffers) capacity += buffer.size;
+    return capacity;
+}
@@ -0,0 +1,78 @@
+#ifndef FRAMEARENA_HPP
+#define FRAMEARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#define FRAME_ARENA_SIZE    (256 * 1024)    // initial bytes of each buffer
+#define FRAME_ARENA_BUFFERS 2               // an allocation is valid during its frame and the next one
+
+// Linear allocator for the data that only lives for a frame (draw lists, culling results, matrices, render graph
+// nodes...). allocate() bumps a pointer; nothing is freed individually: beginFrame() switches to the next buffer and
+// resets it. The buffers are used in turns, so what a frame allocated is still valid while the next one is built
+// (e.g. handed to another thread, or read by the overlay of the next frame). When a buffer is full, the allocation
+// comes from the heap, and the buffer grows before its next use to what that frame needed; after the first frames, a
+// frame makes no heap allocations (getFrameStats().heapAllocations is 0).
+// Standard containers use it through resource():
+//      std::pmr::vector<DrawItem> items(frameArena.resource());
+// Render thread only.
+class FrameArena
+{
+public:
+    struct Stats
+    {
+        unsigned allocations = 0;
+        size_t   bytes = 0;                     // including alignment
+        unsigned heapAllocations = 0;           // overflow blocks and buffer growth
+    };
+
+    explicit FrameArena(size_t size = FRAME_ARENA_SIZE);
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void  beginFrame();                         // Next buffer: the allocations of FRAME_ARENA_BUFFERS frames ago are gone
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    std::pmr::memory_resource *resource() { return &adapter; }     // deallocate() does nothing
+
+    const Stats &getFrameStats() const { return lastStats; }       // Last complete frame
+    size_t getCapacity() const;                                     // All the buffers
+
+private:
+    class Resource : public std::pmr::memory_resource
+    {
+    public:
+        explicit Resource(FrameArena &arena) : arena(arena) { }
+
+    private:
+        FrameArena &arena;
+
+        void *do_allocate(size_t bytes, size_t alignment) override { return arena.allocate(bytes, alignment); }
+        void  do_deallocate(void *, size_t, size_t) override { }
+        bool  do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+    };
+
+    struct Block { void *data; size_t alignment; };
+
+    struct Buffer
+    {
+        unsigned char     *data = nullptr;
+        size_t             size = 0, used = 0;
+        size_t             needed = 0;          // bytes of the frame, including the overflow
+        std::vector<Block> overflow;            // heap blocks, when data was full
+    };
+
+    Buffer          buffers[FRAME_ARENA_BUFFERS];
+    unsigned        current;
+    Resource        adapter;
+    Stats           stats, lastStats;
+    std::thread::id renderThread;
+};
+
+extern FrameArena frameArena;
+
+#endif
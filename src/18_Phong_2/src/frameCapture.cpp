@@ -0,0 +1,346 @@
+#include "frameCapture.hpp"
+#include "regressionTest.hpp"       // writePNG()
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAPTURE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+// Full range BT.601 in 8 bit fixed point (x 256)
+const int Y_R =  77, Y_G =  150, Y_B =  29;
+const int U_R = -43, U_G = -85,  U_B = 128;
+const int V_R = 128, V_G = -107, V_B = -21;
+
+unsigned char clampByte(int value)
+{
+    return (unsigned char)std::min(255, std::max(0, value));
+}
+
+// Scalar conversion of the pixels [x0, x1) of a row pair (x0, x1 even). row0 is the output row above row1.
+void convertScalar(const unsigned char *row0, const unsigned char *row1, int x0, int x1, unsigned char *y0, unsigned char *y1, unsigned char *u, unsigned char *v)
+{
+    for(int x = x0; x < x1; x += 2)
+    {
+        int r = 0, g = 0, b = 0;
+        for(int k = 0; k < 2; ++k)
+        {
+            const unsigned char *p0 = row0 + 4 * (x + k), *p1 = row1 + 4 * (x + k);
+            y0[x + k] = (unsigned char)((Y_R * p0[0] + Y_G * p0[1] + Y_B * p0[2] + 128) >> 8);
+            y1[x + k] = (unsigned char)((Y_R * p1[0] + Y_G * p1[1] + Y_B * p1[2] + 128) >> 8);
+            r += p0[0] + p1[0];
+            g += p0[1] + p1[1];
+            b += p0[2] + p1[2];
+        }
+        u[x / 2] = clampByte(128 + ((U_R * r + U_G * g + U_B * b + 512) >> 10));      // 4 pixels: >> (8 + 2)
+        v[x / 2] = clampByte(128 + ((V_R * r + V_G * g + V_B * b + 512) >> 10));
+    }
+}
+
+#ifdef CAPTURE_SSE2
+void store4(unsigned char *dst, __m128i bytes)      // lowest 4 bytes, unaligned
+{
+    int value = _mm_cvtsi128_si32(bytes);
+    std::memcpy(dst, &value, 4);
+}
+
+// Dot product of each RGBA pixel (4 pixels, 16 bit channels in a and b: pixels 0-1 and 2-3) with coefficients
+__m128i dot4(__m128i a, __m128i b, __m128i coefficients)
+{
+    __m128 ma = _mm_castsi128_ps(_mm_madd_epi16(a, coefficients));      // [p0 rg, p0 ba, p1 rg, p1 ba]
+    __m128 mb = _mm_castsi128_ps(_mm_madd_epi16(b, coefficients));
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(ma, mb, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd  = _mm_castps_si128(_mm_shuffle_ps(ma, mb, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+// 8 pixels of 2 rows per iteration: 16 Y and 4 U + 4 V samples. Returns the first pixel not converted.
+int convertSSE2(const unsigned char *row0, const unsigned char *row1, int width, unsigned char *y0, unsigned char *y1, unsigned char *u, unsigned char *v)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i coefY = _mm_setr_epi16(Y_R, Y_G, Y_B, 0, Y_R, Y_G, Y_B, 0);
+    const __m128i coefU = _mm_setr_epi16(U_R, U_G, U_B, 0, U_R, U_G, U_B, 0);
+    const __m128i coefV = _mm_setr_epi16(V_R, V_G, V_B, 0, V_R, V_G, V_B, 0);
+    const __m128i roundY = _mm_set1_epi32(128), roundC = _mm_set1_epi32(512), offsetC = _mm_set1_epi32(128);
+
+    int x = 0;
+    for(; x + 8 <= width; x += 8)
+    {
+        __m128i sums[2];            // 2 x 2 blocks: channel sums of pixel pairs of both rows, 16 bit
+        for(int half = 0; half < 2; ++half)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(row0 + 4 * (x + 4 * half)));
+            __m128i b = _mm_loadu_si128((const __m128i *)(row1 + 4 * (x + 4 * half)));
+            __m128i aLo = _mm_unpacklo_epi8(a, zero), aHi = _mm_unpackhi_epi8(a, zero);
+            __m128i bLo = _mm_unpacklo_epi8(b, zero), bHi = _mm_unpackhi_epi8(b, zero);
+
+            __m128i lumaA = _mm_srai_epi32(_mm_add_epi32(dot4(aLo, aHi, coefY), roundY), 8);
+            __m128i lumaB = _mm_srai_epi32(_mm_add_epi32(dot4(bLo, bHi, coefY), roundY), 8);
+            __m128i luma = _mm_packus_epi16(_mm_packs_epi32(lumaA, lumaB), zero);
+            store4(y0 + x + 4 * half, luma);
+            store4(y1 + x + 4 * half, _mm_srli_si128(luma, 4));
+
+            __m128i lo = _mm_add_epi16(aLo, bLo), hi = _mm_add_epi16(aHi, bHi);      // [p0, p1], [p2, p3]
+            sums[half] = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));    // [p0 + p1, p2 + p3]
+        }
+
+        __m128i chromaU = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(dot4(sums[0], sums[1], coefU), roundC), 10), offsetC);
+        __m128i chromaV = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(dot4(sums[0], sums[1], coefV), roundC), 10), offsetC);
+        __m128i chroma = _mm_packus_epi16(_mm_packs_epi32(chromaU, chromaV), zero);
+        store4(u + x / 2, chroma);
+        store4(v + x / 2, _mm_srli_si128(chroma, 4));
+    }
+    return x;
+}
+#endif
+
+double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+}
+
+} // anonymous namespace end
+
+void rgbaToYUV420(const unsigned char *rgba, int width, int height, unsigned char *y, unsigned char *u, unsigned char *v)
+{
+    int evenWidth = width & ~1, evenHeight = height & ~1;
+    size_t stride = (size_t)width * 4;
+
+    for(int row = 0; row < evenHeight; row += 2)
+    {
+        const unsigned char *row0 = rgba + (height - 1 - row) * stride;     // flipped: the first output row is the top one
+        const unsigned char *row1 = row0 - stride;
+        unsigned char *y0 = y + (size_t)row * evenWidth, *y1 = y0 + evenWidth;
+        unsigned char *uRow = u + (size_t)(row / 2) * (evenWidth / 2), *vRow = v + (size_t)(row / 2) * (evenWidth / 2);
+
+        int x = 0;
+#ifdef CAPTURE_SSE2
+        x = convertSSE2(row0, row1, evenWidth, y0, y1, uRow, vRow);
+#endif
+        convertScalar(row0, row1, x, evenWidth, y0, y1, uRow, vRow);
+    }
+}
+
+// ----- FrameCapture ---------------
+
+FrameCapture::FrameCapture(const std::string &path, unsigned fps, unsigned numSlots, bool allowPersistent)
+    : path(path), persistent(false), finished(false), fps(std::max(fps, 1u)), frameCounter(0), width(0), height(0),
+      slots(std::max(numSlots, 2u)), nextSlot(0), stopping(false), captured(0), dropped(0), renderTime(0), written(0), encodeMicroseconds(0)
+{
+    y4m = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLAD
+    persistent = allowPersistent && GLAD_GL_VERSION_4_4;
+#elif IMGUI_IMPL_OPENGL_LOADER_GLEW
+    persistent = allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+#endif
+
+    for(Slot &slot : slots)
+    {
+        slot.pbo = 0;
+        slot.fence = nullptr;
+        slot.frame = 0;
+        slot.mapped = nullptr;
+        slot.state = FREE;
+    }
+
+    if(y4m)
+    {
+        output.open(path, std::ios::binary);
+        if(!output.is_open()) std::cout << "ERROR::FRAMECAPTURE::CANNOT_WRITE: " << path << std::endl;
+    }
+
+    worker = std::thread(&FrameCapture::work, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    finish();
+
+    for(Slot &slot : slots)
+    {
+        if(!slot.pbo) continue;
+        if(slot.mapped)
+        {
+            glState.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glDeleteBuffers(1, &slot.pbo);
+        glState.deletedBuffer(slot.pbo);
+        gpuMemory.deletedBuffer(slot.pbo);
+    }
+    glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::allocate(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    size_t size = (size_t)width * height * 4;
+
+    for(Slot &slot : slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if(persistent)
+        {
+            GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            gpuMemory.bufferStorage(slot.pbo, GL_PIXEL_PACK_BUFFER, size, nullptr, flags | GL_CLIENT_STORAGE_BIT, "frame capture");
+            slot.mapped = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags);
+        }
+        else
+        {
+            gpuMemory.bufferData(slot.pbo, GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ, "frame capture");
+            slot.copy.resize(size);
+        }
+    }
+    glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if(y4m && output.is_open())
+        output << "YUV4MPEG2 W" << (width & ~1) << " H" << (height & ~1) << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+}
+
+void FrameCapture::capture(int width, int height)
+{
+    if(finished || width <= 0 || height <= 0) return;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if(!this->width) allocate(width, height);
+    handOver(false);
+
+    Slot &slot = slots[nextSlot];
+    if(width != this->width || height != this->height || slot.state != FREE)
+        ++dropped;
+    else
+    {
+        slot.frame = frameCounter;
+        glState.bindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.state = READING;
+        nextSlot = (nextSlot + 1) % slots.size();
+        ++captured;
+    }
+    ++frameCounter;
+
+    renderTime += elapsedMs(start);
+}
+
+void FrameCapture::handOver(bool wait)
+{
+    // Slots are filled in ring order, so they complete in ring order too: start from the oldest
+    for(unsigned i = 0; i < slots.size(); ++i)
+    {
+        Slot &slot = slots[(nextSlot + i) % slots.size()];
+        if(slot.state != READING) continue;
+
+        GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 10000000000ull : 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        if(!persistent)
+        {
+            glState.bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            const void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.copy.size(), GL_MAP_READ_BIT);
+            if(data) std::memcpy(slot.copy.data(), data, slot.copy.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        slot.state = QUEUED;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back((unsigned)(&slot - slots.data()));
+        }
+        wake.notify_one();
+    }
+}
+
+void FrameCapture::work()
+{
+    std::vector<unsigned char> buffer;
+    for(;;)
+    {
+        unsigned index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if(queue.empty()) return;           // stopping and nothing left
+            index = queue.front();
+            queue.pop_front();
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        writeFrame(slots[index], buffer);
+        encodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        ++written;
+
+        slots[index].state = FREE;
+    }
+}
+
+void FrameCapture::writeFrame(const Slot &slot, std::vector<unsigned char> &buffer)
+{
+    const unsigned char *rgba = persistent ? slot.mapped : slot.copy.data();
+    if(!rgba) return;
+
+    if(y4m)
+    {
+        size_t lumaSize = (size_t)(width & ~1) * (height & ~1);
+        buffer.resize(lumaSize * 3 / 2);
+        rgbaToYUV420(rgba, width, height, buffer.data(), buffer.data() + lumaSize, buffer.data() + lumaSize * 5 / 4);
+        output << "FRAME\n";
+        output.write((const char *)buffer.data(), buffer.size());
+        return;
+    }
+
+    size_t rowSize = (size_t)width * 4;
+    buffer.resize(rowSize * height);
+    for(int y = 0; y < height; ++y)
+        std::memcpy(&buffer[(height - 1 - y) * rowSize], rgba + y * rowSize, rowSize);
+    for(size_t i = 3; i < buffer.size(); i += 4) buffer[i] = 255;
+
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%06u.png", slot.frame);
+    if(!writePNG(path + number, width, height, buffer.data(), false))        // stored: keeps up with the render loop
+        std::cout << "ERROR::FRAMECAPTURE::CANNOT_WRITE: " << path + number << std::endl;
+}
+
+void FrameCapture::finish()
+{
+    if(finished) return;
+    finished = true;
+
+    handOver(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    output.close();
+}
+
+FrameCapture::Stats FrameCapture::getStats() const
+{
+    Stats stats;
+    stats.captured   = captured;
+    stats.dropped    = dropped;
+    stats.written    = written;
+    stats.renderTime = captured ? renderTime / captured : 0;
+    stats.encodeTime = written ? encodeMicroseconds / 1e3 / written : 0;
+    return stats;
+}
@@ -0,0 +1,93 @@
+#ifndef FRAMECAPTURE_HPP
+#define FRAMECAPTURE_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records the default framebuffer without stalling the render loop. capture() starts an asynchronous glReadPixels into
+// the next free pixel pack buffer of a ring and fences it; later calls hand the slots whose fence signaled to a worker
+// thread, which converts and writes them:
+//  - .y4m path: raw YUV 4:2:0 video (full range BT.601, SSE2 conversion), playable/encodable with ffmpeg, mpv...
+//  - any other path: image sequence <path>_000000.png...
+// GL 4.4+: the slots are persistently mapped and the worker reads them in place, so the render thread only issues the
+// readback. GL 3.3: the render thread maps the slot and copies it out. If every slot is busy, the frame is dropped.
+// The frame size is fixed by the first capture (frames of a different size are dropped; odd sizes lose a row/column in Y4M).
+class FrameCapture
+{
+public:
+    struct Stats
+    {
+        unsigned captured;          // readbacks issued
+        unsigned dropped;           // no free slot, or different size
+        unsigned written;           // frames converted and written by the worker
+        double   renderTime;        // ms per captured frame on the render thread (mean)
+        double   encodeTime;        // ms per written frame on the worker thread (mean)
+    };
+
+    FrameCapture(const std::string &path, unsigned fps = 30, unsigned numSlots = 4, bool allowPersistent = true);
+    ~FrameCapture();                // finish()
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    void  capture(int width, int height);       // Call after rendering the frame, before swapping buffers
+    void  finish();                             // Waits for the pending frames and closes the output
+
+    Stats getStats() const;
+    bool  isPersistent() const { return persistent; }
+
+private:
+    enum SlotState { FREE, READING, QUEUED };
+
+    struct Slot
+    {
+        unsigned              pbo;
+        GLsync                fence;
+        unsigned              frame;
+        const unsigned char  *mapped;           // persistent path
+        std::vector<unsigned char> copy;        // fallback path
+        std::atomic<int>      state;
+    };
+
+    std::string path;
+    bool        y4m, persistent, finished;
+    unsigned    fps, frameCounter;
+    int         width, height;
+    std::vector<Slot> slots;
+    unsigned    nextSlot;
+
+    std::ofstream output;
+    std::thread   worker;
+    std::mutex    mutex;
+    std::condition_variable wake;
+    std::deque<unsigned> queue;                 // slots ready for the worker, in capture order
+    bool          stopping;
+
+    unsigned captured, dropped;
+    double   renderTime;
+    std::atomic<unsigned> written;
+    std::atomic<long long> encodeMicroseconds;
+
+    void allocate(int width, int height);
+    void handOver(bool wait);                   // Queue the slots whose readback is complete
+    void work();                                // Worker thread
+    void writeFrame(const Slot &slot, std::vector<unsigned char> &buffer);
+};
+
+// RGBA8 (bottom row first, as glReadPixels) to planar YUV 4:2:0, full range BT.601 (top row first). The planes cover
+// (width & ~1) x (height & ~1) pixels; an odd last column/row is skipped.
+void rgbaToYUV420(const unsigned char *rgba, int width, int height, unsigned char *y, unsigned char *u, unsigned char *v);
+
+#endif
@@ -0,0 +1,146 @@
+#include "glHandle.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+
+#include <iostream>
+
+DeletionQueue deletionQueue;
+
+unsigned generateObject(GLObject type)
+{
+    unsigned name = 0;
+    switch(type)
+    {
+    case GLObject::BUFFER:       glGenBuffers(1, &name);       break;
+    case GLObject::VERTEX_ARRAY: glGenVertexArrays(1, &name);  break;
+    case GLObject::TEXTURE:      glGenTextures(1, &name);      break;
+    case GLObject::RENDERBUFFER: glGenRenderbuffers(1, &name); break;
+    case GLObject::FRAMEBUFFER:  glGenFramebuffers(1, &name);  break;
+    case GLObject::PROGRAM:      name = glCreateProgram();     break;
+    }
+    return name;
+}
+
+// ----- DeletionQueue ---------------
+
+DeletionQueue::DeletionQueue()
+    : closed(false), frame(0), deleted(0), renderThread(std::this_thread::get_id())
+{ }
+
+void DeletionQueue::release(GLObject type, unsigned name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!closed) released.push_back({ type, name });
+}
+
+void DeletionQueue::beginFrame()
+{
+    if(std::this_thread::get_id() != renderThread)
+    {
+        std::cout << "ERROR::DELETIONQUEUE::NOT_RENDER_THREAD" << std::endl;
+        return;                                 // no GL calls from this thread: the batches wait for the render thread
+    }
+
+    // Batches are in submission order: stop at the first one that isn't safe yet
+    while(!batches.empty() && frame - batches.front().frame >= DELETION_FRAMES)
+    {
+        Batch &batch = batches.front();
+        GLenum status = glClientWaitSync(batch.fence, 0, 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+        glDeleteSync(batch.fence);
+        destroy(batch.objects);
+        batches.pop_front();
+    }
+}
+
+void DeletionQueue::endFrame()
+{
+    if(std::this_thread::get_id() != renderThread)
+    {
+        std::cout << "ERROR::DELETIONQUEUE::NOT_RENDER_THREAD" << std::endl;
+        return;
+    }
+
+    Batch batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.objects.swap(released);
+    }
+    ++frame;
+    if(batch.objects.empty()) return;
+
+    batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    batch.frame = frame;
+    batches.push_back(std::move(batch));
+}
+
+void DeletionQueue::shutdown()
+{
+    if(std::this_thread::get_id() != renderThread)
+    {
+        std::cout << "ERROR::DELETIONQUEUE::NOT_RENDER_THREAD" << std::endl;
+        return;
+    }
+
+    std::vector<Object> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        remaining.swap(released);
+        closed = true;
+    }
+
+    glFinish();
+    for(Batch &batch : batches)
+    {
+        glDeleteSync(batch.fence);
+        destroy(batch.objects);
+    }
+    batches.clear();
+    destroy(remaining);
+}
+
+unsigned DeletionQueue::getPending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t pending = released.size();
+    for(const Batch &batch : batches) pending += batch.objects.size();
+    return (unsigned)pending;
+}
+
+void DeletionQueue::destroy(const std::vector<Object> &objects)
+{
+    for(const Object &object : objects)
+    {
+        switch(object.type)
+        {
+        case GLObject::BUFFER:
+            glDeleteBuffers(1, &object.name);
+            glState.deletedBuffer(object.name);
+            gpuMemory.deletedBuffer(object.name);
+            break;
+        case GLObject::VERTEX_ARRAY:
+            glDeleteVertexArrays(1, &object.name);
+            glState.deletedVertexArray(object.name);
+            break;
+        case GLObject::TEXTURE:
+            glDeleteTextures(1, &object.name);
+            glState.deletedTexture(object.name);
+            gpuMemory.deletedTexture(object.name);
+            break;
+        case GLObject::RENDERBUFFER:
+            glDeleteRenderbuffers(1, &object.name);
+            gpuMemory.deletedRenderbuffer(object.name);
+            break;
+        case GLObject::FRAMEBUFFER:
+            glDeleteFramebuffers(1, &object.name);
+            glState.deletedFramebuffer(object.name);
+            break;
+        case GLObject::PROGRAM:
+            glDeleteProgram(object.name);
+            glState.deletedProgram(object.name);
+            break;
+        }
+    }
+    deleted += (unsigned)objects.size();
+}
@@ -0,0 +1,114 @@
+#ifndef GLHANDLE_HPP
+#define GLHANDLE_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define DELETION_FRAMES 2       // released objects are deleted at least DELETION_FRAMES frames later (and after their fence)
+
+enum class GLObject { BUFFER, VERTEX_ARRAY, TEXTURE, RENDERBUFFER, FRAMEBUFFER, PROGRAM };
+
+// Deferred deletion of GL objects. release() only records the object (any thread can call it); endFrame() puts the
+// objects released during the frame behind a fence, and beginFrame() deletes the batches that are DELETION_FRAMES old
+// and whose fence has signaled, so the driver never has to wait for the GPU to finish with an object, and glDelete*
+// is only called from the render thread (called from another thread, beginFrame(), endFrame() and shutdown() report
+// NOT_RENDER_THREAD and make no GL calls). Deletion also notifies glState and gpuMemory (deleted*()).
+// shutdown() (before the context is destroyed) deletes everything; objects released after it, or still queued when the
+// context is destroyed without it (e.g. after the benchmarks), are freed with the context.
+class DeletionQueue
+{
+public:
+    DeletionQueue();
+
+    void release(GLObject type, unsigned name);
+    void beginFrame();                          // Render thread: deletes the batches that are safe to delete
+    void endFrame();                            // Render thread: fence for the objects released in the frame
+    void shutdown();                            // Render thread: waits for the GPU and deletes everything
+
+    unsigned getPending() const;                // released, not deleted yet
+    unsigned getDeleted() const { return deleted; }
+
+private:
+    struct Object { GLObject type; unsigned name; };
+    struct Batch
+    {
+        std::vector<Object> objects;
+        GLsync   fence;
+        uint64_t frame;
+    };
+
+    mutable std::mutex  mutex;                  // guards released and closed
+    std::vector<Object> released;               // this frame's
+    bool                closed;
+
+    std::deque<Batch>   batches;                // oldest first
+    uint64_t            frame;
+    unsigned            deleted;
+    std::thread::id     renderThread;
+
+    void destroy(const std::vector<Object> &objects);
+};
+
+extern DeletionQueue deletionQueue;
+
+unsigned generateObject(GLObject type);         // glGen* / glCreateProgram
+
+// Move-only owner of a GL object name. Destroying or resetting it passes the object to deletionQueue. It converts to the
+// name, so it can be used directly in gl* calls:
+//      BufferHandle VBO = BufferHandle::generate();
+//      glBindBuffer(GL_ARRAY_BUFFER, VBO);
+template<GLObject TYPE>
+class GLHandle
+{
+public:
+    GLHandle() : name(0) { }
+    explicit GLHandle(unsigned name) : name(name) { }           // Takes ownership of name
+    ~GLHandle() { reset(); }
+
+    GLHandle(GLHandle &&other) noexcept : name(other.name) { other.name = 0; }
+    GLHandle &operator=(GLHandle &&other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            std::swap(name, other.name);
+        }
+        return *this;
+    }
+
+    GLHandle(const GLHandle &) = delete;
+    GLHandle &operator=(const GLHandle &) = delete;
+
+    static GLHandle generate() { return GLHandle(generateObject(TYPE)); }
+
+    void reset()
+    {
+        if(name) deletionQueue.release(TYPE, name);
+        name = 0;
+    }
+
+    unsigned get() const { return name; }
+    operator unsigned() const { return name; }
+
+private:
+    unsigned name;
+};
+
+typedef GLHandle<GLObject::BUFFER>       BufferHandle;
+typedef GLHandle<GLObject::VERTEX_ARRAY> VertexArrayHandle;
+typedef GLHandle<GLObject::TEXTURE>      TextureHandle;
+typedef GLHandle<GLObject::RENDERBUFFER> RenderbufferHandle;
+typedef GLHandle<GLObject::FRAMEBUFFER>  FramebufferHandle;
+typedef GLHandle<GLObject::PROGRAM>      ProgramHandle;
+
+#endif
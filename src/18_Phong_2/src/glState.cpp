@@ -0,0 +1,303 @@
+#include "glState.hpp"
+
+#include <cstring>
+#include <limits>
+
+GLState glState;
+
+namespace
+{
+
+const unsigned UNKNOWN = ~0u;
+
+int bufferIndex(GLenum target)
+{
+    switch(target)
+    {
+    case GL_ARRAY_BUFFER:               return 0;
+    case GL_ELEMENT_ARRAY_BUFFER:       return 1;
+    case GL_UNIFORM_BUFFER:             return 2;
+    case GL_SHADER_STORAGE_BUFFER:      return 3;
+    case GL_DRAW_INDIRECT_BUFFER:       return 4;
+    case GL_COPY_READ_BUFFER:           return 5;
+    case GL_COPY_WRITE_BUFFER:          return 6;
+    case GL_PIXEL_PACK_BUFFER:          return 7;
+    case GL_PIXEL_UNPACK_BUFFER:        return 8;
+    case GL_DISPATCH_INDIRECT_BUFFER:   return 9;
+    default:                            return -1;
+    }
+}
+
+int textureIndex(GLenum target)
+{
+    switch(target)
+    {
+    case GL_TEXTURE_2D:                 return 0;
+    case GL_TEXTURE_CUBE_MAP:           return 1;
+    case GL_TEXTURE_2D_ARRAY:           return 2;
+    case GL_TEXTURE_3D:                 return 3;
+    case GL_TEXTURE_2D_MULTISAMPLE:     return 4;
+    case GL_TEXTURE_BUFFER:             return 5;
+    default:                            return -1;
+    }
+}
+
+int capabilityIndex(GLenum cap)
+{
+    switch(cap)
+    {
+    case GL_DEPTH_TEST:                 return 0;
+    case GL_BLEND:                      return 1;
+    case GL_CULL_FACE:                  return 2;
+    case GL_SCISSOR_TEST:               return 3;
+    case GL_STENCIL_TEST:               return 4;
+    case GL_POLYGON_OFFSET_FILL:        return 5;
+    case GL_MULTISAMPLE:                return 6;
+    case GL_FRAMEBUFFER_SRGB:           return 7;
+    case GL_PROGRAM_POINT_SIZE:         return 8;
+    case GL_DEPTH_CLAMP:                return 9;
+    case GL_RASTERIZER_DISCARD:         return 10;
+    case GL_PRIMITIVE_RESTART:          return 11;
+    default:                            return -1;
+    }
+}
+
+} // anonymous namespace end
+
+// ----- Stats ---------------
+
+unsigned GLState::Stats::totalForwarded() const
+{
+    unsigned total = 0;
+    for(unsigned n : forwarded) total += n;
+    return total;
+}
+
+unsigned GLState::Stats::totalFiltered() const
+{
+    unsigned total = 0;
+    for(unsigned n : filtered) total += n;
+    return total;
+}
+
+// ----- GLState ---------------
+
+GLState::GLState()
+{
+    std::memset(&stats, 0, sizeof(stats));
+    std::memset(&lastFrame, 0, sizeof(lastFrame));
+    invalidate();
+}
+
+void GLState::beginFrame()
+{
+    lastFrame = stats;
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+void GLState::invalidate()
+{
+    program = vertexArray = activeUnit = UNKNOWN;
+    drawFramebuffer = readFramebuffer = UNKNOWN;
+    for(unsigned &buffer : buffers) buffer = UNKNOWN;
+    for(auto &slots : baseBuffers)
+        for(unsigned &buffer : slots) buffer = UNKNOWN;
+    for(auto &unit : textures)
+        for(unsigned &texture : unit) texture = UNKNOWN;
+    for(int &cap : capabilities) cap = -1;
+
+    blendSrc = blendDst = depthFunction = cullMode = UNKNOWN;
+    depthWrite = -1;
+    for(int &c : colorWrite) c = -1;
+    for(float &c : clear) c = std::numeric_limits<float>::quiet_NaN();     // NaN never compares equal
+    for(int &v : viewportRect) v = -1;
+}
+
+bool GLState::count(Category category, bool changed)
+{
+    if(changed) ++stats.forwarded[category];
+    else ++stats.filtered[category];
+    return changed;
+}
+
+bool GLState::useProgram(unsigned newProgram)
+{
+    if(!count(PROGRAM, program != newProgram)) return false;
+    glUseProgram(newProgram);
+    program = newProgram;
+    return true;
+}
+
+bool GLState::bindVertexArray(unsigned vao)
+{
+    if(!count(VERTEX_ARRAY, vertexArray != vao)) return false;
+    glBindVertexArray(vao);
+    vertexArray = vao;
+    buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;       // the element buffer binding belongs to the VAO
+    return true;
+}
+
+bool GLState::bindBuffer(GLenum target, unsigned buffer)
+{
+    int index = bufferIndex(target);
+    if(!count(BUFFER, index < 0 || buffers[index] != buffer)) return false;
+    glBindBuffer(target, buffer);
+    if(index >= 0) buffers[index] = buffer;
+    return true;
+}
+
+bool GLState::bindBufferBase(GLenum target, unsigned index, unsigned buffer)
+{
+    int slotSet = target == GL_UNIFORM_BUFFER ? 0 : target == GL_SHADER_STORAGE_BUFFER ? 1 : -1;
+    bool tracked = slotSet >= 0 && index < NUM_BASE_SLOTS;
+    if(!count(BUFFER, !tracked || baseBuffers[slotSet][index] != buffer)) return false;
+    glBindBufferBase(target, index, buffer);
+    if(tracked) baseBuffers[slotSet][index] = buffer;
+    int generic = bufferIndex(target);
+    if(generic >= 0) buffers[generic] = buffer;     // glBindBufferBase also binds the generic binding point
+    return true;
+}
+
+bool GLState::activeTexture(unsigned unit)
+{
+    if(!count(TEXTURE, activeUnit != unit)) return false;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    activeUnit = unit;
+    return true;
+}
+
+bool GLState::bindTexture(unsigned unit, GLenum target, unsigned texture)
+{
+    int index = textureIndex(target);
+    bool tracked = index >= 0 && unit < GLSTATE_TEXTURE_UNITS;
+    if(!count(TEXTURE, !tracked || textures[unit][index] != texture)) return false;
+
+    if(activeUnit != unit)          // not counted: it's part of this bind
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    if(tracked) textures[unit][index] = texture;
+    return true;
+}
+
+bool GLState::bindFramebuffer(GLenum target, unsigned framebuffer)
+{
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    bool changed = (draw && drawFramebuffer != framebuffer) || (read && readFramebuffer != framebuffer);
+
+    if(!count(FRAMEBUFFER, changed)) return false;
+    glBindFramebuffer(target, framebuffer);
+    if(draw) drawFramebuffer = framebuffer;
+    if(read) readFramebuffer = framebuffer;
+    return true;
+}
+
+bool GLState::enable(GLenum cap)  { return setCapability(cap, true); }
+
+bool GLState::disable(GLenum cap) { return setCapability(cap, false); }
+
+bool GLState::setCapability(GLenum cap, bool enabled)
+{
+    int index = capabilityIndex(cap);
+    if(!count(CAPABILITY, index < 0 || capabilities[index] != (int)enabled)) return false;
+    if(enabled) glEnable(cap);
+    else glDisable(cap);
+    if(index >= 0) capabilities[index] = enabled;
+    return true;
+}
+
+bool GLState::blendFunc(GLenum sfactor, GLenum dfactor)
+{
+    if(!count(FIXED_FUNCTION, blendSrc != sfactor || blendDst != dfactor)) return false;
+    glBlendFunc(sfactor, dfactor);
+    blendSrc = sfactor;
+    blendDst = dfactor;
+    return true;
+}
+
+bool GLState::depthFunc(GLenum func)
+{
+    if(!count(FIXED_FUNCTION, depthFunction != func)) return false;
+    glDepthFunc(func);
+    depthFunction = func;
+    return true;
+}
+
+bool GLState::depthMask(bool write)
+{
+    if(!count(FIXED_FUNCTION, depthWrite != (int)write)) return false;
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+    depthWrite = write;
+    return true;
+}
+
+bool GLState::colorMask(bool r, bool g, bool b, bool a)
+{
+    bool changed = colorWrite[0] != (int)r || colorWrite[1] != (int)g || colorWrite[2] != (int)b || colorWrite[3] != (int)a;
+    if(!count(FIXED_FUNCTION, changed)) return false;
+    glColorMask(r, g, b, a);
+    colorWrite[0] = r; colorWrite[1] = g; colorWrite[2] = b; colorWrite[3] = a;
+    return true;
+}
+
+bool GLState::cullFace(GLenum mode)
+{
+    if(!count(FIXED_FUNCTION, cullMode != mode)) return false;
+    glCullFace(mode);
+    cullMode = mode;
+    return true;
+}
+
+bool GLState::clearColor(float r, float g, float b, float a)
+{
+    if(!count(FIXED_FUNCTION, !(clear[0] == r && clear[1] == g && clear[2] == b && clear[3] == a))) return false;
+    glClearColor(r, g, b, a);
+    clear[0] = r; clear[1] = g; clear[2] = b; clear[3] = a;
+    return true;
+}
+
+bool GLState::viewport(int x, int y, int width, int height)
+{
+    bool changed = viewportRect[0] != x || viewportRect[1] != y || viewportRect[2] != width || viewportRect[3] != height;
+    if(!count(FIXED_FUNCTION, changed)) return false;
+    glViewport(x, y, width, height);
+    viewportRect[0] = x; viewportRect[1] = y; viewportRect[2] = width; viewportRect[3] = height;
+    return true;
+}
+
+// Deleting a bound object makes GL bind 0 in its place
+
+void GLState::deletedProgram(unsigned name)
+{
+    if(program == name) program = UNKNOWN;      // a deleted program stays in use until another one is bound
+}
+
+void GLState::deletedVertexArray(unsigned name)
+{
+    if(vertexArray == name) vertexArray = 0;
+}
+
+void GLState::deletedBuffer(unsigned name)
+{
+    for(unsigned &buffer : buffers)
+        if(buffer == name) buffer = 0;
+    for(auto &slots : baseBuffers)
+        for(unsigned &buffer : slots)
+            if(buffer == name) buffer = 0;
+}
+
+void GLState::deletedTexture(unsigned name)
+{
+    for(auto &unit : textures)
+        for(unsigned &texture : unit)
+            if(texture == name) texture = 0;
+}
+
+void GLState::deletedFramebuffer(unsigned name)
+{
+    if(drawFramebuffer == name) drawFramebuffer = 0;
+    if(readFramebuffer == name) readFramebuffer = 0;
+}
@@ -0,0 +1,97 @@
+#ifndef GLSTATE_HPP
+#define GLSTATE_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+
+#define GLSTATE_TEXTURE_UNITS 16
+
+// Shadow copy of the GL state. Each setter compares against the cached value and only calls the driver when the
+// state really changes (returns true in that case). Redundant calls filtered are counted per frame.
+// Rules:
+//  - Code that changes tracked state with raw gl* calls (e.g. third party libraries) must call invalidate() afterwards.
+//  - When a tracked object is deleted, call the matching deleted*() so its name isn't assumed bound if it's reused
+//    (objects owned by a GLHandle are deleted by deletionQueue, which does it).
+class GLState
+{
+public:
+    enum Category { PROGRAM, VERTEX_ARRAY, BUFFER, TEXTURE, FRAMEBUFFER, CAPABILITY, FIXED_FUNCTION, NUM_CATEGORIES };
+
+    struct Stats
+    {
+        unsigned forwarded[NUM_CATEGORIES];     // calls that reached the driver
+        unsigned filtered[NUM_CATEGORIES];      // redundant calls skipped
+
+        unsigned totalForwarded() const;
+        unsigned totalFiltered() const;
+    };
+
+    GLState();
+
+    void beginFrame();                          // Starts a new set of per-frame counters
+    void invalidate();                          // Forget everything: the next call of each setter reaches the driver
+    const Stats &getStats() const { return stats; }     // Counters of the current frame
+    const Stats &getLastFrameStats() const { return lastFrame; }
+
+    // Objects
+    bool useProgram(unsigned program);
+    bool bindVertexArray(unsigned vao);
+    bool bindBuffer(GLenum target, unsigned buffer);
+    bool bindBufferBase(GLenum target, unsigned index, unsigned buffer);    // GL_UNIFORM_BUFFER / GL_SHADER_STORAGE_BUFFER slots 0..7
+    bool activeTexture(unsigned unit);                                      // unit: 0, 1, 2... (not GL_TEXTURE0 + unit)
+    bool bindTexture(unsigned unit, GLenum target, unsigned texture);       // Sets the active unit if needed
+    bool bindFramebuffer(GLenum target, unsigned framebuffer);
+
+    // Capabilities (glEnable / glDisable)
+    bool enable(GLenum cap);
+    bool disable(GLenum cap);
+    bool setCapability(GLenum cap, bool enabled);
+
+    // Fixed function state
+    bool blendFunc(GLenum sfactor, GLenum dfactor);
+    bool depthFunc(GLenum func);
+    bool depthMask(bool write);
+    bool colorMask(bool r, bool g, bool b, bool a);
+    bool cullFace(GLenum mode);
+    bool clearColor(float r, float g, float b, float a);
+    bool viewport(int x, int y, int width, int height);
+
+    // Deleted objects
+    void deletedProgram(unsigned program);
+    void deletedVertexArray(unsigned vao);
+    void deletedBuffer(unsigned buffer);
+    void deletedTexture(unsigned texture);
+    void deletedFramebuffer(unsigned framebuffer);
+
+    unsigned getProgram()     const { return program; }
+    unsigned getVertexArray() const { return vertexArray; }
+
+private:
+    enum { NUM_BUFFER_TARGETS = 10, NUM_TEXTURE_TARGETS = 6, NUM_CAPABILITIES = 12, NUM_BASE_SLOTS = 8 };
+
+    Stats stats, lastFrame;
+
+    unsigned program;
+    unsigned vertexArray;
+    unsigned buffers[NUM_BUFFER_TARGETS];
+    unsigned baseBuffers[2][NUM_BASE_SLOTS];            // uniform, shader storage
+    unsigned activeUnit;
+    unsigned textures[GLSTATE_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+    unsigned drawFramebuffer, readFramebuffer;
+    int      capabilities[NUM_CAPABILITIES];            // -1 unknown, 0 disabled, 1 enabled
+
+    GLenum blendSrc, blendDst, depthFunction, cullMode;
+    int    depthWrite;
+    int    colorWrite[4];
+    float  clear[4];
+    int    viewportRect[4];
+
+    bool count(Category category, bool changed);        // Updates the counters; returns changed
+};
+
+extern GLState glState;     // State of the (single) GL context of the program
+
+#endif
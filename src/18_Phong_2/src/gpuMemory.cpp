@@ -0,0 +1,335 @@
+#include "gpuMemory.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+// Driver memory queries (not in the core headers)
+#ifndef GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX   0x9048
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI                      0x87FC
+#endif
+
+GpuMemory gpuMemory;
+
+namespace
+{
+
+uint64_t key(GpuMemory::Kind kind, unsigned name) { return (uint64_t)kind << 32 | name; }
+
+double MB(size_t bytes) { return bytes / 1048576.0; }
+
+const char *kindNames[GpuMemory::NUM_KINDS] = { "buffers", "textures", "renderbuffers" };
+
+} // anonymous namespace end
+
+GpuMemory::GpuMemory() : budget(0), frame(0), overBudget(false), driverInfo(-1) { }
+
+// ----- Allocation ---------------
+
+GpuMemory::Allocation &GpuMemory::record(Kind kind, unsigned name, const std::string &owner)
+{
+    auto entry = allocations.try_emplace(key(kind, name));
+    Allocation &allocation = entry.first->second;
+    if(entry.second)
+    {
+        allocation.kind = kind;
+        allocation.name = name;
+        allocation.owner = owner;
+        ++totals.count[kind];
+    }
+    allocation.lastUse = frame;
+    return allocation;
+}
+
+void GpuMemory::setLevel(Allocation &allocation, GLint level, size_t bytes)
+{
+    if(level < 0 || level >= GPUMEMORY_MAX_LEVELS) return;
+
+    size_t old = allocation.bytes;
+    allocation.levelBytes[level] = bytes;
+    allocation.levels = std::max(allocation.levels, (GLsizei)level + 1);
+
+    allocation.bytes = 0;
+    for(GLsizei i = 0; i < allocation.levels; ++i) allocation.bytes += allocation.levelBytes[i];
+
+    totals.bytes[allocation.kind] += allocation.bytes - old;
+    if(allocation.streamable) totals.streamableBytes += allocation.bytes - old;
+}
+
+void GpuMemory::clearLevels(Allocation &allocation)
+{
+    totals.bytes[allocation.kind] -= allocation.bytes;
+    if(allocation.streamable) totals.streamableBytes -= allocation.bytes;
+
+    std::fill(allocation.levelBytes, allocation.levelBytes + GPUMEMORY_MAX_LEVELS, 0);
+    allocation.levels = 0;
+    allocation.bytes = 0;
+}
+
+void GpuMemory::bufferData(unsigned buffer, GLenum target, GLsizeiptr size, const void *data, GLenum usage, const std::string &owner)
+{
+    glBufferData(target, size, data, usage);
+
+    Allocation &allocation = record(BUFFER, buffer, owner);
+    allocation.target = target;
+    allocation.format = usage;
+    setLevel(allocation, 0, (size_t)size);      // re-specification (orphaning) replaces the size
+}
+
+void GpuMemory::bufferStorage(unsigned buffer, GLenum target, GLsizeiptr size, const void *data, GLbitfield flags, const std::string &owner)
+{
+    glBufferStorage(target, size, data, flags);
+
+    Allocation &allocation = record(BUFFER, buffer, owner);
+    allocation.target = target;
+    allocation.format = 0;                      // immutable storage
+    setLevel(allocation, 0, (size_t)size);
+}
+
+void GpuMemory::texImage2D(unsigned texture, GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                           GLenum format, GLenum type, const void *pixels, const std::string &owner)
+{
+    glTexImage2D(target, level, internalFormat, width, height, 0, format, type, pixels);
+
+    Allocation &allocation = record(TEXTURE, texture, owner);
+    allocation.target = target;
+    allocation.format = internalFormat;
+    if(level == 0)                              // new image: the old mip levels are gone
+    {
+        clearLevels(allocation);
+        allocation.width = width; allocation.height = height; allocation.depth = 1;
+    }
+    setLevel(allocation, level, (size_t)width * height * bytesPerTexel(internalFormat));
+}
+
+void GpuMemory::texImage3D(unsigned texture, GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                           GLsizei depth, GLenum format, GLenum type, const void *pixels, const std::string &owner)
+{
+    glTexImage3D(target, level, internalFormat, width, height, depth, 0, format, type, pixels);
+
+    Allocation &allocation = record(TEXTURE, texture, owner);
+    allocation.target = target;
+    allocation.format = internalFormat;
+    if(level == 0)
+    {
+        clearLevels(allocation);
+        allocation.width = width; allocation.height = height; allocation.depth = depth;
+    }
+    setLevel(allocation, level, (size_t)width * height * depth * bytesPerTexel(internalFormat));
+}
+
+void GpuMemory::texStorage2D(unsigned texture, GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height,
+                             const std::string &owner)
+{
+    glTexStorage2D(target, levels, internalFormat, width, height);
+
+    Allocation &allocation = record(TEXTURE, texture, owner);
+    allocation.target = target;
+    allocation.format = internalFormat;
+    allocation.width = width;
+    allocation.height = height;
+    allocation.depth = 1;
+    clearLevels(allocation);
+    for(GLint level = 0; level < levels; ++level)
+        setLevel(allocation, level, (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * bytesPerTexel(internalFormat));
+}
+
+void GpuMemory::generateMipmap(unsigned texture, GLenum target)
+{
+    glGenerateMipmap(target);
+
+    auto it = allocations.find(key(TEXTURE, texture));
+    if(it == allocations.end()) return;
+
+    // Array layers stay; only 3D textures halve their depth
+    Allocation &allocation = it->second;
+    GLsizei width = allocation.width, height = allocation.height, depth = allocation.depth;
+    for(GLint level = 1; level < GPUMEMORY_MAX_LEVELS && (width > 1 || height > 1 || (target == GL_TEXTURE_3D && depth > 1)); ++level)
+    {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        if(target == GL_TEXTURE_3D) depth = std::max(depth / 2, 1);
+        setLevel(allocation, level, (size_t)width * height * depth * bytesPerTexel(allocation.format));
+    }
+}
+
+void GpuMemory::renderbufferStorage(unsigned renderbuffer, GLenum internalFormat, GLsizei width, GLsizei height, const std::string &owner)
+{
+    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+
+    Allocation &allocation = record(RENDERBUFFER, renderbuffer, owner);
+    allocation.target = GL_RENDERBUFFER;
+    allocation.format = internalFormat;
+    allocation.width = width;
+    allocation.height = height;
+    allocation.depth = 1;
+    setLevel(allocation, 0, (size_t)width * height * bytesPerTexel(internalFormat));
+}
+
+void GpuMemory::erase(Kind kind, unsigned name)
+{
+    auto it = allocations.find(key(kind, name));
+    if(it == allocations.end()) return;         // not allocated through the registry
+
+    totals.bytes[kind] -= it->second.bytes;
+    --totals.count[kind];
+    if(it->second.streamable) totals.streamableBytes -= it->second.bytes;
+    allocations.erase(it);
+}
+
+void GpuMemory::deletedBuffer(unsigned buffer)             { erase(BUFFER, buffer); }
+void GpuMemory::deletedTexture(unsigned texture)           { erase(TEXTURE, texture); }
+void GpuMemory::deletedRenderbuffer(unsigned renderbuffer) { erase(RENDERBUFFER, renderbuffer); }
+
+unsigned GpuMemory::bytesPerTexel(GLenum internalFormat)
+{
+    switch(internalFormat)
+    {
+    case GL_R8:                 return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:  return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:  return 8;
+    case GL_RGBA32F:            return 16;
+    case GL_RGB32F:             return 12;
+    case GL_RGB16F:             return 6;
+    default:                    return 4;       // RGB(A)8 (RGB is padded), RGB10_A2, R32F, RG16F, DEPTH24(_STENCIL8), DEPTH32F...
+    }
+}
+
+// ----- Budget ---------------
+
+void GpuMemory::setBudget(size_t bytes)
+{
+    budget = bytes;
+    overBudget = false;
+}
+
+void GpuMemory::setStreamable(unsigned texture, std::function<void()> evict)
+{
+    auto it = allocations.find(key(TEXTURE, texture));
+    if(it == allocations.end())
+    {
+        std::cout << "ERROR::GPUMEMORY::UNKNOWN_TEXTURE: " << texture << std::endl;
+        return;
+    }
+
+    Allocation &allocation = it->second;
+    if(!allocation.streamable) totals.streamableBytes += allocation.bytes;
+    allocation.streamable = true;
+    allocation.evict = std::move(evict);
+}
+
+void GpuMemory::touch(unsigned texture)
+{
+    auto it = allocations.find(key(TEXTURE, texture));
+    if(it != allocations.end()) it->second.lastUse = frame;
+}
+
+void GpuMemory::beginFrame()
+{
+    ++frame;
+    if(!budget || totals.total() <= budget)
+    {
+        overBudget = false;
+        return;
+    }
+
+    // Least recently used first. Textures used in the last frame are still referenced by queued GPU work: never evicted.
+    std::vector<std::pair<uint64_t, uint64_t>> candidates;      // last use, key
+    for(const auto &entry : allocations)
+        if(entry.second.streamable && entry.second.lastUse + 1 < frame)
+            candidates.push_back({ entry.second.lastUse, entry.first });
+    std::sort(candidates.begin(), candidates.end());
+
+    for(const auto &candidate : candidates)
+    {
+        if(totals.total() <= budget) break;
+
+        auto it = allocations.find(candidate.second);
+        if(it == allocations.end()) continue;
+        std::function<void()> evict = it->second.evict;         // the callback deletes the texture (and this entry)
+        size_t before = totals.total();
+        if(evict) evict();
+        if(totals.total() < before) ++totals.evictions;
+        else erase(TEXTURE, (unsigned)candidate.second);         // callback didn't report the deletion
+    }
+
+    if(totals.total() > budget && !overBudget)
+        std::cout << "ERROR::GPUMEMORY::OVER_BUDGET: " << MB(totals.total()) << " MB of " << MB(budget) <<
+                     " MB, nothing left to evict" << std::endl;
+    overBudget = totals.total() > budget;
+}
+
+// ----- Queries ---------------
+
+std::vector<std::pair<std::string, size_t>> GpuMemory::getOwners() const
+{
+    std::map<std::string, size_t> owners;
+    for(const auto &entry : allocations) owners[entry.second.owner] += entry.second.bytes;
+
+    std::vector<std::pair<std::string, size_t>> sorted(owners.begin(), owners.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    return sorted;
+}
+
+bool GpuMemory::driverMemory(size_t &total, size_t &available)
+{
+    if(driverInfo < 0)
+    {
+        driverInfo = 0;
+        GLint numExtensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+        for(GLint i = 0; i < numExtensions; ++i)
+        {
+            const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+            if(!std::strcmp(name, "GL_NVX_gpu_memory_info")) driverInfo = 1;
+            else if(!std::strcmp(name, "GL_ATI_meminfo") && !driverInfo) driverInfo = 2;
+        }
+    }
+
+    GLint values[4] = { 0, 0, 0, 0 };           // KB
+    if(driverInfo == 1)
+    {
+        glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &values[0]);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &values[1]);
+        total = (size_t)values[0] * 1024;
+        available = (size_t)values[1] * 1024;
+        return true;
+    }
+    if(driverInfo == 2)
+    {
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, values);         // free pool memory, largest free block, ...
+        total = 0;                              // not reported
+        available = (size_t)values[0] * 1024;
+        return true;
+    }
+    return false;
+}
+
+void GpuMemory::printLine()
+{
+    std::cout << std::fixed << std::setprecision(1) << "GPU memory: " << MB(totals.total()) << " MB (";
+    for(int kind = 0; kind < NUM_KINDS; ++kind)
+        std::cout << (kind ? " | " : "") << kindNames[kind] << " " << MB(totals.bytes[kind]) << " MB in " << totals.count[kind];
+    std::cout << ")";
+
+    if(budget)
+        std::cout << " | budget " << MB(budget) << " MB, " << MB(totals.streamableBytes) << " MB streamable, " << totals.evictions << " evictions";
+
+    size_t total, available;
+    if(driverMemory(total, available))
+    {
+        std::cout << " | driver: " << MB(available) << " MB available";
+        if(total) std::cout << " of " << MB(total) << " MB";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+}
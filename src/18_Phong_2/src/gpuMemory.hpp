@@ -0,0 +1,108 @@
+#ifndef GPUMEMORY_HPP
+#define GPUMEMORY_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define GPUMEMORY_MAX_LEVELS 16
+
+// Registry of the GPU memory allocated by the program. Storage is allocated through the wrappers below (same arguments
+// as the gl* function plus the object name and an owner label), which record size, format and mip levels:
+//      glBindBuffer(GL_ARRAY_BUFFER, VBO);
+//      gpuMemory.bufferData(VBO, GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW, "cube");
+// When an object is deleted, call the matching deleted*() (like GLState's; deletionQueue does it for GLHandle objects).
+// Budget: textures marked streamable (setStreamable) can be evicted. beginFrame() evicts the least recently used ones
+// (touch() on use) while the total is over the budget; their evict callback must delete them (the owner recreates
+// them when they are needed again). Eviction only happens there, between frames, never in the middle of a frame.
+class GpuMemory
+{
+public:
+    enum Kind { BUFFER, TEXTURE, RENDERBUFFER, NUM_KINDS };
+
+    struct Totals
+    {
+        size_t   bytes[NUM_KINDS] = { 0, 0, 0 };
+        unsigned count[NUM_KINDS] = { 0, 0, 0 };
+        size_t   streamableBytes = 0;
+        unsigned evictions = 0;                 // since the start
+
+        size_t total() const { return bytes[BUFFER] + bytes[TEXTURE] + bytes[RENDERBUFFER]; }
+    };
+
+    GpuMemory();
+
+    // Allocation wrappers (the object must be bound to target, as for the gl* call)
+    void bufferData(unsigned buffer, GLenum target, GLsizeiptr size, const void *data, GLenum usage, const std::string &owner);
+    void bufferStorage(unsigned buffer, GLenum target, GLsizeiptr size, const void *data, GLbitfield flags, const std::string &owner);
+    void texImage2D(unsigned texture, GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                    GLenum format, GLenum type, const void *pixels, const std::string &owner);
+    void texImage3D(unsigned texture, GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                    GLsizei depth, GLenum format, GLenum type, const void *pixels, const std::string &owner);
+    void texStorage2D(unsigned texture, GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height,
+                      const std::string &owner);
+    void generateMipmap(unsigned texture, GLenum target);           // Records the whole mip chain of level 0
+    void renderbufferStorage(unsigned renderbuffer, GLenum internalFormat, GLsizei width, GLsizei height, const std::string &owner);
+
+    void deletedBuffer(unsigned buffer);
+    void deletedTexture(unsigned texture);
+    void deletedRenderbuffer(unsigned renderbuffer);
+
+    // Budget
+    void setBudget(size_t bytes);               // 0: no budget
+    size_t getBudget() const { return budget; }
+    void setStreamable(unsigned texture, std::function<void()> evict);
+    void touch(unsigned texture);               // Used this frame
+    void beginFrame();                          // Enforces the budget
+
+    // Queries
+    const Totals &getTotals() const { return totals; }
+    std::vector<std::pair<std::string, size_t>> getOwners() const;  // bytes per owner, largest first
+    bool driverMemory(size_t &total, size_t &available);             // GL_NVX_gpu_memory_info / GL_ATI_meminfo (false: neither)
+    void printLine();                                                // One line summary (periodic log)
+
+    static unsigned bytesPerTexel(GLenum internalFormat);
+
+private:
+    struct Allocation
+    {
+        Kind        kind;
+        unsigned    name;
+        GLenum      target = 0;
+        GLenum      format;                     // internal format (textures, renderbuffers) or usage (buffers)
+        GLsizei     width = 0, height = 0, depth = 0;
+        GLsizei     levels = 0;
+        size_t      levelBytes[GPUMEMORY_MAX_LEVELS] = { 0 };       // buffers: levelBytes[0]
+        size_t      bytes = 0;
+        std::string owner;
+        bool        streamable = false;
+        uint64_t    lastUse = 0;
+        std::function<void()> evict;
+    };
+
+    std::unordered_map<uint64_t, Allocation> allocations;       // key: kind << 32 | name
+    Totals   totals;
+    size_t   budget;
+    uint64_t frame;
+    bool     overBudget;                        // reported once until it's under the budget again
+    int      driverInfo;                        // -1 not checked yet, 0 none, 1 NVX, 2 ATI
+
+    Allocation &record(Kind kind, unsigned name, const std::string &owner);
+    void setLevel(Allocation &allocation, GLint level, size_t bytes);
+    void clearLevels(Allocation &allocation);  // before re-specifying a texture
+    void erase(Kind kind, unsigned name);
+};
+
+extern GpuMemory gpuMemory;     // Allocations of the (single) GL context of the program
+
+#endif
@@ -0,0 +1,233 @@
+#include "gpuScene.hpp"
+#include "hiZ.hpp"
+#include "occlusionRasterizer.hpp"
+#include "meshImporter.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace
+{
+
+const std::string shadersDir = "../../../src/18_Phong_2/shaders/";
+
+const unsigned CULL_GROUP_SIZE = 64;    // local_size_x of gpuCull.cs
+
+// Frustum planes (xyz: inward normal, w: distance) of a view-projection matrix
+void frustumPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6])
+{
+    glm::mat4 m = glm::transpose(viewProjection);
+    planes[0] = m[3] + m[0];        // left
+    planes[1] = m[3] - m[0];        // right
+    planes[2] = m[3] + m[1];        // bottom
+    planes[3] = m[3] - m[1];        // top
+    planes[4] = m[3] + m[2];        // near
+    planes[5] = m[3] - m[2];        // far
+    for(int i = 0; i < 6; ++i) planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+} // anonymous namespace end
+
+bool GpuScene::supported()
+{
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLAD
+    return GLAD_GL_VERSION_4_3;
+#elif IMGUI_IMPL_OPENGL_LOADER_GLEW
+    return GLEW_VERSION_4_3;
+#endif
+}
+
+GpuScene::GpuScene()
+    : dirtyBegin(0), dirtyEnd(0), built(false)
+{
+    cullProgram = new Shader((shadersDir + "gpuCull.cs").c_str());
+    drawProgram = new Shader((shadersDir + "gpuDrivenVS.vs").c_str(), (shadersDir + "gpuDrivenFragS.fs").c_str());
+}
+
+GpuScene::~GpuScene()
+{
+    delete cullProgram;
+    delete drawProgram;
+}
+
+unsigned GpuScene::addMesh(const MeshData &mesh)
+{
+    Mesh entry;
+    entry.indexCount = (unsigned)mesh.indices.size();
+    entry.firstIndex = (unsigned)indices.size();
+    entry.baseVertex = (int)(vertices.size() / MeshData::stride);
+    entry.radius     = glm::length(glm::max(glm::abs(mesh.minBound), glm::abs(mesh.maxBound)));
+    meshes.push_back(entry);
+
+    vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+    return (unsigned)meshes.size() - 1;
+}
+
+unsigned GpuScene::addObject(unsigned mesh, const glm::mat4 &model, const glm::vec3 &color)
+{
+    Object object;
+    object.model = model;
+    object.color = glm::vec4(color, 1.0f);
+    object.mesh  = mesh;
+    object.pad[0] = object.pad[1] = object.pad[2] = 0;
+    updateSphere(object);
+    objects.push_back(object);
+    return (unsigned)objects.size() - 1;
+}
+
+void GpuScene::updateSphere(Object &object)
+{
+    object.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(object.model))));
+
+    float maxScale = std::max(glm::length(glm::vec3(object.model[0])),
+                              std::max(glm::length(glm::vec3(object.model[1])), glm::length(glm::vec3(object.model[2]))));
+    object.sphere = glm::vec4(glm::vec3(object.model[3]), meshes[object.mesh].radius * maxScale);
+}
+
+void GpuScene::setObject(unsigned object, const glm::mat4 &model)
+{
+    objects[object].model = model;
+    updateSphere(objects[object]);
+
+    if(dirtyBegin == dirtyEnd) { dirtyBegin = object; dirtyEnd = object + 1; }
+    else
+    {
+        dirtyBegin = std::min(dirtyBegin, object);
+        dirtyEnd   = std::max(dirtyEnd, object + 1);
+    }
+}
+
+void GpuScene::build()
+{
+    if(built) return;
+    built = true;
+
+    for(BufferHandle *buffer : { &VBO, &EBO, &objectIdBuffer, &objectBuffer, &meshBuffer, &commandBuffer, &counterBuffer })
+        *buffer = BufferHandle::generate();
+
+    std::vector<unsigned> objectIds(objects.size());
+    for(unsigned i = 0; i < objectIds.size(); ++i) objectIds[i] = i;
+
+    // Merged geometry
+    VAO = VertexArrayHandle::generate();
+    glState.bindVertexArray(VAO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+    gpuMemory.bufferData(VBO, GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW, "gpu scene");
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MeshData::stride * sizeof(float), (void *)nullptr);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, MeshData::stride * sizeof(float), (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+
+    glState.bindBuffer(GL_ARRAY_BUFFER, objectIdBuffer);
+    gpuMemory.bufferData(objectIdBuffer, GL_ARRAY_BUFFER, objectIds.size() * sizeof(unsigned), objectIds.data(), GL_STATIC_DRAW, "gpu scene");
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(unsigned), (void *)nullptr);
+    glVertexAttribDivisor(4, 1);                            // instance i of a command reads objectIds[baseInstance + i]
+    glEnableVertexAttribArray(4);
+
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    gpuMemory.bufferData(EBO, GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned), indices.data(), GL_STATIC_DRAW, "gpu scene");
+
+    // Storage buffers
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+    gpuMemory.bufferData(objectBuffer, GL_SHADER_STORAGE_BUFFER, std::max<size_t>(objects.size(), 1) * sizeof(Object), objects.data(), GL_DYNAMIC_DRAW, "gpu scene");
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, meshBuffer);
+    gpuMemory.bufferData(meshBuffer, GL_SHADER_STORAGE_BUFFER, std::max<size_t>(meshes.size(), 1) * sizeof(Mesh), meshes.data(), GL_STATIC_DRAW, "gpu scene");
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    gpuMemory.bufferData(counterBuffer, GL_SHADER_STORAGE_BUFFER, 3 * sizeof(unsigned), nullptr, GL_DYNAMIC_COPY, "gpu scene");      // visible, frustum culled, occlusion culled
+
+    glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    gpuMemory.bufferData(commandBuffer, GL_DRAW_INDIRECT_BUFFER, std::max<size_t>(objects.size(), 1) * 5 * sizeof(unsigned), nullptr, GL_DYNAMIC_COPY, "gpu scene");
+
+    dirtyBegin = dirtyEnd = 0;
+}
+
+void GpuScene::draw(const glm::mat4 &view, const glm::mat4 &projection, const HiZBuffer *occlusion)
+{
+    if(!built) build();
+    if(objects.empty()) return;
+
+    // Upload changed objects
+    if(dirtyBegin != dirtyEnd)
+    {
+        glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, dirtyBegin * sizeof(Object), (dirtyEnd - dirtyBegin) * sizeof(Object), &objects[dirtyBegin]);
+        dirtyBegin = dirtyEnd = 0;
+    }
+
+    // Culling: one invocation per object writes its draw command
+    glm::vec4 planes[6];
+    frustumPlanes(projection * view, planes);
+
+    const unsigned zeros[3] = { 0, 0, 0 };
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeros), zeros);
+
+    glState.useProgram(cullProgram->ID);
+    glUniform4fv(glGetUniformLocation(cullProgram->ID, "frustum"), 6, &planes[0][0]);
+    glUniform1ui(glGetUniformLocation(cullProgram->ID, "numObjects"), (unsigned)objects.size());
+
+    bool occlusionCulling = occlusion && occlusion->isValid();
+    cullProgram->setBool("occlusionCulling", occlusionCulling);
+    if(occlusionCulling) occlusion->bind(*cullProgram, 0);
+    glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+    glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, meshBuffer);
+    glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+    glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, counterBuffer);
+    glDispatchCompute((unsigned)(objects.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Draw everything
+    glState.useProgram(drawProgram->ID);
+    drawProgram->setMat4("view", view);
+    drawProgram->setMat4("projection", projection);
+    glState.bindVertexArray(VAO);
+    glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)objects.size(), 0);
+}
+
+GpuScene::CullStats GpuScene::readStats()
+{
+    CullStats stats = { numObjects(), 0, 0, 0 };
+    if(!built) return stats;
+
+    unsigned counters[3] = { 0, 0, 0 };
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+
+    stats.visible         = counters[0];
+    stats.frustumCulled   = counters[1];
+    stats.occlusionCulled = counters[2];
+    return stats;
+}
+
+void GpuScene::drawPerObject(Shader &program, const glm::mat4 &view, const glm::mat4 &projection, OcclusionRasterizer *occlusion)
+{
+    if(!built) build();
+
+    glm::vec4 planes[6];
+    frustumPlanes(projection * view, planes);
+
+    program.UseProgram();
+    program.setMat4("view", view);
+    program.setMat4("projection", projection);
+    glState.bindVertexArray(VAO);
+
+    for(const Object &object : objects)
+    {
+        bool visible = true;
+        for(int p = 0; p < 6 && visible; ++p)
+            visible = glm::dot(glm::vec3(planes[p]), glm::vec3(object.sphere)) + planes[p].w >= -object.sphere.w;
+        if(!visible || (occlusion && !occlusion->visible(glm::vec3(object.sphere), object.sphere.w))) continue;
+
+        const Mesh &mesh = meshes[object.mesh];
+        program.setMat4("model", object.model);
+        program.setMat3("normalMatrix", glm::mat3(object.normalMatrix));
+        program.setVec3("objectColor", glm::vec3(object.color));
+        glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, (void *)(size_t)(mesh.firstIndex * sizeof(unsigned)), mesh.baseVertex);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef GPUSCENE_HPP
+#define GPUSCENE_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+#include "glHandle.hpp"
+
+#include <vector>
+
+class Shader;
+class HiZBuffer;
+class OcclusionRasterizer;
+struct MeshData;
+
+// GPU driven rendering (GL 4.3). All meshes share one vertex and one index buffer, per object data lives in a shader
+// storage buffer, and a compute shader (gpuCull.cs) frustum culls every object (and occlusion culls it against a
+// HiZBuffer, if given) and writes its draw command (instanceCount 0 if culled) into the indirect buffer. The whole scene is then a single glMultiDrawElementsIndirect,
+// so the CPU cost per frame doesn't depend on the object count (only objects changed with setObject() are uploaded).
+// The object index reaches the vertex shader through an instanced attribute (location 4) read at baseInstance.
+class GpuScene
+{
+public:
+    struct CullStats            // objects rejected by each culling stage in the last draw()
+    {
+        unsigned tested, frustumCulled, occlusionCulled, visible;
+    };
+
+    static bool supported();            // GL 4.3: compute shaders, SSBOs, multi-draw indirect
+
+    GpuScene();
+    ~GpuScene();
+
+    GpuScene(const GpuScene &) = delete;
+    GpuScene &operator=(const GpuScene &) = delete;
+
+    // Scene building: add meshes and objects, then build()
+    unsigned addMesh(const MeshData &mesh);                                     // Returns mesh id
+    unsigned addObject(unsigned mesh, const glm::mat4 &model, const glm::vec3 &color);   // Returns object id
+    void     build();                                                          // Upload everything to the GPU
+
+    void     setObject(unsigned object, const glm::mat4 &model);               // Upload happens in draw()
+
+    // Cull and draw. Lighting uniforms (lightPos, lightColor, camPos) must be set in getProgram() by the caller.
+    // occlusion: previous frame's depth pyramid (ignored if nullptr or not built yet).
+    void     draw(const glm::mat4 &view, const glm::mat4 &projection, const HiZBuffer *occlusion = nullptr);
+
+    CullStats readStats();              // Reads back: waits for the GPU
+    unsigned  countVisible() { return readStats().visible; }
+
+    // CPU reference path: frustum cull on the CPU and issue one glDrawElementsBaseVertex per visible object with
+    // program (vertexShader.vs + lightingFragS.fs style uniforms). occlusion: occluders already rasterized (built).
+    void     drawPerObject(Shader &program, const glm::mat4 &view, const glm::mat4 &projection, OcclusionRasterizer *occlusion = nullptr);
+
+    const glm::vec4 &getSphere(unsigned object) const { return objects[object].sphere; }    // world space center, radius
+    const glm::mat4 &getModel(unsigned object)  const { return objects[object].model; }
+
+    Shader  &getProgram() { return *drawProgram; }
+    unsigned numObjects() const { return (unsigned)objects.size(); }
+    unsigned numMeshes()  const { return (unsigned)meshes.size(); }
+
+private:
+    struct Mesh                 // std430 layout, as in gpuCull.cs
+    {
+        unsigned indexCount, firstIndex;
+        int      baseVertex;
+        float    radius;        // bounding sphere centered at the mesh origin
+    };
+
+    struct Object               // std430 layout, as in gpuCull.cs / gpuDrivenVS.vs
+    {
+        glm::mat4 model;
+        glm::mat4 normalMatrix;
+        glm::vec4 color;
+        glm::vec4 sphere;       // world space bounding sphere
+        unsigned  mesh, pad[3];
+    };
+
+    std::vector<float>    vertices;     // position, normal
+    std::vector<unsigned> indices;
+    std::vector<Mesh>     meshes;
+    std::vector<Object>   objects;
+    unsigned dirtyBegin, dirtyEnd;      // range of objects changed since the last upload
+
+    VertexArrayHandle VAO;
+    BufferHandle VBO, EBO, objectIdBuffer;
+    BufferHandle objectBuffer, meshBuffer, commandBuffer, counterBuffer;
+    Shader  *cullProgram, *drawProgram;
+    bool     built;
+
+    void updateSphere(Object &object);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "gpuTimer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+GpuTimer::~GpuTimer()
+{
+    for(Scope &scope : scopes)
+        glDeleteQueries(GPUTIMER_FRAMES, scope.queries);
+}
+
+void GpuTimer::begin(const std::string &name)
+{
+    if(open >= 0)
+    {
+        std::cout << "ERROR::GPUTIMER::NESTED_SCOPE: " << name << " inside " << names[open] << std::endl;
+        return;
+    }
+
+    auto it = std::find(names.begin(), names.end(), name);
+    open = (int)(it - names.begin());
+    if(it == names.end())
+    {
+        names.push_back(name);
+        scopes.emplace_back();
+        glGenQueries(GPUTIMER_FRAMES, scopes.back().queries);
+    }
+
+    Scope &scope = scopes[open];
+    glBeginQuery(target, scope.queries[frame]);
+    scope.issued[frame] = true;
+}
+
+void GpuTimer::end()
+{
+    if(open < 0) return;
+    glEndQuery(target);
+    open = -1;
+}
+
+void GpuTimer::endFrame()
+{
+    frame = (frame + 1) % GPUTIMER_FRAMES;
+
+    // The queries of the oldest frame are reused now: collect them (they have normally finished)
+    for(Scope &scope : scopes)
+        if(scope.issued[frame])
+        {
+            GLuint64 value = 0;
+            glGetQueryObjectui64v(scope.queries[frame], GL_QUERY_RESULT, &value);
+            scope.result = target == GL_TIME_ELAPSED ? value / 1e6 : (double)value;
+            scope.issued[frame] = false;
+        }
+        else scope.result = 0;                  // not measured in that frame
+}
+
+double GpuTimer::get(const std::string &name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    return it == names.end() ? 0 : scopes[it - names.begin()].result;
+}
@@ -0,0 +1,52 @@
+#ifndef GPUTIMER_HPP
+#define GPUTIMER_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#define GPUTIMER_FRAMES 3       // frames in flight: results are read GPUTIMER_FRAMES - 1 frames later, so nothing waits for the GPU
+
+// GPU time of named passes (GL_TIME_ELAPSED queries). Scopes can't be nested.
+//      timer.begin("geometry"); ... timer.end();
+//      timer.endFrame();
+//      timer.get("geometry");      // ms
+// With target GL_SAMPLES_PASSED it counts the fragments that pass the depth test instead (get() returns the count).
+// Timers with different targets can measure overlapping scopes.
+class GpuTimer
+{
+public:
+    explicit GpuTimer(GLenum target = GL_TIME_ELAPSED) : target(target), frame(0), open(-1) { }
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    void   begin(const std::string &name);
+    void   end();
+    void   endFrame();
+
+    double get(const std::string &name) const;      // Latest available result in ms or samples (0 if the scope wasn't measured)
+    const std::vector<std::string> &getNames() const { return names; }
+
+private:
+    struct Scope
+    {
+        unsigned queries[GPUTIMER_FRAMES] = { 0 };
+        bool     issued[GPUTIMER_FRAMES] = { false };
+        double   result = 0;
+    };
+
+    std::vector<std::string> names;
+    std::vector<Scope>       scopes;
+    GLenum   target;
+    unsigned frame;
+    int      open;              // scope being measured (-1: none)
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "hiZ.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+const std::string shadersDir = "../../../src/18_Phong_2/shaders/";
+
+const unsigned REDUCE_GROUP_SIZE = 8;       // local_size_x/y of hiZBuild.cs
+
+} // anonymous namespace end
+
+HiZBuffer::HiZBuffer()
+    : width(0), height(0), levels(0), viewProjection(1.0f), valid(false)
+{
+    reduceProgram = new Shader((shadersDir + "hiZBuild.cs").c_str());
+}
+
+HiZBuffer::~HiZBuffer()
+{
+    delete reduceProgram;
+}
+
+void HiZBuffer::resize(int newWidth, int newHeight)
+{
+    if(newWidth == width && newHeight == height && FBO) return;
+    width = newWidth;
+    height = newHeight;
+    valid = false;
+
+    levels = 1;
+    while((std::max(width, height) >> levels) > 0) ++levels;
+
+    depthCopy = TextureHandle::generate();             // the old targets go to deletionQueue
+    glState.bindTexture(0, GL_TEXTURE_2D, depthCopy);
+    gpuMemory.texImage2D(depthCopy, GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr, "hi-z");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    pyramid = TextureHandle::generate();
+    glState.bindTexture(0, GL_TEXTURE_2D, pyramid);
+    gpuMemory.texStorage2D(pyramid, GL_TEXTURE_2D, levels, GL_R32F, width, height, "hi-z");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    FBO = FramebufferHandle::generate();
+    glState.bindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthCopy, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::HIZ::FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+    glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HiZBuffer::build(int newWidth, int newHeight, const glm::mat4 &frameViewProjection)
+{
+    if(newWidth <= 0 || newHeight <= 0) return;
+    resize(newWidth, newHeight);
+    viewProjection = frameViewProjection;
+
+    // Copy the depth buffer (the default framebuffer can't be sampled)
+    glState.bindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glState.bindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Level 0 reads the depth texture, the next ones read the previous level
+    glState.useProgram(reduceProgram->ID);
+    glState.bindTexture(0, GL_TEXTURE_2D, depthCopy);
+    reduceProgram->setInt("depth", 0);
+
+    for(unsigned level = 0; level < levels; ++level)
+    {
+        int dstWidth = std::max(width >> level, 1), dstHeight = std::max(height >> level, 1);
+
+        reduceProgram->setInt("level", (int)level);
+        if(level) glBindImageTexture(0, pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((dstWidth + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, (dstHeight + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    valid = true;
+}
+
+void HiZBuffer::bind(const Shader &program, unsigned unit) const
+{
+    glState.bindTexture(unit, GL_TEXTURE_2D, pyramid);
+
+    program.setInt("hiZ", unit);
+    program.setMat4("hiZViewProjection", viewProjection);
+    program.setVec2("hiZSize", (float)width, (float)height);
+    program.setInt("hiZLevels", (int)levels);
+}
@@ -0,0 +1,50 @@
+#ifndef HIZ_HPP
+#define HIZ_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+#include "glHandle.hpp"
+
+class Shader;
+
+// Hierarchical depth buffer (GL 4.3). build() copies the depth of the default framebuffer at the end of a frame and
+// reduces it (compute shader hiZBuild.cs) into an R32F mip chain where each texel holds the farthest depth of the texels
+// it covers. The next frame, gpuCull.cs projects each object's bounding box with the matrices of that frame, picks the
+// level where the box covers at most 2x2 texels, and rejects the object if its nearest depth is behind all of them.
+// Using last frame's depth costs a frame of latency for objects that become visible (they appear one frame late).
+class HiZBuffer
+{
+public:
+    HiZBuffer();
+    ~HiZBuffer();
+
+    HiZBuffer(const HiZBuffer &) = delete;
+    HiZBuffer &operator=(const HiZBuffer &) = delete;
+
+    // Build the pyramid from the depth of the default framebuffer (D24S8), rendered with viewProjection
+    void build(int width, int height, const glm::mat4 &viewProjection);
+
+    // Set the sampler (hiZ) and uniforms (hiZViewProjection, hiZSize, hiZLevels) used by gpuCull.cs
+    void bind(const Shader &program, unsigned unit) const;
+
+    bool     isValid()   const { return valid; }         // false until the first build()
+    unsigned getLevels() const { return levels; }
+    unsigned getTexture()  const { return pyramid; }
+
+private:
+    int       width, height;
+    unsigned  levels;
+    FramebufferHandle FBO;
+    TextureHandle     depthCopy, pyramid;
+    Shader   *reduceProgram;
+    glm::mat4 viewProjection;
+    bool      valid;
+
+    void resize(int newWidth, int newHeight);
+};
+
+#endif
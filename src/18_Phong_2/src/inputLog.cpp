@@ -0,0 +1,158 @@
+#include "inputLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+
+const char     MAGIC[4] = { 'O', 'G', 'L', 'I' };
+const uint32_t VERSION  = 1;
+const size_t   MAX_EVENTS = 65535;      // per list and frame (uint16 count)
+
+enum Flags { FLAG_KEYS = 0x0f, FLAG_MOUSE = 0x10, FLAG_SCROLL = 0x20, FLAG_KEY_EVENTS = 0x40 };
+
+template<typename T>
+void put(std::ofstream &file, const T &value, size_t &bytes)
+{
+    file.write((const char *)&value, sizeof(T));
+    bytes += sizeof(T);
+}
+
+} // anonymous namespace end
+
+void InputFrame::clear()
+{
+    deltaTime = 0;
+    keys = 0;
+    mouseMoves.clear();
+    scrolls.clear();
+    keyEvents.clear();
+}
+
+// ----- InputRecorder ---------------
+
+InputRecorder::InputRecorder(const std::string &path) : file(path, std::ios::binary), frames(0), bytes(0), time(0)
+{
+    if(!file.is_open())
+    {
+        std::cout << "ERROR::INPUTRECORDER::CANNOT_WRITE: " << path << std::endl;
+        return;
+    }
+
+    file.write(MAGIC, 4);
+    bytes += 4;
+    put(file, VERSION, bytes);
+}
+
+InputRecorder::~InputRecorder()
+{
+    if(file.is_open())
+        std::cout << "Input recorded: " << frames << " frames, " << bytes << " bytes" << std::endl;
+}
+
+void InputRecorder::endFrame(float deltaTime, unsigned keys)
+{
+    time += deltaTime;
+    if(file.is_open())
+    {
+        uint8_t flags = (uint8_t)(keys & FLAG_KEYS);
+        if(!frame.mouseMoves.empty()) flags |= FLAG_MOUSE;
+        if(!frame.scrolls.empty())    flags |= FLAG_SCROLL;
+        if(!frame.keyEvents.empty())  flags |= FLAG_KEY_EVENTS;
+
+        put(file, flags, bytes);
+        put(file, deltaTime, bytes);
+
+        if(flags & FLAG_MOUSE)
+        {
+            uint16_t count = (uint16_t)std::min<size_t>(frame.mouseMoves.size(), MAX_EVENTS);
+            put(file, count, bytes);
+            for(uint16_t i = 0; i < count; ++i) { put(file, frame.mouseMoves[i].x, bytes); put(file, frame.mouseMoves[i].y, bytes); }
+        }
+        if(flags & FLAG_SCROLL)
+        {
+            uint16_t count = (uint16_t)std::min<size_t>(frame.scrolls.size(), MAX_EVENTS);
+            put(file, count, bytes);
+            for(uint16_t i = 0; i < count; ++i) put(file, frame.scrolls[i], bytes);
+        }
+        if(flags & FLAG_KEY_EVENTS)
+        {
+            uint16_t count = (uint16_t)std::min<size_t>(frame.keyEvents.size(), MAX_EVENTS);
+            put(file, count, bytes);
+            for(uint16_t i = 0; i < count; ++i) { put(file, frame.keyEvents[i].key, bytes); put(file, frame.keyEvents[i].action, bytes); }
+        }
+        ++frames;
+    }
+
+    frame.clear();
+}
+
+// ----- InputPlayer ---------------
+
+InputPlayer::InputPlayer(const std::string &path) : position(8), valid(false), time(0), frames(0)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open())
+    {
+        std::cout << "ERROR::INPUTPLAYER::CANNOT_READ: " << path << std::endl;
+        return;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    uint32_t version = 0;
+    if(data.size() >= 8) std::memcpy(&version, &data[4], 4);
+    valid = data.size() >= 8 && std::memcmp(data.data(), MAGIC, 4) == 0 && version == VERSION;
+    if(!valid) std::cout << "ERROR::INPUTPLAYER::NOT_AN_INPUT_LOG: " << path << std::endl;
+}
+
+bool InputPlayer::next(InputFrame &frame)
+{
+    frame.clear();
+    if(!valid || position + 5 > data.size()) return false;
+
+    auto get = [this](void *value, size_t size)
+    {
+        if(position + size > data.size()) { valid = false; return false; }
+        std::memcpy(value, &data[position], size);
+        position += size;
+        return true;
+    };
+
+    uint8_t flags = 0;
+    get(&flags, 1);
+    get(&frame.deltaTime, 4);
+    frame.keys = flags & FLAG_KEYS;
+
+    uint16_t count = 0;
+    if((flags & FLAG_MOUSE) && get(&count, 2))
+        for(uint16_t i = 0; i < count && valid; ++i)
+        {
+            glm::vec2 move;
+            if(get(&move.x, 4) && get(&move.y, 4)) frame.mouseMoves.push_back(move);
+        }
+    if((flags & FLAG_SCROLL) && get(&count, 2))
+        for(uint16_t i = 0; i < count && valid; ++i)
+        {
+            float scroll;
+            if(get(&scroll, 4)) frame.scrolls.push_back(scroll);
+        }
+    if((flags & FLAG_KEY_EVENTS) && get(&count, 2))
+        for(uint16_t i = 0; i < count && valid; ++i)
+        {
+            InputFrame::KeyEvent event;
+            if(get(&event.key, 2) && get(&event.action, 1)) frame.keyEvents.push_back(event);
+        }
+
+    if(!valid)
+    {
+        std::cout << "ERROR::INPUTPLAYER::TRUNCATED_LOG (frame " << frames << ")" << std::endl;
+        return false;
+    }
+
+    time += frame.deltaTime;
+    ++frames;
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef INPUTLOG_HPP
+#define INPUTLOG_HPP
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Input of one frame of the render loop: the events received (GLFW callbacks) since the previous frame, in order, and
+// the movement keys held during the frame with the frame's delta time
+struct InputFrame
+{
+    enum Keys { KEY_FORWARD = 1, KEY_BACKWARD = 2, KEY_LEFT = 4, KEY_RIGHT = 8 };
+
+    struct KeyEvent
+    {
+        int16_t key;                    // GLFW_KEY_*
+        uint8_t action;                 // GLFW_PRESS...
+    };
+
+    float    deltaTime = 0;             // s
+    unsigned keys = 0;                  // Keys held
+    std::vector<glm::vec2> mouseMoves;  // offsets passed to Camera::ProcessMouseMovement
+    std::vector<float>     scrolls;     // offsets passed to Camera::ProcessMouseScroll
+    std::vector<KeyEvent>  keyEvents;
+
+    void clear();
+};
+
+// Binary input log (--record / --replay in main.cpp). Layout (native byte order):
+//      "OGLI", uint32 version
+//      per frame: uint8 flags (bits 0-3: keys, 4: mouse moves, 5: scrolls, 6: key events), float deltaTime,
+//                 then for each list flagged: uint16 count + the items (float x, y | float y | int16 key, uint8 action)
+// Idle frames take 5 bytes.
+class InputRecorder
+{
+public:
+    InputRecorder(const std::string &path);
+    ~InputRecorder();
+
+    InputRecorder(const InputRecorder &) = delete;
+    InputRecorder &operator=(const InputRecorder &) = delete;
+
+    bool isOpen() const { return file.is_open(); }
+
+    InputFrame &current() { return frame; }     // Callbacks append their events here
+    void endFrame(float deltaTime, unsigned keys);      // Writes the current frame and starts the next one
+
+    double   getTime()   const { return time; } // Sum of the delta times recorded (what a replay will see)
+    unsigned getFrames() const { return frames; }
+    size_t   getBytes()  const { return bytes; }
+
+private:
+    std::ofstream file;
+    InputFrame    frame;
+    unsigned      frames;
+    size_t        bytes;
+    double        time;
+};
+
+class InputPlayer
+{
+public:
+    InputPlayer(const std::string &path);
+
+    bool isOpen() const { return valid; }
+    bool next(InputFrame &frame);               // false at the end of the log (or if it's damaged)
+
+    double   getTime()   const { return time; } // Sum of the delta times replayed
+    unsigned getFrames() const { return frames; }
+
+private:
+    std::vector<char> data;
+    size_t   position;
+    bool     valid;
+    double   time;
+    unsigned frames;
+};
+
+#endif
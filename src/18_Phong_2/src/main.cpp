@@ -19,18 +19,59 @@
 #include "auxiliar.hpp"     // chronometer, fps
 #include "camera.hpp"
 #include "shader.hpp"
+#include "meshImporter.hpp"
+#include "vertexFormat.hpp"
+#include "benchmarks.hpp"
+#include "gpuScene.hpp"
+#include "hiZ.hpp"
+#include "occlusionRasterizer.hpp"
+#include "renderQueue.hpp"
+#include "glState.hpp"
+#include "clusteredLights.hpp"
+#include "deferredRenderer.hpp"
+#include "gpuTimer.hpp"
+#include "shadowMaps.hpp"
+#include "softRasterizer.hpp"
+#include "regressionTest.hpp"
+#include "frameCapture.hpp"
+#include "inputLog.hpp"
+#include "cameraPath.hpp"
+#include "floatingOrigin.hpp"
+#include "overdrawView.hpp"
+#include "frameArena.hpp"
+#include "renderGraph.hpp"
+#include "perfOverlay.hpp"
+#include "gpuMemory.hpp"
+#include "glHandle.hpp"
+
+#include "imgui.h"
 
 #include <iostream>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cctype>
 
 // Function declarations --------------------
 
 void framebuffer_resize_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
+void handleKey(int key, int action);
+void moveCamera(unsigned keys, float deltaTime);
+bool replayInput();
 
 void printOGLdata();
 
+struct SceneObject;
+void buildScene(std::pmr::vector<SceneObject> &scene, float time, const glm::mat4 *modelFit, bool withFloor,
+                const Material *cubeMaterial, const Material *floorMaterial,
+                const glm::dvec3 &site = glm::dvec3(0.0), const glm::dvec3 &origin = glm::dvec3(0.0));
+int  renderSoftware(const std::string &path, const MeshData &mesh, const glm::mat4 &modelFit, unsigned frames = 30);
+
 // Settings (typedef and global data section) --------------------
 
 // window size
@@ -43,16 +84,228 @@ float lastX =  SCR_WIDTH  / 2.0;
 float lastY =  SCR_HEIGHT / 2.0;
 bool firstMouse = true;
 
+// input log: --record writes the input of each frame, --replay reads it instead of GLFW (same camera, same scene time)
+InputRecorder *inputRecorder = nullptr;
+InputPlayer   *inputPlayer   = nullptr;
+
 // timing
 timerSet timer;
 
 // lighting
-glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
+glm::vec3 lightPos(1.2f, 1.0f, 2.0f);       // site-local
+bool deferredShading = false;       // G key toggles forward / deferred shading
+OverdrawView::Mode overdrawMode = OverdrawView::OFF;    // O key cycles the overdraw heatmap: off / shaded / all fragments
+
+// performance overlay
+bool showOverlay   = true;          // F1 shows / hides it
+bool overlayCursor = false;         // Tab: the cursor goes to the overlay (its controls) instead of the camera
+
+// scene: the same description is drawn with OpenGL and with SoftRasterizer (--soft)
+const glm::vec3 cubePositions1[] = {
+    glm::vec3( 0.0f,  0.0f,  0.0f),
+    glm::vec3( 2.0f,  5.0f, -15.0f),
+    glm::vec3(-1.5f, -2.2f, -2.5f),
+    glm::vec3(-3.8f, -2.0f, -12.3f),
+    glm::vec3( 2.4f, -0.4f, -3.5f),
+    glm::vec3(-1.7f,  3.0f, -7.5f),
+    glm::vec3( 1.3f, -2.0f, -2.5f),
+    glm::vec3( 1.5f,  2.0f, -2.5f),
+    glm::vec3( 1.5f,  0.2f, -1.5f),
+    glm::vec3(-1.3f,  1.0f, -1.5f)
+};
+
+const float cubeVertices[] = {
+    // position           // normals
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+     0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+     0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+
+     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
+};
+
+struct SceneObject
+{
+    glm::mat4 model;
+    bool      isModel;                      // loaded model instead of a cube
+    float     radius;                       // bounding sphere (centered at the object's origin)
+    const Material *material;
+};
 
 // Function definitions --------------------
 
-int main()
+int main(int argc, char *argv[])
 {
+    // ----- Command line: [model.obj|model.ply] [--packed] [--lights N] [--deferred] [--shadows] [--shadow-res N] [--cascades N]
+    //                    [--gpu-driven N] [--occlusion] [--bench-formats] [--bench-stream] [--bench-lights] [--bench-gpu-driven]
+    //                    [--bench-occlusion] [--soft out.ppm] [--bench-soft] [--regress dir] [--regress-frames N] [--regress-update]
+    //                    [--regress-images] [--regress-out dir] [--capture out.y4m|out] [--record input.log] [--replay input.log]
+    //                    [--flythrough path.txt] [--site X Y Z] [--rebase D] [--fixed-origin] [--bench-origin] [--prepass] [--overdraw]
+    //                    [--memory-budget MB] [--bench-memory]
+    std::string modelPath;
+    bool packedVertices = false, benchFormats = false, benchStream = false, benchLights = false, benchGpuDriven = false;
+    bool benchOcclusion = false, benchSoft = false;
+    std::string softOutput;                 // not empty: render with SoftRasterizer into this PPM, without GL
+    unsigned numPointLights = 0;            // > 0: clustered forward shading with this many point lights
+    bool shadowsEnabled = false;            // directional light with cascaded shadow maps (and a floor to receive them)
+    unsigned shadowResolution = 2048, numCascades = 4;
+    unsigned numGpuObjects = 0;             // > 0: field of spheres drawn with GpuScene (compute culling + multi-draw indirect)
+    bool occlusionCulling = false;          // Hi-Z for the GpuScene objects, CPU occlusion rasterizer for the rest
+    std::string regressionDir;              // not empty: headless golden image / frame time test (see RegressionTest)
+    std::string regressionName = "18_Phong_2";  // plus the options, so each configuration has its own goldens
+    unsigned regressionFrames = 120;
+    bool regressionUpdate = false;
+    bool regressionTimes = true;            // false (--regress-images): golden images only, frame times just reported
+    std::string regressionOut;              // failed images (actual, diff); empty: working directory
+    std::string capturePath;                // not empty: record the session (FrameCapture: .y4m video or PNG sequence)
+    std::string recordPath, replayPath;     // input log (InputRecorder / InputPlayer)
+    std::string flyThroughPath;             // not empty: timed fly-through of a camera path (FlyThrough), per segment report
+    glm::dvec3 siteOrigin(0.0);             // world position of the scene (e.g. 1e6 to test precision far from the world origin)
+    double rebaseDistance = 0;              // FloatingOrigin: 0 camera-relative, > 0 rebase distance, < 0 (--fixed-origin) float world space
+    bool benchOrigin = false;
+    bool depthPrepass = false;              // forward shading: depth-only pre-pass, then shading with GL_EQUAL (no overdraw)
+    bool countFragments = false;            // GL_SAMPLES_PASSED of the scene pass: fragments shaded per pixel
+    size_t memoryBudgetMB = 0;              // > 0: gpuMemory evicts streamable textures above it (--memory-budget MB)
+    bool benchMemory = false;
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(arg == "--packed")             packedVertices = true;
+        else if(arg == "--lights" && i + 1 < argc) numPointLights = (unsigned)std::stoul(argv[++i]);
+        else if(arg == "--deferred")      deferredShading = true;
+        else if(arg == "--shadows")       shadowsEnabled = true;
+        else if(arg == "--shadow-res" && i + 1 < argc) shadowResolution = (unsigned)std::stoul(argv[++i]);
+        else if(arg == "--cascades" && i + 1 < argc)   numCascades = (unsigned)std::stoul(argv[++i]);
+        else if(arg == "--bench-formats") benchFormats = true;
+        else if(arg == "--bench-stream")  benchStream = true;
+        else if(arg == "--gpu-driven" && i + 1 < argc) numGpuObjects = (unsigned)std::stoul(argv[++i]);
+        else if(arg == "--bench-lights")  benchLights = true;
+        else if(arg == "--occlusion")     occlusionCulling = true;
+        else if(arg == "--bench-gpu-driven") benchGpuDriven = true;
+        else if(arg == "--bench-occlusion")  benchOcclusion = true;
+        else if(arg == "--soft" && i + 1 < argc) softOutput = argv[++i];
+        else if(arg == "--bench-soft")    benchSoft = true;
+        else if(arg == "--regress" && i + 1 < argc) regressionDir = argv[++i];
+        else if(arg == "--regress-frames" && i + 1 < argc) regressionFrames = (unsigned)std::stoul(argv[++i]);
+        else if(arg == "--regress-update") regressionUpdate = true;
+        else if(arg == "--regress-images") regressionTimes = false;
+        else if(arg == "--regress-out" && i + 1 < argc) regressionOut = argv[++i];
+        else if(arg == "--capture" && i + 1 < argc) capturePath = argv[++i];
+        else if(arg == "--record" && i + 1 < argc)  recordPath = argv[++i];
+        else if(arg == "--replay" && i + 1 < argc)  replayPath = argv[++i];
+        else if(arg == "--flythrough" && i + 1 < argc) flyThroughPath = argv[++i];
+        else if(arg == "--site" && i + 3 < argc)
+        {
+            siteOrigin.x = std::stod(argv[++i]);
+            siteOrigin.y = std::stod(argv[++i]);
+            siteOrigin.z = std::stod(argv[++i]);
+        }
+        else if(arg == "--rebase" && i + 1 < argc) rebaseDistance = std::stod(argv[++i]);
+        else if(arg == "--fixed-origin")  rebaseDistance = -1;
+        else if(arg == "--bench-origin")  benchOrigin = true;
+        else if(arg == "--prepass")       depthPrepass = true;
+        else if(arg == "--overdraw")      countFragments = true;
+        else if(arg == "--memory-budget" && i + 1 < argc) memoryBudgetMB = (size_t)std::stoul(argv[++i]);
+        else if(arg == "--bench-memory")  benchMemory = true;
+        else modelPath = arg;
+    }
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(arg == "--regress" || arg == "--regress-frames" || arg == "--regress-out" || arg == "--capture" || arg == "--record" || arg == "--replay" ||
+           arg == "--flythrough" || arg == "--rebase" || arg == "--memory-budget") ++i;
+        else if(arg == "--site") i += 3;                // same goldens wherever the scene is: they test the precision
+        else if(arg != "--regress-update" && arg != "--regress-images" && arg != "--fixed-origin" && arg != "--prepass" && arg != "--overdraw")
+        {
+            regressionName += '_';
+            for(char c : arg.substr(arg.find_last_of("/\\") + 1))      // file name only, for model paths
+                if(std::isalnum((unsigned char)c)) regressionName += c;
+        }
+    }
+
+    if(!replayPath.empty())
+    {
+        inputPlayer = new InputPlayer(replayPath);
+        if(!inputPlayer->isOpen()) return -1;
+    }
+    else if(!recordPath.empty())
+        inputRecorder = new InputRecorder(recordPath);
+
+    CameraPath cameraPath;
+    if(!flyThroughPath.empty() && !cameraPath.load(flyThroughPath)) return -1;
+
+    // ----- Load a model (OBJ or binary PLY). It replaces the central cube.
+    MeshData mesh;
+    if(!modelPath.empty())
+    {
+        MeshImporter importer;
+        if(importer.load(modelPath, mesh))
+            std::cout << "Model loaded: " << modelPath << " (" << mesh.numVertices() << " vertices, " << mesh.numTriangles() <<
+                         " triangles, " << importer.lastLoadTime << " s)" << std::endl;
+    }
+
+    glm::mat4 modelFit = glm::mat4(1.0f);       // scales and centers the model into a unit box
+    if(!mesh.vertices.empty())
+    {
+        glm::vec3 size = mesh.maxBound - mesh.minBound;
+        float maxSize = std::max(size.x, std::max(size.y, size.z));
+        modelFit = glm::scale(glm::mat4(1.0f), glm::vec3(maxSize > 0.0f ? 1.0f / maxSize : 1.0f));
+        modelFit = glm::translate(modelFit, -(mesh.minBound + mesh.maxBound) * 0.5f);
+    }
+
+    // ----- Without GPU: software rasterizer, camera-relative transforms
+    if(benchSoft)
+    {
+        benchmarkSoftRasterizer();
+        return 0;
+    }
+
+    if(benchOrigin)
+    {
+        benchmarkCameraRelative();
+        return 0;
+    }
+
+    if(!softOutput.empty())
+        return renderSoftware(softOutput, mesh, modelFit);
+
+
     // glfw: initialize and configure
     if (!glfwInit())
     {
@@ -61,6 +314,7 @@ int main()
     }
 
     glfwWindowHint(GLFW_SAMPLES, 0);                                // antialiasing
+    if(!regressionDir.empty()) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);    // headless (e.g. llvmpipe in CI)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -82,6 +336,7 @@ int main()
     glfwSetFramebufferSizeCallback(window, framebuffer_resize_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);        // Sticky keys: Make sure that any pressed key is captured
@@ -108,15 +363,113 @@ int main()
     // ----- OGL general options
     printOGLdata();
 
-    glEnable(GL_DEPTH_TEST);
+    glState.enable(GL_DEPTH_TEST);
     glFrontFace(GL_CCW);
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);    // Wireframe mode
     //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);    // Back to default
 
+    if(benchStream)
+    {
+        benchmarkStreaming(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    if(benchLights)
+    {
+        benchmarkClusteredLights(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    if(benchGpuDriven)
+    {
+        benchmarkGpuDriven(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    if(benchOcclusion)
+    {
+        benchmarkOcclusion(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    gpuMemory.setBudget(memoryBudgetMB << 20);
+
+    if(benchMemory)
+    {
+        benchmarkMemoryBudget(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    if(benchFormats)
+    {
+        if(mesh.vertices.empty()) makeSphere(mesh, 256, 512);
+        benchmarkVertexFormats(window, mesh);
+        glfwTerminate();
+        return 0;
+    }
+
+    PackedVertices modelVertices;
+    if(!mesh.vertices.empty())
+        modelVertices.compile(VertexInput{ mesh.vertices.data(), mesh.numVertices(), MeshData::stride, 0, 3, -1 },
+                              packedVertices ? VertexFormat::packed() : VertexFormat::floats());
+
     // ----- Build and compile our shader program
+    const char *litFragmentShader = numPointLights ? "../../../src/18_Phong_2/shaders/clusteredFragS.fs" :
+                                                     "../../../src/18_Phong_2/shaders/lightingFragS.fs";
+    std::string shadowPrelude = CascadedShadowMaps::shaderPrelude("../../../src/18_Phong_2/shaders/");
+
     Shader lightingProgram(
                 "../../../src/18_Phong_2/shaders/vertexShader.vs",
-                "../../../src/18_Phong_2/shaders/lightingFragS.fs" );
+                litFragmentShader,
+                "",
+                shadowPrelude );
+
+    Shader modelProgram(                        // lighting for the loaded model (float or packed vertex format)
+                "../../../src/18_Phong_2/shaders/vertexShaderPacked.vs",
+                litFragmentShader,
+                modelVertices.shaderPrelude(),
+                shadowPrelude );
+
+    Shader gbufferProgram(                      // deferred shading: geometry pass
+                "../../../src/18_Phong_2/shaders/vertexShader.vs",
+                "../../../src/18_Phong_2/shaders/gbufferFragS.fs" );
+
+    Shader gbufferModelProgram(
+                "../../../src/18_Phong_2/shaders/vertexShaderPacked.vs",
+                "../../../src/18_Phong_2/shaders/gbufferFragS.fs",
+                modelVertices.shaderPrelude() );
+
+    Shader shadowDepthProgram(                  // shadow maps: depth only
+                "../../../src/18_Phong_2/shaders/shadowDepth.vs",
+                nullptr );
+
+    Shader shadowDepthModelProgram(
+                "../../../src/18_Phong_2/shaders/shadowDepthPacked.vs",
+                nullptr,
+                modelVertices.shaderPrelude() );
+
+    Shader depthPrepassProgram(                 // depth pre-pass: position-only stream
+                "../../../src/18_Phong_2/shaders/depthPrepass.vs",
+                nullptr );
+
+    Shader depthPrepassModelProgram(
+                "../../../src/18_Phong_2/shaders/depthPrepassPacked.vs",
+                nullptr,
+                modelVertices.shaderPrelude() );
+
+    Shader overdrawProgram(                     // overdraw view: counts fragments
+                "../../../src/18_Phong_2/shaders/depthPrepass.vs",
+                "../../../src/18_Phong_2/shaders/overdrawFragS.fs" );
+
+    Shader overdrawModelProgram(
+                "../../../src/18_Phong_2/shaders/depthPrepassPacked.vs",
+                "../../../src/18_Phong_2/shaders/overdrawFragS.fs",
+                modelVertices.shaderPrelude() );
 
     Shader lightSourceProgram(
                 "../../../src/18_Phong_2/shaders/vertexShader.vs",
@@ -181,71 +534,13 @@ int main()
             -0.5f, -0.5f, -0.5f,   0.0f, 1.0f
         };
 
-    glm::vec3 cubePositions1[] = {
-        glm::vec3( 0.0f,  0.0f,  0.0f),
-        glm::vec3( 2.0f,  5.0f, -15.0f),
-        glm::vec3(-1.5f, -2.2f, -2.5f),
-        glm::vec3(-3.8f, -2.0f, -12.3f),
-        glm::vec3( 2.4f, -0.4f, -3.5f),
-        glm::vec3(-1.7f,  3.0f, -7.5f),
-        glm::vec3( 1.3f, -2.0f, -2.5f),
-        glm::vec3( 1.5f,  2.0f, -2.5f),
-        glm::vec3( 1.5f,  0.2f, -1.5f),
-        glm::vec3(-1.3f,  1.0f, -1.5f)
-    };
-
-    float vertices[] = {
-        // position           // normals
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
-    };
-
-    unsigned cubeVAO, VBO, EBO;
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &VBO);
-    //glGenBuffers(1, &EBO);
+    // GL objects are owned by handles (see glHandle.hpp): they're released to deletionQueue when they go out of scope
+    VertexArrayHandle cubeVAO = VertexArrayHandle::generate();
+    BufferHandle VBO = BufferHandle::generate();
+    //BufferHandle EBO = BufferHandle::generate();
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);  // GL_DYNAMIC_DRAW, GL_STATIC_DRAW, GL_STREAM_DRAW
+    gpuMemory.bufferData(VBO, GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW, "cube");  // GL_DYNAMIC_DRAW, GL_STATIC_DRAW, GL_STREAM_DRAW
     //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     //glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
@@ -264,13 +559,58 @@ int main()
     glBindVertexArray(0);                       // unbind VAO (not usual)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);   // unbind EBO
 
-    unsigned int lightSourceVAO;
-    glGenVertexArrays(1, &lightSourceVAO);
+    VertexArrayHandle lightSourceVAO = VertexArrayHandle::generate();
     glBindVertexArray(lightSourceVAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)nullptr);
     glEnableVertexAttribArray(0);
+
+    // Position-only copy of the cube (depth-only passes: shadow maps, depth pre-pass)
+    std::vector<float> cubePositions;
+    for(size_t v = 0; v < 36; ++v)
+        cubePositions.insert(cubePositions.end(), &cubeVertices[v * 6], &cubeVertices[v * 6 + 3]);
+
+    VertexArrayHandle cubeDepthVAO = VertexArrayHandle::generate();
+    BufferHandle cubeDepthVBO = BufferHandle::generate();
+    glBindVertexArray(cubeDepthVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeDepthVBO);
+    gpuMemory.bufferData(cubeDepthVBO, GL_ARRAY_BUFFER, cubePositions.size() * sizeof(float), cubePositions.data(), GL_STATIC_DRAW, "cube");
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)nullptr);
+    glEnableVertexAttribArray(0);
+
+    // ----- Model buffers
+    VertexArrayHandle modelVAO, modelDepthVAO;
+    BufferHandle modelVBO, modelEBO, modelDepthVBO;
+    size_t modelIndexCount = 0;
+
+    if(!mesh.vertices.empty())
+    {
+        modelVAO = VertexArrayHandle::generate();
+        modelVBO = BufferHandle::generate();
+        modelEBO = BufferHandle::generate();
+
+        glBindVertexArray(modelVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, modelVBO);
+        gpuMemory.bufferData(modelVBO, GL_ARRAY_BUFFER, modelVertices.data.size(), modelVertices.data.data(), GL_STATIC_DRAW, "model");
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelEBO);
+        gpuMemory.bufferData(modelEBO, GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned), mesh.indices.data(), GL_STATIC_DRAW, "model");
+        modelVertices.setupAttributes();           // position (location 0) + normal (location 3)
+
+        std::vector<uint8_t> positions = modelVertices.positionStream();
+        modelDepthVAO = VertexArrayHandle::generate();
+        modelDepthVBO = BufferHandle::generate();
+        glBindVertexArray(modelDepthVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, modelDepthVBO);
+        gpuMemory.bufferData(modelDepthVBO, GL_ARRAY_BUFFER, positions.size(), positions.data(), GL_STATIC_DRAW, "model");
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelEBO);
+        modelVertices.setupPositionAttribute();
+        glBindVertexArray(0);
+
+        std::cout << "Vertex format: " << modelVertices.stride << " bytes/vertex" << std::endl;
+
+        modelIndexCount = mesh.indices.size();
+    }
 /*
     // ----- Load and create a texture
     unsigned texture1, texture2;
@@ -326,121 +666,708 @@ int main()
 
     // ----- Other operations
 
+    // Render queue: per-frame uniforms are set when a program is first bound in each flush()
+    RenderQueue renderQueue;
+    glm::mat4 view, projection;
+
+    // Render space: world positions relative to the floating origin (see FloatingOrigin). Point lights are converted to it
+    // every frame. GPU driven objects are uploaded once in site-local coordinates and drawn with siteView (view relative
+    // to the site) instead.
+    FloatingOrigin floatingOrigin(rebaseDistance);
+    glm::mat4 siteView;
+    glm::vec3 renderCamPos, renderLightPos;
+    cam.Position += siteOrigin;
+
+    auto setFrameUniforms = [&](Shader &program)
+    {
+        program.setMat4("projection", projection);
+        program.setMat4("view", view);
+        program.setVec3("lightColor",  1.0f, 1.0f, 1.0f);
+        program.setVec3("lightPos", renderLightPos);
+        program.setVec3("camPos", renderCamPos);
+    };
+    // Point lights (--lights N): the white light plus N - 1 random ones around the cubes
+    ClusteredLights clusteredLights;
+    std::vector<PointLight> pointLights;            // site-local
+    std::vector<PointLight> renderLights;           // render space, this frame
+    if(numPointLights)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        pointLights.push_back(PointLight{ lightPos, 10.0f, glm::vec3(1.0f), 4.0f });
+        for(unsigned i = 1; i < numPointLights; ++i)
+            pointLights.push_back(PointLight{ glm::vec3(unit(rng) * 10.0f - 5.0f, unit(rng) * 10.0f - 4.0f, unit(rng) * -18.0f + 2.0f),
+                                              2.0f, glm::vec3(unit(rng), unit(rng), unit(rng)), 2.0f });
+    }
+
+    // Shadows (--shadows): sun with cascaded shadow maps
+    CascadedShadowMaps *shadowMaps = shadowsEnabled ? new CascadedShadowMaps(shadowResolution, numCascades) : nullptr;
+    glm::vec3 sunDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+    unsigned shadowCascade = 0;                 // cascade being rendered
+    unsigned castersDrawn[CSM_MAX_CASCADES] = { 0 };
+
+    // GPU driven objects (--gpu-driven N): field of spheres under the cubes, culled and drawn in a single multi-draw
+    GpuScene *gpuScene = nullptr;
+    if(numGpuObjects && !GpuScene::supported())
+        std::cout << "--gpu-driven needs OpenGL 4.3" << std::endl;
+    else if(numGpuObjects)
+    {
+        gpuScene = new GpuScene;
+        MeshData sphere;
+        makeSphere(sphere, 12, 24);
+        unsigned sphereMesh = gpuScene->addMesh(sphere);
+
+        std::mt19937 rng(2);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        unsigned side = (unsigned)std::ceil(std::sqrt((float)numGpuObjects));
+        for(unsigned i = 0; i < numGpuObjects; ++i)
+        {
+            glm::vec3 pos(((float)(i % side) - (side - 1) * 0.5f) * 1.2f, -4.0f, ((float)(i / side) - (side - 1) * 0.5f) * 1.2f - 8.0f);
+            gpuScene->addObject(sphereMesh, glm::translate(glm::mat4(1.0f), pos), glm::vec3(unit(rng), unit(rng), unit(rng)));
+        }
+        gpuScene->build();
+    }
+
+    // Occlusion culling (--occlusion): the GPU driven objects are tested in gpuCull.cs against the previous frame's depth
+    // pyramid; the other objects on the CPU, against the cubes and the floor rasterized at low resolution
+    HiZBuffer *hiZ = occlusionCulling && gpuScene ? new HiZBuffer : nullptr;
+    OcclusionRasterizer occlusionRasterizer;
+
+    auto setLitUniforms = [&](Shader &program)
+    {
+        setFrameUniforms(program);
+        if(numPointLights) clusteredLights.bind(program, RQ_MAX_TEXTURE_UNITS);     // units after the material textures
+        if(shadowMaps) shadowMaps->bind(program, RQ_MAX_TEXTURE_UNITS + 3);
+    };
+
+    auto setShadowUniforms = [&](Shader &program) { program.setMat4("lightSpace", shadowMaps->getLightSpace(shadowCascade)); };
+    renderQueue.setProgramCallback(&shadowDepthProgram, setShadowUniforms);
+    renderQueue.setProgramCallback(&shadowDepthModelProgram, [&](Shader &program) { setShadowUniforms(program); modelVertices.setUniforms(program); });
+    renderQueue.setProgramCallback(&depthPrepassProgram, setFrameUniforms);
+    renderQueue.setProgramCallback(&depthPrepassModelProgram, [&](Shader &program) { setFrameUniforms(program); modelVertices.setUniforms(program); });
+    renderQueue.setProgramCallback(&overdrawProgram, setFrameUniforms);
+    renderQueue.setProgramCallback(&overdrawModelProgram, [&](Shader &program) { setFrameUniforms(program); modelVertices.setUniforms(program); });
+
+    renderQueue.setProgramCallback(&lightingProgram, setLitUniforms);
+    renderQueue.setProgramCallback(&lightSourceProgram, setFrameUniforms);
+    renderQueue.setProgramCallback(&modelProgram, [&](Shader &program) { setLitUniforms(program); modelVertices.setUniforms(program); });
+    renderQueue.setProgramCallback(&gbufferProgram, setFrameUniforms);
+    renderQueue.setProgramCallback(&gbufferModelProgram, [&](Shader &program) { setFrameUniforms(program); modelVertices.setUniforms(program); });
+
+    DeferredRenderer deferredRenderer;
+    GpuTimer gpuTimer;
+    GpuTimer *fragmentCounter = countFragments ? new GpuTimer(GL_SAMPLES_PASSED) : nullptr;
+    OverdrawView overdrawView;
+    RenderGraph renderGraph;
+    PerfOverlay *perfOverlay = new PerfOverlay(window);     // ImGui: deleted before the context
+
+    Material cubeMaterial;
+    cubeMaterial.id = 1;
+    cubeMaterial.color = glm::vec3(1.0f, 0.5f, 0.31f);
+
+    Material lightMaterial;
+    lightMaterial.id = 2;
+
+    Material floorMaterial;
+    floorMaterial.id = 3;
+    floorMaterial.color = glm::vec3(0.8f);
+
+    // Regression test (--regress): fixed frames, time step and camera path; unthrottled to measure frame times
+    RegressionTest *regression = regressionDir.empty() ? nullptr : new RegressionTest(regressionDir, regressionName, regressionFrames,
+                                                                                          regressionUpdate, regressionTimes, regressionOut);
+
+    // Fly-through (--flythrough): the camera follows the path at a fixed time step per frame, unthrottled
+    FlyThrough *flyThrough = flyThroughPath.empty() ? nullptr : new FlyThrough(cameraPath);
+
+    FrameCapture *frameCapture = capturePath.empty() ? nullptr : new FrameCapture(capturePath, 30);
+
     timer.startTime();
-    timer.setMaxFPS(30);
+    timer.setMaxFPS(regression || flyThrough || inputPlayer ? 0 : 30);
+    if(regression || flyThrough || inputPlayer) glfwSwapInterval(0);
+    if(regression || flyThrough) showOverlay = false;      // measured runs: nothing over the frames, stats on stdout
+
+    // Optimization modes that can change at runtime (Tab, then click)
+    bool frameLimiter = !(regression || flyThrough || inputPlayer);
+    perfOverlay->setControls([&]()
+    {
+        ImGui::Checkbox("Deferred shading (G)", &deferredShading);
+        ImGui::Checkbox("Depth pre-pass (forward)", &depthPrepass);
+        ImGui::Checkbox("Occlusion culling (CPU)", &occlusionCulling);
+        int overdraw = overdrawMode;
+        if(ImGui::Combo("Overdraw view (O)", &overdraw, "Off\0Shaded\0All rasterized\0"))
+            overdrawMode = (OverdrawView::Mode)overdraw;
+        if(ImGui::Checkbox("Frame limiter (30 fps)", &frameLimiter))
+            timer.setMaxFPS(frameLimiter ? 30 : 0);
+    });
+
+    // Each pass is a CPU scope of the overlay and a GPU timer scope with the same name
+    auto beginPass = [&](const char *name) { perfOverlay->beginScope(name); gpuTimer.begin(name); };
+    auto endPass   = [&]() { gpuTimer.end(); perfOverlay->endScope(); };
+    renderGraph.setPassCallbacks(beginPass, endPass);
+
+    glState.invalidate();           // setup code and benchmarks used raw gl* calls
 
     // ----- Render loop
-    while (!glfwWindowShouldClose(window))
+    while (!glfwWindowShouldClose(window) && !(regression && regression->done()) && !(flyThrough && flyThrough->done()))
     {
         timer.computeDeltaTime();
-
-        processInput(window);
+        perfOverlay->beginScope("frame");
+        glState.beginFrame();
+        frameArena.beginFrame();                    // before anything allocates the frame's lists (render queue, graph)
+        renderQueue.beginFrame();
+        deletionQueue.beginFrame();                 // objects released DELETION_FRAMES ago, before the budget check
+        gpuMemory.beginFrame();
+
+        perfOverlay->beginScope("input");
+
+        if(regression) regression->setCamera(cam);
+        else if(flyThrough) flyThrough->setCamera(cam);
+        else if(inputPlayer)
+        {
+            if(!replayInput()) break;           // end of the log
+        }
+        else processInput(window);
+        if(regression || flyThrough) cam.Position += siteOrigin;       // their camera paths are site-local
+        perfOverlay->endScope();
 
         // render ----------
 
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);           // GL_STENCIL_BUFFER_BIT
-
-        lightingProgram.UseProgram();
-        lightingProgram.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
-        lightingProgram.setVec3("lightColor",  1.0f, 1.0f, 1.0f);
-        lightingProgram.setVec3("lightPos", lightPos);
-        lightingProgram.setVec3("camPos", cam.Position);
+        int fbWidth, fbHeight;
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        bool deferred = deferredShading;
 
         //glActiveTexture(GL_TEXTURE0);           // Bind textures on corresponding texture unit
         //glBindTexture(GL_TEXTURE_2D, texture1);
         //glActiveTexture(GL_TEXTURE1);
         //glBindTexture(GL_TEXTURE_2D, texture2);
 
-        //myProgram.UseProgram();
+        projection = glm::perspective(glm::radians(cam.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f); // If it doesn't change each frame, it can be placed outside the render loop
+        floatingOrigin.update(cam.Position);
+        view = cam.GetViewMatrix(floatingOrigin.get());
+        siteView = cam.GetViewMatrix(siteOrigin);
+        renderCamPos = floatingOrigin.toRender(cam.Position);
+        renderLightPos = floatingOrigin.toRender(siteOrigin + glm::dvec3(lightPos));
+        renderQueue.setView(view, 100.0f);
 
-        //glm::mat4 model = glm::mat4(1.0f);
-        //model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-        //model = glm::rotate(model, (float)chron.GetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
-        //model = glm::scale(model, glm::vec3(1.0, 1.0, 1.0));
+        if(numPointLights)
+        {
+            // Shaded against render space fragment positions, and assigned to clusters with the same view
+            renderLights = pointLights;
+            for(PointLight &light : renderLights) light.position = floatingOrigin.toRender(siteOrigin + glm::dvec3(light.position));
+            clusteredLights.update(renderLights, view, glm::radians(cam.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        }
 
-        glm::mat4 projection = glm::perspective(glm::radians(cam.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f); // If it doesn't change each frame, it can be placed outside the render loop
-        lightingProgram.setMat4("projection", projection);
+        // Lit cubes (the first one is replaced by the loaded model, if any) and, with shadows, a floor to receive them
+        float sceneTime = regression    ? (float)regression->getTime()    :
+                          flyThrough    ? (float)flyThrough->getTime()    :
+                          inputPlayer   ? (float)inputPlayer->getTime()   :
+                          inputRecorder ? (float)inputRecorder->getTime() : (float)timer.getTime();
+        // Per-frame lists (objects and their matrices, culling results) live in frameArena
+        std::pmr::vector<SceneObject> scene(frameArena.resource());
+        perfOverlay->beginScope("scene");
+        buildScene(scene, sceneTime, modelVAO ? &modelFit : nullptr, shadowMaps != nullptr, &cubeMaterial, &floorMaterial,
+                   siteOrigin, floatingOrigin.get());
+        perfOverlay->endScope();
+
+        auto sceneItem = [&](const SceneObject &object, Shader *cubeProgram, Shader *meshProgram)
+        {
+            DrawItem item;
+            item.material = object.material;
+            item.model    = object.model;
+            if(object.isModel)
+            {
+                item.program = meshProgram;
+                item.VAO     = modelVAO;
+                item.count   = (GLsizei)modelIndexCount;
+                item.indexed = true;
+            }
+            else
+            {
+                item.program = cubeProgram;
+                item.VAO     = cubeVAO;
+                item.count   = 36;
+            }
+            return item;
+        };
 
-        glm::mat4 view = cam.GetViewMatrix();
-        lightingProgram.setMat4("view", view);
+        // Depth-only passes use the position-only streams, and no material: a single program sorts purely front to back
+        auto depthItem = [&](const SceneObject &object, Shader *cubeProgram, Shader *meshProgram)
+        {
+            DrawItem item = sceneItem(object, cubeProgram, meshProgram);
+            item.VAO      = object.isModel ? modelDepthVAO : cubeDepthVAO;
+            item.material = nullptr;
+            return item;
+        };
+        bool prepass = depthPrepass && !deferred;
 
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, 0.0f, glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        lightingProgram.setMat4("model", model);
+        std::pmr::vector<bool> visible(scene.size(), true, frameArena.resource());
+        if(occlusionCulling)
+        {
+            perfOverlay->beginScope("occlusion");
+            occlusionRasterizer.clear(projection * view);
+            for(const SceneObject &object : scene)
+                if(!object.isModel) occlusionRasterizer.addOccluder(object.model);       // cubes and floor fill their box
+            occlusionRasterizer.build();
+            for(size_t i = 0; i < scene.size(); ++i)
+                visible[i] = occlusionRasterizer.visible(glm::vec3(scene[i].model[3]), scene[i].radius);
+            perfOverlay->endScope();
+        }
+        auto drawn = [&](const SceneObject &object) { return visible[&object - scene.data()]; };
+
+        if(shadowMaps)
+            shadowMaps->update(sunDirection, view, glm::radians(cam.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f,
+                               floatingOrigin.toRender(siteOrigin));     // snapped relative to the site, not the moving origin
+
+        // Frame graph: the G-buffer and overdraw targets are transient (pooled, and shared when their lifetimes allow it);
+        // the shadow maps and the Hi-Z pyramid keep their own textures
+        renderGraph.reset();
+        RenderGraph::Resource backbuffer = renderGraph.importBackbuffer(fbWidth, fbHeight);
+        RenderGraph::Resource shadowMap  = shadowMaps ? renderGraph.importTexture("shadow maps", shadowMaps->getTexture()) : RenderGraph::NONE;
+        RenderGraph::Resource hiZPyramid = hiZ ? renderGraph.importTexture("hi-z", hiZ->getTexture(), true) : RenderGraph::NONE;
+
+        auto readShadows = [&](RenderGraph::Builder &pass) { if(shadowMap != RenderGraph::NONE) pass.read(shadowMap); };
+
+        // Shadow maps: each cascade only draws the casters that can throw shadow into it
+        if(shadowMaps)
+            renderGraph.addPass("shadows", [&](RenderGraph::Builder &pass) { pass.write(shadowMap); }, [&]()
+            {
+                for(shadowCascade = 0; shadowCascade < shadowMaps->getNumCascades(); ++shadowCascade)
+                {
+                    shadowMaps->beginCascade(shadowCascade);
+                    castersDrawn[shadowCascade] = 0;
+                    for(const SceneObject &object : scene)
+                        if(shadowMaps->casts(shadowCascade, glm::vec3(object.model[3]), object.radius))
+                        {
+                            renderQueue.submit(depthItem(object, &shadowDepthProgram, &shadowDepthModelProgram));
+                            ++castersDrawn[shadowCascade];
+                        }
+                    renderQueue.flush();
+                }
+                shadowMaps->endPass();
+            });
+
+        // Lit scene objects (G-buffer or forward programs), counted by the fragment counter
+        auto drawScene = [&]()
+        {
+            if(fragmentCounter) fragmentCounter->begin("scene");
+            for(const SceneObject &object : scene)
+                if(drawn(object))
+                    renderQueue.submit(deferred ? sceneItem(object, &gbufferProgram, &gbufferModelProgram) :
+                                                  sceneItem(object, &lightingProgram, &modelProgram));
+            renderQueue.flush();                        // in this pass, so its timers measure the scene
+            if(fragmentCounter) fragmentCounter->end();
+        };
 
-        glm::mat3 normalMatrix = glm::mat3( glm::transpose(glm::inverse(model)) );  // Used when the model matrix applies non-uniform scaling (normal won't be scaled correctly). Otherwise, use glm::vec3(model)
-        lightingProgram.setMat3("normalMatrix", normalMatrix);
+        // GPU driven objects (forward lit, in site-local space), in their own pass after the lit scene
+        auto addGpuScenePass = [&]()
+        {
+            renderGraph.addPass("gpu driven", [&](RenderGraph::Builder &pass) { pass.read(backbuffer); pass.write(backbuffer); }, [&]()
+            {
+                Shader &program = gpuScene->getProgram();
+                program.UseProgram();
+                program.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+                program.setVec3("lightPos", lightPos);
+                program.setVec3("camPos", glm::vec3(cam.Position - siteOrigin));
+                gpuScene->draw(siteView, projection, hiZ);
+            });
+        };
 
-        glBindVertexArray(cubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        // Unlit objects, on top of the lit ones
+        auto drawUnlit = [&]()
+        {
+            // Light source
+            DrawItem light;
+            light.program  = &lightSourceProgram;
+            light.material = &lightMaterial;
+            light.VAO      = lightSourceVAO;
+            light.count    = 36;
+            light.model    = glm::scale(glm::translate(glm::mat4(1.0f), renderLightPos), glm::vec3(0.2f));
+            renderQueue.submit(light);
+            renderQueue.flush();
+        };
 
-        /*
-        glBindVertexArray(VAO);
-        for(unsigned i = 0; i < 10; i++)
+        if(deferred)
         {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            model = glm::rotate(model, currentTime * glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
-            model = glm::scale(model, glm::vec3(1.0, 1.0, 1.0));
-            glUniformMatrix4fv(glGetUniformLocation(myProgram.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-            glDrawArrays(GL_TRIANGLES, 0, 6*2*3);
-            //glDrawElements(GL_TRIANGLES, 3*12, GL_UNSIGNED_INT, nullptr);
+            RenderGraph::Resource gAlbedo = renderGraph.createTexture("albedo, specular",    { DeferredRenderer::ALBEDO_FORMAT, fbWidth, fbHeight });
+            RenderGraph::Resource gNormal = renderGraph.createTexture("normal, shininess",   { DeferredRenderer::NORMAL_FORMAT, fbWidth, fbHeight });
+            RenderGraph::Resource gDepth  = renderGraph.createTexture("G-buffer depth",      { DeferredRenderer::DEPTH_FORMAT,  fbWidth, fbHeight });
+
+            renderGraph.addPass("geometry", [=](RenderGraph::Builder &pass) { pass.write(gAlbedo); pass.write(gNormal); pass.write(gDepth); }, [&]()
+            {
+                deferredRenderer.beginGeometryPass();
+                drawScene();
+            });
+
+            renderGraph.addPass("lighting", [&, gAlbedo, gNormal, gDepth](RenderGraph::Builder &pass)
+            {
+                pass.read(gAlbedo); pass.read(gNormal); pass.read(gDepth);
+                readShadows(pass);
+                pass.write(backbuffer);
+            },
+            [&, gAlbedo, gNormal, gDepth]()
+            {
+                glState.clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                DeferredRenderer::GBuffer gbuffer = { renderGraph.getTexture(gAlbedo), renderGraph.getTexture(gNormal), renderGraph.getTexture(gDepth) };
+                deferredRenderer.lightingPass(view, projection, renderCamPos, renderLightPos, glm::vec3(1.0f), gbuffer,
+                                              numPointLights ? &clusteredLights : nullptr, shadowMaps);
+                deferredRenderer.copyDepth(renderGraph.getFramebuffer({ gAlbedo, gNormal, gDepth }), fbWidth, fbHeight);
+            });
+
+            if(gpuScene) addGpuScenePass();
+            renderGraph.addPass("light sources", [&](RenderGraph::Builder &pass) { pass.read(backbuffer); pass.write(backbuffer); }, drawUnlit);
+        }
+        else
+        {
+            auto clear = [&]()
+            {
+                glState.enable(GL_DEPTH_TEST);
+                glState.clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);           // GL_STENCIL_BUFFER_BIT
+            };
+
+            if(prepass)
+                renderGraph.addPass("prepass", [&](RenderGraph::Builder &pass) { pass.write(backbuffer); }, [&, clear]()
+                {
+                    clear();
+                    glState.colorMask(false, false, false, false);
+                    for(const SceneObject &object : scene)
+                        if(drawn(object)) renderQueue.submit(depthItem(object, &depthPrepassProgram, &depthPrepassModelProgram));
+                    renderQueue.flush();
+                    glState.colorMask(true, true, true, true);
+                    glState.depthFunc(GL_EQUAL);                // shade only the nearest fragment of each pixel
+                    glState.depthMask(false);
+                });
+
+            renderGraph.addPass("forward lit", [&](RenderGraph::Builder &pass)
+            {
+                readShadows(pass);
+                if(prepass) pass.read(backbuffer);              // depth of the pre-pass
+                pass.write(backbuffer);
+            },
+            [&, clear]()
+            {
+                if(!prepass) clear();
+                drawScene();
+                if(prepass)
+                {
+                    glState.depthFunc(GL_LESS);
+                    glState.depthMask(true);
+                }
+            });
+
+            if(gpuScene) addGpuScenePass();
+            renderGraph.addPass("light sources", [&](RenderGraph::Builder &pass) { pass.read(backbuffer); pass.write(backbuffer); }, drawUnlit);
         }
-        */
-
-        lightSourceProgram.UseProgram();
-        lightSourceProgram.setMat4("projection", projection);
-        lightSourceProgram.setMat4("view", view);
 
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPos);
-        model = glm::rotate(model, 0.0f, glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, glm::vec3(0.2f));
-        lightSourceProgram.setMat4("model", model);
+        if(hiZ)
+            renderGraph.addPass("hi-z", [&](RenderGraph::Builder &pass) { pass.read(backbuffer); pass.write(hiZPyramid); }, [&]()
+            {
+                hiZ->build(fbWidth, fbHeight, projection * siteView);      // used by the next frame (GPU driven objects are site-local)
+            });
 
-        normalMatrix = glm::mat3(model);
-        lightingProgram.setMat3("normalMatrix", normalMatrix);
+        // Overdraw view (O key): the scene objects again, nearest first like the render queue, one at a time so each one
+        // gets its own sample query; then the heatmap over the frame and the per-object list
+        if(overdrawMode != OverdrawView::OFF)
+        {
+            RenderGraph::Resource overdrawCount = renderGraph.createTexture("overdraw count", { OverdrawView::COUNT_FORMAT, fbWidth, fbHeight });
+            RenderGraph::Resource overdrawDepth = renderGraph.createTexture("overdraw depth", { OverdrawView::DEPTH_FORMAT, fbWidth, fbHeight });
+
+            renderGraph.addPass("overdraw", [=](RenderGraph::Builder &pass) { pass.write(overdrawCount); pass.write(overdrawDepth); }, [&]()
+            {
+                std::pmr::vector<size_t> overdrawOrder(frameArena.resource());
+                for(size_t i = 0; i < scene.size(); ++i)
+                    if(drawn(scene[i])) overdrawOrder.push_back(i);
+                std::sort(overdrawOrder.begin(), overdrawOrder.end(), [&](size_t a, size_t b)
+                          { return (view * scene[a].model[3]).z > (view * scene[b].model[3]).z; });
+
+                overdrawView.begin(overdrawMode, fbWidth, fbHeight);
+                for(size_t i : overdrawOrder)
+                {
+                    const SceneObject &object = scene[i];
+                    overdrawView.beginObject(object.isModel ? "model" : object.material == &floorMaterial ? "floor" : "cube " + std::to_string(i));
+                    renderQueue.submit(depthItem(object, &overdrawProgram, &overdrawModelProgram));
+                    renderQueue.flush();
+                    overdrawView.endObject();
+                }
+                overdrawView.end();
+            });
+
+            renderGraph.addPass("overdraw heatmap", [&, overdrawCount](RenderGraph::Builder &pass) { pass.read(overdrawCount); pass.write(backbuffer); },
+                                [&, overdrawCount]() { overdrawView.drawHeatmap(renderGraph.getTexture(overdrawCount)); });
+        }
 
-        glBindVertexArray(lightSourceVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        // Overlays, in their own pass so their cost is measured too
+        if(showOverlay || overdrawMode != OverdrawView::OFF)
+            renderGraph.addPass("overlay", [&](RenderGraph::Builder &pass) { pass.write(backbuffer); }, [&]()
+            {
+                PerfOverlay::Counters counters;
+                const RenderQueue::Stats &queueStats = renderQueue.getFrameStats();
+                counters.draws        = queueStats.draws;
+                counters.triangles    = queueStats.triangles;
+                counters.programBinds = queueStats.programBinds;
+                counters.vaoBinds     = queueStats.vaoBinds;
+                counters.textureBinds = queueStats.textureBinds;
+                counters.stateCalls         = glState.getStats().totalForwarded();
+                counters.stateCallsFiltered = glState.getStats().totalFiltered();
+                counters.arenaAllocations     = frameArena.getFrameStats().allocations;
+                counters.arenaHeapAllocations = frameArena.getFrameStats().heapAllocations;
+                counters.arenaBytes           = frameArena.getFrameStats().bytes;
+
+                perfOverlay->newFrame(overlayCursor);
+                if(showOverlay) perfOverlay->draw(counters, gpuTimer);
+                if(overdrawMode != OverdrawView::OFF) overdrawView.drawOverlay(gpuTimer.get(deferred ? "geometry" : "forward lit"));
+                perfOverlay->render();
+                glState.invalidate();               // ImGui restores the GL state with raw calls
+            });
+
+        renderGraph.compile();
+        renderGraph.execute();
+        if(overdrawMode != OverdrawView::OFF) overdrawView.endFrame();
+
+        gpuTimer.endFrame();
+        if(fragmentCounter) fragmentCounter->endFrame();
+
+        if(timer.getFrameCounter() % 100 == 0)
+        {
+            if(deferred)
+                std::cout << "Deferred shading (G-buffer " << deferredRenderer.bytesPerPixel() << " bytes/pixel): geometry " << gpuTimer.get("geometry") <<
+                             " ms | lighting " << gpuTimer.get("lighting") << " ms | light sources " << gpuTimer.get("light sources") << " ms" << std::endl;
+            else if(prepass)
+                std::cout << "Forward shading with depth pre-pass: prepass " << gpuTimer.get("prepass") << " ms | forward lit " << gpuTimer.get("forward lit") <<
+                             " ms | light sources " << gpuTimer.get("light sources") << " ms" << std::endl;
+            else
+                std::cout << "Forward shading: lit " << gpuTimer.get("forward lit") << " ms | light sources " << gpuTimer.get("light sources") << " ms" << std::endl;
+
+            if(fragmentCounter)
+                std::cout << "Overdraw: " << (size_t)fragmentCounter->get("scene") << " scene fragments shaded | " <<
+                             fragmentCounter->get("scene") / ((double)fbWidth * fbHeight) << " per pixel" << std::endl;
+
+            if(shadowMaps)
+            {
+                std::cout << "Shadows (" << shadowMaps->getNumCascades() << " cascades, " << shadowMaps->getResolution() << "^2): " <<
+                             gpuTimer.get("shadows") << " ms | casters per cascade";
+                for(unsigned c = 0; c < shadowMaps->getNumCascades(); ++c) std::cout << " " << castersDrawn[c];
+                std::cout << " (of " << scene.size() << ")" << std::endl;
+            }
+
+            const RenderQueue::Stats &stats = renderQueue.getFrameStats();
+            std::cout << "Render queue: " << stats.draws << " draws | " << stats.triangles << " triangles | program binds " << stats.programBinds << " (" << stats.programBindsAvoided <<
+                         " avoided) | VAO binds " << stats.vaoBinds << " (" << stats.vaoBindsAvoided << " avoided) | texture binds " <<
+                         stats.textureBinds << " (" << stats.textureBindsAvoided << " avoided)" << std::endl;
+
+            if(numPointLights)
+                std::cout << "Clustered lights: " << numPointLights << " lights | assignment " << clusteredLights.assignTime << " ms | " <<
+                             clusteredLights.numLightIndices() << " light indices (max " << clusteredLights.maxLightsPerCluster() << " per cluster)" << std::endl;
+
+            if(gpuScene)
+                std::cout << "GPU driven: " << gpuScene->countVisible() << " of " << gpuScene->numObjects() << " objects visible (1 multi-draw, " <<
+                             gpuTimer.get("gpu driven") << " ms)" << std::endl;
+
+            if(hiZ)
+            {
+                GpuScene::CullStats cull = gpuScene->readStats();
+                std::cout << "Occlusion (Hi-Z, " << hiZ->getLevels() << " levels, " << gpuTimer.get("hi-z") << " ms): " << cull.tested << " tested | " <<
+                             cull.frustumCulled << " frustum culled | " << cull.occlusionCulled << " occlusion culled | " << cull.visible << " drawn" << std::endl;
+            }
+            if(occlusionCulling)
+            {
+                const OcclusionRasterizer::Stats &occlusion = occlusionRasterizer.getStats();
+                std::cout << "Occlusion (CPU, " << occlusionRasterizer.getWidth() << "x" << occlusionRasterizer.getHeight() << ", " << occlusion.rasterTime <<
+                             " ms): " << occlusion.occluders << " occluders | " << occlusion.tested << " tested | " << occlusion.occluded << " occlusion culled" << std::endl;
+            }
+
+            if(frameCapture)
+            {
+                FrameCapture::Stats capture = frameCapture->getStats();
+                std::cout << "Capture (" << (frameCapture->isPersistent() ? "persistent PBOs" : "PBOs + copy") << "): " << capture.captured << " frames | " <<
+                             capture.written << " written | " << capture.dropped << " dropped | render thread " << capture.renderTime <<
+                             " ms/frame | worker " << capture.encodeTime << " ms/frame" << std::endl;
+            }
+
+            if(siteOrigin != glm::dvec3(0.0) || rebaseDistance != 0)
+                std::cout << std::fixed << "Floating origin (" << (rebaseDistance < 0 ? "fixed" : rebaseDistance == 0 ? "camera-relative" : "rebasing") <<
+                             "): " << floatingOrigin.getRebases() << " rebases | origin " << floatingOrigin.get().x << ", " << floatingOrigin.get().y <<
+                             ", " << floatingOrigin.get().z << std::defaultfloat << std::endl;
+
+            gpuMemory.printLine();
+            std::cout << "Deletion queue: " << deletionQueue.getPending() << " pending | " << deletionQueue.getDeleted() << " deleted" << std::endl;
+            const FrameArena::Stats &arenaStats = frameArena.getFrameStats();
+            std::cout << "Frame arena: " << arenaStats.allocations << " allocations | " << arenaStats.bytes / 1024.0 << " KB of " <<
+                         frameArena.getCapacity() / 1024 << " KB | " << arenaStats.heapAllocations << " heap allocations" << std::endl;
+            renderGraph.print(gpuTimer);
+
+            const GLState::Stats &glStats = glState.getStats();
+            std::cout << "GL state: " << glStats.totalForwarded() << " calls forwarded | " << glStats.totalFiltered() << " redundant calls filtered" << std::endl;
+        }
 
         // -----------------
 
-        timer.printTimeData();
+        if(!showOverlay) timer.printTimeData();         // the overlay shows it without a line per frame
 
+        if(regression) regression->endFrame(fbWidth, fbHeight);
+        if(flyThrough) flyThrough->endFrame();
+        if(frameCapture) frameCapture->capture(fbWidth, fbHeight);
+
+        perfOverlay->endScope();
+        perfOverlay->endFrame(gpuTimer);
+
+        deletionQueue.endFrame();
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
     // Render loop End
 
+    int exitCode = regression ? regression->finish() : 0;
+    if(flyThrough) flyThrough->report();
+
+    if(inputPlayer)
+    {
+        double wallTime = timer.getTimeNow();
+        std::cout << "Replay: " << inputPlayer->getFrames() << " frames (" << inputPlayer->getTime() << " s recorded) in " << wallTime <<
+                     " s | " << wallTime * 1000 / std::max(inputPlayer->getFrames(), 1u) << " ms/frame" << std::endl;
+    }
+    delete inputPlayer;
+    delete inputRecorder;
+    delete regression;
+    delete flyThrough;
+    delete frameCapture;                        // writes the frames still in flight
 
     // ----- De-allocate all resources
-    glDeleteVertexArrays(1, &cubeVAO);
-    glDeleteVertexArrays(1, &lightSourceVAO);
-    glDeleteBuffers(1, &VBO);
-    //glDeleteBuffers(1, &EBO);
-    glDeleteProgram(lightingProgram.ID);
-    glDeleteProgram(lightSourceProgram.ID);
+    // The modules release their GL objects to deletionQueue, which deletes everything still queued before the context goes.
+    // The handles and Shaders of this function are destroyed after glfwTerminate(): the context has freed them by then.
+    delete fragmentCounter;
+    delete shadowMaps;
+    delete gpuScene;
+    delete hiZ;
+    delete perfOverlay;
+    deletionQueue.shutdown();
 
     glfwTerminate();
 
-    return 0;
+    return exitCode;
 }
 
 // -----------------------------------------------------------------------------------
 
+// Lit cubes (the first one is replaced by the loaded model if modelFit is given) and, optionally, a floor to receive shadows
+void buildScene(std::pmr::vector<SceneObject> &scene, float time, const glm::mat4 *modelFit, bool withFloor,
+                const Material *cubeMaterial, const Material *floorMaterial, const glm::dvec3 &site, const glm::dvec3 &origin)
+{
+    // Each object's offset from the render origin is computed in double, then converted to float
+    auto renderPosition = [&](const glm::vec3 &local) { return glm::vec3(site + glm::dvec3(local) - origin); };
+
+    scene.clear();
+    for(unsigned i = 0; i < 10; i++)
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, renderPosition(cubePositions1[i]));
+        model = glm::rotate(model, time * glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
+        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
+
+        bool isModel = i == 0 && modelFit;
+        scene.push_back(SceneObject{ isModel ? model * *modelFit : model, isModel, 0.87f, cubeMaterial });
+    }
+    if(withFloor)
+        scene.push_back(SceneObject{ glm::scale(glm::translate(glm::mat4(1.0f), renderPosition(glm::vec3(0.0f, -5.0f, -8.0f))), glm::vec3(30.0f, 0.5f, 40.0f)),
+                                     false, 25.0f, floorMaterial });
+}
+
+// --soft: render the scene (Phong light and light source, as the forward path) with SoftRasterizer, one frame every 1/30 s.
+// The last frame is saved as PPM.
+int renderSoftware(const std::string &path, const MeshData &mesh, const glm::mat4 &modelFit, unsigned frames)
+{
+    SoftRasterizer rasterizer(SCR_WIDTH, SCR_HEIGHT);
+    rasterizer.setCamera(cam.GetViewMatrix(), glm::perspective(glm::radians(cam.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f));
+
+    Material cubeMaterial;
+    cubeMaterial.color = glm::vec3(1.0f, 0.5f, 0.31f);
+
+    PhongShading lighting;
+    lighting.objectColor = cubeMaterial.color;
+    lighting.lightPos    = lightPos;
+    lighting.camPos      = glm::vec3(cam.Position);
+    auto lightSource = [](const SoftFragment &) { return glm::vec3(1.0f); };       // lightSourceFragS.fs
+
+    VertexInput cubeInput{ cubeVertices, 36, 6, 0, 3, -1 };
+    VertexInput modelInput{ mesh.vertices.data(), mesh.numVertices(), MeshData::stride, 0, 3, -1 };
+    std::pmr::vector<SceneObject> scene;
+
+    double setupTime = 0, rasterTime = 0;
+    size_t triangles = 0, pixels = 0;
+    for(unsigned frame = 0; frame < frames; ++frame)
+    {
+        buildScene(scene, frame / 30.0f, mesh.vertices.empty() ? nullptr : &modelFit, false, &cubeMaterial, nullptr);
+
+        rasterizer.clear(glm::vec3(0.2f, 0.3f, 0.3f));
+        for(const SceneObject &object : scene)
+            if(object.isModel) rasterizer.draw(modelInput, mesh.indices.data(), mesh.indices.size(), object.model, lighting);
+            else               rasterizer.draw(cubeInput, nullptr, 36, object.model, lighting);
+        rasterizer.draw(cubeInput, nullptr, 36, glm::scale(glm::translate(glm::mat4(1.0f), lightPos), glm::vec3(0.2f)), lightSource);
+        rasterizer.finish();
+
+        const SoftRasterizer::Stats &stats = rasterizer.getStats();
+        setupTime  += stats.setupTime;
+        rasterTime += stats.rasterTime;
+        triangles  += stats.triangles;
+        pixels     += stats.pixelsShaded;
+    }
+
+    std::cout << "Software rasterizer (" << SCR_WIDTH << "x" << SCR_HEIGHT << ", " << frames << " frames): setup " << setupTime / frames <<
+                 " ms | raster " << rasterTime / frames << " ms | " << triangles / (setupTime + rasterTime) / 1e3 << " Mtri/s | " <<
+                 pixels / rasterTime / 1e3 << " Mpix/s" << std::endl;
+
+    if(!rasterizer.savePPM(path))
+    {
+        std::cout << "ERROR::SOFTRASTERIZER::CANNOT_WRITE: " << path << std::endl;
+        return -1;
+    }
+    std::cout << "Saved " << path << std::endl;
+    return 0;
+}
+
 // GLFW: whenever the window size changed (by OS or user resize) this callback function executes
 void framebuffer_resize_callback(GLFWwindow* window, int width, int height)
 {
     //glfwGetFramebufferSize(window, &width, &height);  // Get viewport size from GLFW
-    glViewport(0, 0, width, height);                    // Tell OGL the viewport size
+    glState.viewport(0, 0, width, height);              // Tell OGL the viewport size
     // projection adjustments
 }
 
+// GLFW: key presses (one call per press, unlike processInput())
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    if(inputPlayer) return;
+    if(inputRecorder) inputRecorder->current().keyEvents.push_back(InputFrame::KeyEvent{ (int16_t)key, (uint8_t)action });
+    handleKey(key, action);
+}
+
+void handleKey(int key, int action)
+{
+    if(key == GLFW_KEY_G && action == GLFW_PRESS)
+    {
+        deferredShading = !deferredShading;
+        std::cout << (deferredShading ? "Deferred" : "Forward") << " shading" << std::endl;
+    }
+
+    if(key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        overdrawMode = (OverdrawView::Mode)((overdrawMode + 1) % 3);
+        std::cout << "Overdraw view: " << OverdrawView::modeName(overdrawMode) << std::endl;
+    }
+
+    if(key == GLFW_KEY_F1 && action == GLFW_PRESS)
+        showOverlay = !showOverlay;
+
+    if(key == GLFW_KEY_TAB && action == GLFW_PRESS)
+    {
+        overlayCursor = !overlayCursor;
+        glfwSetInputMode(glfwGetCurrentContext(), GLFW_CURSOR, overlayCursor ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+    }
+}
+
 // Process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 void processInput(GLFWwindow *window)
 {
@@ -448,15 +1375,36 @@ void processInput(GLFWwindow *window)
         glfwSetWindowShouldClose(window, true);
 
     // Get cameraPos from keys
-    float cameraSpeed = 2.5 * timer.getDeltaTime();
-    if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        cam.ProcessKeyboard(FORWARD, timer.getDeltaTime());
-    if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        cam.ProcessKeyboard(BACKWARD, timer.getDeltaTime());
-    if(glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        cam.ProcessKeyboard(LEFT, timer.getDeltaTime());
-    if(glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        cam.ProcessKeyboard(RIGHT, timer.getDeltaTime());
+    unsigned keys = 0;
+    if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) keys |= InputFrame::KEY_FORWARD;
+    if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) keys |= InputFrame::KEY_BACKWARD;
+    if(glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) keys |= InputFrame::KEY_LEFT;
+    if(glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) keys |= InputFrame::KEY_RIGHT;
+
+    float deltaTime = (float)timer.getDeltaTime();
+    if(inputRecorder) inputRecorder->endFrame(deltaTime, keys);
+    moveCamera(keys, deltaTime);
+}
+
+void moveCamera(unsigned keys, float deltaTime)
+{
+    if(keys & InputFrame::KEY_FORWARD)  cam.ProcessKeyboard(FORWARD, deltaTime);
+    if(keys & InputFrame::KEY_BACKWARD) cam.ProcessKeyboard(BACKWARD, deltaTime);
+    if(keys & InputFrame::KEY_LEFT)     cam.ProcessKeyboard(LEFT, deltaTime);
+    if(keys & InputFrame::KEY_RIGHT)    cam.ProcessKeyboard(RIGHT, deltaTime);
+}
+
+// --replay: the events of the next frame, in the order they were received, then the movement keys
+bool replayInput()
+{
+    InputFrame frame;
+    if(!inputPlayer->next(frame)) return false;
+
+    for(const glm::vec2 &move : frame.mouseMoves) cam.ProcessMouseMovement(move.x, move.y, 0);
+    for(float scroll : frame.scrolls) cam.ProcessMouseScroll(scroll);
+    for(const InputFrame::KeyEvent &event : frame.keyEvents) handleKey(event.key, event.action);
+    moveCamera(frame.keys, frame.deltaTime);
+    return true;
 }
 
 // Get cameraFront from the mouse
@@ -474,11 +1422,15 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos)
     lastX = xpos;
     lastY = ypos;
 
+    if(inputPlayer || overlayCursor) return;
+    if(inputRecorder) inputRecorder->current().mouseMoves.push_back(glm::vec2(xoffset, yoffset));
     cam.ProcessMouseMovement(xoffset, yoffset, 0);
 }
 
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 {
+    if(inputPlayer) return;
+    if(inputRecorder) inputRecorder->current().scrolls.push_back((float)yoffset);
     cam.ProcessMouseScroll(yoffset);
 }
 
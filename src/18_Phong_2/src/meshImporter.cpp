@@ -0,0 +1,785 @@
+#include "meshImporter.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+// ----- Helpers ---------------
+
+namespace
+{
+
+// Run func(task) for task in [0, numTasks) on up to numThreads threads
+template<typename F>
+void parallelFor(size_t numTasks, unsigned numThreads, F func)
+{
+    if(numThreads <= 1 || numTasks <= 1)
+    {
+        for(size_t i = 0; i < numTasks; ++i) func(i);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    unsigned count = (unsigned)std::min<size_t>(numThreads, numTasks);
+    for(unsigned t = 0; t < count; ++t)
+        workers.emplace_back([=, &func]() { for(size_t i = t; i < numTasks; i += count) func(i); });
+
+    for(std::thread &w : workers) w.join();
+}
+
+bool readFile(const std::string &path, std::vector<char> &buffer)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file.is_open()) return false;
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    buffer.resize((size_t)size);
+
+    return (bool)file.read(buffer.data(), size);
+}
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char *skipSpaces(const char *p, const char *end)
+{
+    while(p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+inline const char *skipLine(const char *p, const char *end)
+{
+    while(p < end && *p != '\n') ++p;
+    return p < end ? p + 1 : end;
+}
+
+inline const char *parseFloat(const char *p, const char *end, float &value)
+{
+    p = skipSpaces(p, end);
+    if(p < end && *p == '+') ++p;           // from_chars doesn't accept a leading '+'
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    std::from_chars_result res = std::from_chars(p, end, value);
+    if(res.ec != std::errc()) { value = 0.f; return p; }
+    return res.ptr;
+#else
+    // Slower fallback for standard libraries without floating point from_chars. The file isn't null-terminated: strtof
+    // reads a bounded copy of the token.
+    char token[64];
+    size_t length = 0;
+    while(p + length < end && length < sizeof(token) - 1 && !isSpace(p[length]) && p[length] != '\n')
+    {
+        token[length] = p[length];
+        ++length;
+    }
+    token[length] = '\0';
+
+    char *next;
+    value = std::strtof(token, &next);
+    return p + (next - token);
+#endif
+}
+
+inline const char *parseInt(const char *p, const char *end, int &value)
+{
+    if(p < end && *p == '+') ++p;
+    std::from_chars_result res = std::from_chars(p, end, value);
+    if(res.ec != std::errc()) value = 0;
+    return res.ptr;
+}
+
+// Split [0, size) in approximately equal chunks whose boundaries fall right after a '\n'
+std::vector<size_t> splitInLines(const std::vector<char> &file, size_t numChunks)
+{
+    std::vector<size_t> bounds(1, 0);
+    size_t chunkSize = file.size() / numChunks + 1;
+
+    for(size_t i = 1; i < numChunks; ++i)
+    {
+        size_t pos = std::max(bounds.back(), std::min(i * chunkSize, file.size()));
+        while(pos < file.size() && file[pos - 1] != '\n') ++pos;
+        if(pos > bounds.back() && pos < file.size()) bounds.push_back(pos);
+    }
+
+    bounds.push_back(file.size());
+    return bounds;
+}
+
+// ----- OBJ ---------------
+
+// Face corner as read in a chunk. Relative (negative) indices can only be resolved once the number of vertices in
+// previous chunks is known, so they are stored relative to the chunk start.
+struct ObjCorner
+{
+    int32_t v, n;               // n == -1 and !relN: no normal
+    uint8_t relV, relN;
+};
+
+struct ObjChunk
+{
+    std::vector<float>     positions;
+    std::vector<float>     normals;
+    std::vector<ObjCorner> corners;     // triangulated (3 per triangle)
+    bool                   missingNormals = false;
+};
+
+void parseObjChunk(const char *p, const char *end, ObjChunk &chunk)
+{
+    std::vector<ObjCorner> face;
+
+    while(p < end)
+    {
+        p = skipSpaces(p, end);
+        if(p >= end) break;
+
+        if(p[0] == 'v' && p + 1 < end && isSpace(p[1]))             // v x y z
+        {
+            float x, y, z;
+            p = parseFloat(p + 1, end, x);
+            p = parseFloat(p, end, y);
+            p = parseFloat(p, end, z);
+            chunk.positions.insert(chunk.positions.end(), { x, y, z });
+        }
+        else if(p[0] == 'v' && p + 2 < end && p[1] == 'n' && isSpace(p[2]))    // vn x y z
+        {
+            float x, y, z;
+            p = parseFloat(p + 2, end, x);
+            p = parseFloat(p, end, y);
+            p = parseFloat(p, end, z);
+            chunk.normals.insert(chunk.normals.end(), { x, y, z });
+        }
+        else if(p[0] == 'f' && p + 1 < end && isSpace(p[1]))        // f v/vt/vn v//vn v ...
+        {
+            face.clear();
+            p = skipSpaces(p + 1, end);
+
+            while(p < end && *p != '\n' && *p != '#')
+            {
+                int v = 0, t = 0, n = 0;
+                p = parseInt(p, end, v);
+                if(p < end && *p == '/')
+                {
+                    ++p;
+                    if(p < end && *p != '/') p = parseInt(p, end, t);
+                    if(p < end && *p == '/') p = parseInt(p + 1, end, n);
+                }
+                if(v == 0) break;                                    // malformed
+
+                ObjCorner c;
+                c.relV = v < 0;
+                c.v    = v < 0 ? (int32_t)(chunk.positions.size() / 3) + v : v - 1;
+                c.relN = n < 0;
+                c.n    = n < 0 ? (int32_t)(chunk.normals.size() / 3) + n : n - 1;
+                face.push_back(c);
+
+                p = skipSpaces(p, end);
+            }
+
+            for(size_t i = 2; i < face.size(); ++i)                 // triangle fan
+            {
+                chunk.corners.push_back(face[0]);
+                chunk.corners.push_back(face[i - 1]);
+                chunk.corners.push_back(face[i]);
+            }
+            for(const ObjCorner &c : face)
+                if(c.n == -1 && !c.relN) chunk.missingNormals = true;
+        }
+
+        p = skipLine(p, end);
+    }
+}
+
+// ----- PLY ---------------
+
+enum PlyType { PLY_NONE, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType     type      = PLY_NONE;
+    PlyType     countType = PLY_NONE;   // != PLY_NONE for list properties
+};
+
+struct PlyElement
+{
+    std::string              name;
+    size_t                   count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+PlyType plyType(const std::string &name)
+{
+    if(name == "char"   || name == "int8")    return PLY_INT8;
+    if(name == "uchar"  || name == "uint8")   return PLY_UINT8;
+    if(name == "short"  || name == "int16")   return PLY_INT16;
+    if(name == "ushort" || name == "uint16")  return PLY_UINT16;
+    if(name == "int"    || name == "int32")   return PLY_INT32;
+    if(name == "uint"   || name == "uint32")  return PLY_UINT32;
+    if(name == "float"  || name == "float32") return PLY_FLOAT32;
+    if(name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_NONE;
+}
+
+size_t plySize(PlyType type)
+{
+    static const size_t sizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+    return sizes[type];
+}
+
+template<typename T>
+inline T readRaw(const char *p, bool swap)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if(swap) std::reverse(bytes, bytes + sizeof(T));
+
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+inline double readPly(const char *p, PlyType type, bool swap)
+{
+    switch(type)
+    {
+    case PLY_INT8:    return (double)*(const int8_t *)p;
+    case PLY_UINT8:   return (double)*(const uint8_t *)p;
+    case PLY_INT16:   return (double)readRaw<int16_t>(p, swap);
+    case PLY_UINT16:  return (double)readRaw<uint16_t>(p, swap);
+    case PLY_INT32:   return (double)readRaw<int32_t>(p, swap);
+    case PLY_UINT32:  return (double)readRaw<uint32_t>(p, swap);
+    case PLY_FLOAT32: return (double)readRaw<float>(p, swap);
+    case PLY_FLOAT64: return readRaw<double>(p, swap);
+    default:          return 0.;
+    }
+}
+
+// Reads the count of a list property at p, and checks that its items fit before end. p is left on the first item.
+bool readPlyCount(const char *&p, const char *end, const PlyProperty &prop, bool swap, size_t &count)
+{
+    size_t countSize = plySize(prop.countType);
+    if((size_t)(end - p) < countSize) return false;
+
+    double value = readPly(p, prop.countType, swap);
+    p += countSize;
+    if(value < 0 || value > (double)((size_t)(end - p) / plySize(prop.type))) return false;
+    count = (size_t)value;
+    return true;
+}
+
+bool hostIsLittleEndian()
+{
+    uint16_t x = 1;
+    return *(uint8_t *)&x == 1;
+}
+
+} // anonymous namespace end
+
+// ----- MeshData ---------------
+
+void MeshData::clear()
+{
+    vertices.clear();
+    indices.clear();
+    minBound = glm::vec3( 1e30f);
+    maxBound = glm::vec3(-1e30f);
+}
+
+void makeSphere(MeshData &mesh, unsigned rings, unsigned sectors)
+{
+    mesh.clear();
+    const float pi = 3.14159265359f;
+
+    for(unsigned r = 0; r <= rings; ++r)
+        for(unsigned s = 0; s <= sectors; ++s)
+        {
+            float theta = pi * r / rings, phi = 2 * pi * s / sectors;
+            glm::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            mesh.vertices.insert(mesh.vertices.end(), { 0.5f * n.x, 0.5f * n.y, 0.5f * n.z, n.x, n.y, n.z });
+        }
+
+    for(unsigned r = 0; r < rings; ++r)
+        for(unsigned s = 0; s < sectors; ++s)
+        {
+            unsigned a = r * (sectors + 1) + s, b = a + sectors + 1;
+            mesh.indices.insert(mesh.indices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+        }
+
+    mesh.minBound = glm::vec3(-0.5f);
+    mesh.maxBound = glm::vec3( 0.5f);
+}
+
+void makeBox(MeshData &mesh)
+{
+    mesh.clear();
+
+    for(int axis = 0; axis < 3; ++axis)
+        for(float sign : { -1.0f, 1.0f })
+        {
+            glm::vec3 n(0.0f), u(0.0f), v(0.0f);
+            n[axis] = sign;
+            u[(axis + 1) % 3] = 1.0f;
+            v[(axis + 2) % 3] = sign;           // u x v = n: counter-clockwise seen from outside
+
+            unsigned first = (unsigned)mesh.numVertices();
+            for(int corner = 0; corner < 4; ++corner)
+            {
+                glm::vec3 p = 0.5f * (n + (corner & 1 ? u : -u) + (corner & 2 ? v : -v));
+                mesh.vertices.insert(mesh.vertices.end(), { p.x, p.y, p.z, n.x, n.y, n.z });
+            }
+            mesh.indices.insert(mesh.indices.end(), { first, first + 1, first + 3, first, first + 3, first + 2 });
+        }
+
+    mesh.minBound = glm::vec3(-0.5f);
+    mesh.maxBound = glm::vec3( 0.5f);
+}
+
+// ----- MeshImporter ---------------
+
+MeshImporter::MeshImporter(unsigned threads) : numThreads(threads), lastLoadTime(0)
+{
+    if(numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool MeshImporter::load(const std::string &path, MeshData &mesh)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    mesh.clear();
+
+    std::vector<char> file;
+    if(!readFile(path, file))
+    {
+        std::cout << "ERROR::MESH::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    bool ok;
+    if(extension == "obj")      ok = loadOBJ(file, mesh);
+    else if(extension == "ply") ok = loadPLY(file, mesh);
+    else
+    {
+        std::cout << "ERROR::MESH::UNKNOWN_FORMAT: " << path << std::endl;
+        ok = false;
+    }
+
+    if(ok) computeBounds(mesh);
+    else mesh.clear();
+
+    lastLoadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.;
+    return ok;
+}
+
+bool MeshImporter::loadOBJ(const std::vector<char> &file, MeshData &mesh)
+{
+    // Parse chunks in parallel
+    const size_t minChunkSize = 1 << 20;
+    size_t numChunks = std::max<size_t>(1, std::min<size_t>(numThreads * 4, file.size() / minChunkSize));
+    std::vector<size_t> bounds = splitInLines(file, numChunks);
+    numChunks = bounds.size() - 1;
+
+    std::vector<ObjChunk> chunks(numChunks);
+    parallelFor(numChunks, numThreads, [&](size_t i)
+    {
+        parseObjChunk(file.data() + bounds[i], file.data() + bounds[i + 1], chunks[i]);
+    });
+
+    // Offsets of each chunk in the merged arrays
+    std::vector<size_t> posBase(numChunks + 1, 0), nrmBase(numChunks + 1, 0), idxBase(numChunks + 1, 0);
+    bool useFileNormals = true;
+    for(size_t i = 0; i < numChunks; ++i)
+    {
+        posBase[i + 1] = posBase[i] + chunks[i].positions.size() / 3;
+        nrmBase[i + 1] = nrmBase[i] + chunks[i].normals.size()   / 3;
+        idxBase[i + 1] = idxBase[i] + chunks[i].corners.size();
+        if(chunks[i].missingNormals) useFileNormals = false;
+    }
+
+    size_t numPositions = posBase[numChunks], numNormals = nrmBase[numChunks], numIndices = idxBase[numChunks];
+    if(numPositions == 0 || numIndices == 0)
+    {
+        std::cout << "ERROR::MESH::OBJ_WITHOUT_FACES" << std::endl;
+        return false;
+    }
+    if(numNormals == 0) useFileNormals = false;
+
+    // Resolve indices to global ones
+    std::vector<uint32_t> vIdx(numIndices), nIdx(useFileNormals ? numIndices : 0);
+    std::vector<char> invalid(numChunks, 0);
+    bool sameIndices = useFileNormals;      // v == vn for every corner: no vertex deduplication needed
+    std::vector<char> sameInChunk(numChunks, 1);
+
+    parallelFor(numChunks, numThreads, [&](size_t i)
+    {
+        const ObjChunk &chunk = chunks[i];
+        for(size_t j = 0; j < chunk.corners.size(); ++j)
+        {
+            const ObjCorner &c = chunk.corners[j];
+            int64_t v = c.relV ? (int64_t)posBase[i] + c.v : c.v;
+            if(v < 0 || v >= (int64_t)numPositions) { invalid[i] = 1; v = 0; }
+            vIdx[idxBase[i] + j] = (uint32_t)v;
+
+            if(useFileNormals)
+            {
+                int64_t n = c.relN ? (int64_t)nrmBase[i] + c.n : c.n;
+                if(n < 0 || n >= (int64_t)numNormals) { invalid[i] = 1; n = 0; }
+                nIdx[idxBase[i] + j] = (uint32_t)n;
+                if(n != v) sameInChunk[i] = 0;
+            }
+        }
+    });
+
+    for(size_t i = 0; i < numChunks; ++i)
+    {
+        if(invalid[i])
+        {
+            std::cout << "ERROR::MESH::OBJ_INDEX_OUT_OF_RANGE" << std::endl;
+            return false;
+        }
+        if(!sameInChunk[i]) sameIndices = false;
+    }
+
+    // Build the interleaved vertex buffer
+    if(!useFileNormals || sameIndices)
+    {
+        // One vertex per position
+        mesh.vertices.assign(numPositions * MeshData::stride, 0.f);
+        parallelFor(numChunks, numThreads, [&](size_t i)
+        {
+            const ObjChunk &chunk = chunks[i];
+            size_t count = chunk.positions.size() / 3;
+            for(size_t j = 0; j < count; ++j)
+            {
+                float *dst = &mesh.vertices[(posBase[i] + j) * MeshData::stride];
+                dst[0] = chunk.positions[j * 3 + 0];
+                dst[1] = chunk.positions[j * 3 + 1];
+                dst[2] = chunk.positions[j * 3 + 2];
+            }
+            if(sameIndices)
+                for(size_t j = 0; j < chunk.normals.size() / 3; ++j)
+                {
+                    if(nrmBase[i] + j >= numPositions) break;
+                    float *dst = &mesh.vertices[(nrmBase[i] + j) * MeshData::stride + 3];
+                    dst[0] = chunk.normals[j * 3 + 0];
+                    dst[1] = chunk.normals[j * 3 + 1];
+                    dst[2] = chunk.normals[j * 3 + 2];
+                }
+        });
+
+        mesh.indices = std::move(vIdx);
+        if(!useFileNormals) generateNormals(mesh);
+    }
+    else
+    {
+        // Deduplicate (position, normal) pairs
+        std::vector<float> positions, normals;
+        positions.reserve(numPositions * 3);
+        normals.reserve(numNormals * 3);
+        for(const ObjChunk &chunk : chunks)
+        {
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        }
+        chunks.clear();
+
+        std::unordered_map<uint64_t, uint32_t> pairs;
+        pairs.reserve(numPositions);
+        mesh.indices.resize(numIndices);
+        mesh.vertices.reserve(numPositions * MeshData::stride);
+
+        for(size_t j = 0; j < numIndices; ++j)
+        {
+            uint64_t key = ((uint64_t)vIdx[j] << 32) | nIdx[j];
+            auto it = pairs.find(key);
+            if(it == pairs.end())
+            {
+                uint32_t index = (uint32_t)(mesh.vertices.size() / MeshData::stride);
+                const float *p = &positions[vIdx[j] * 3];
+                const float *n = &normals[nIdx[j] * 3];
+                mesh.vertices.insert(mesh.vertices.end(), { p[0], p[1], p[2], n[0], n[1], n[2] });
+                it = pairs.emplace(key, index).first;
+            }
+            mesh.indices[j] = it->second;
+        }
+    }
+
+    return true;
+}
+
+bool MeshImporter::loadPLY(const std::vector<char> &file, MeshData &mesh)
+{
+    // Header
+    const char *p = file.data(), *end = file.data() + file.size();
+    const char *headerEnd = std::search(p, end, "end_header", "end_header" + 10);
+    if(file.size() < 3 || std::strncmp(p, "ply", 3) != 0 || headerEnd == end)
+    {
+        std::cout << "ERROR::MESH::PLY_BAD_HEADER" << std::endl;
+        return false;
+    }
+
+    std::istringstream header(std::string(p, headerEnd));
+    std::vector<PlyElement> elements;
+    std::string line, word, format;
+
+    while(std::getline(header, line))
+    {
+        std::istringstream ls(line);
+        ls >> word;
+        if(word == "format") ls >> format;
+        else if(word == "element")
+        {
+            elements.emplace_back();
+            ls >> elements.back().name >> elements.back().count;
+        }
+        else if(word == "property" && !elements.empty())
+        {
+            PlyProperty prop;
+            std::string type;
+            ls >> type;
+            if(type == "list")
+            {
+                std::string countType, itemType;
+                ls >> countType >> itemType;
+                prop.countType = plyType(countType);
+                prop.type = plyType(itemType);
+            }
+            else prop.type = plyType(type);
+            ls >> prop.name;
+
+            if(prop.type == PLY_NONE || (type == "list" && prop.countType == PLY_NONE))
+            {
+                std::cout << "ERROR::MESH::PLY_UNKNOWN_TYPE: " << line << std::endl;
+                return false;
+            }
+            elements.back().properties.push_back(prop);
+        }
+    }
+
+    if(format != "binary_little_endian" && format != "binary_big_endian")
+    {
+        std::cout << "ERROR::MESH::PLY_FORMAT_NOT_SUPPORTED (only binary PLY): " << format << std::endl;
+        return false;
+    }
+    bool swap = (format == "binary_little_endian") != hostIsLittleEndian();
+
+    // Body
+    p = skipLine(headerEnd, end);
+    std::vector<float> normals;
+    bool hasNormals = false;
+
+    size_t numVertices = 0;                 // for the face indices, which may come first
+    for(const PlyElement &element : elements)
+        if(element.name == "vertex") numVertices = element.count;
+
+    for(const PlyElement &element : elements)
+    {
+        bool fixedSize = true;
+        size_t stride = 0;
+        for(const PlyProperty &prop : element.properties)
+        {
+            if(prop.countType != PLY_NONE) fixedSize = false;
+            stride += plySize(prop.type);
+        }
+
+        if(element.name == "vertex")
+        {
+            if(!fixedSize || stride == 0 || element.count > (size_t)(end - p) / stride)
+            {
+                std::cout << "ERROR::MESH::PLY_BAD_VERTEX_ELEMENT" << std::endl;
+                return false;
+            }
+
+            // Property offsets within a vertex
+            int offsets[6] = { -1, -1, -1, -1, -1, -1 };
+            PlyType types[6] = { PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE };
+            const char *names[6] = { "x", "y", "z", "nx", "ny", "nz" };
+            size_t offset = 0;
+            for(const PlyProperty &prop : element.properties)
+            {
+                for(int k = 0; k < 6; ++k)
+                    if(prop.name == names[k]) { offsets[k] = (int)offset; types[k] = prop.type; }
+                offset += plySize(prop.type);
+            }
+            if(offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0)
+            {
+                std::cout << "ERROR::MESH::PLY_WITHOUT_POSITIONS" << std::endl;
+                return false;
+            }
+            hasNormals = offsets[3] >= 0 && offsets[4] >= 0 && offsets[5] >= 0;
+
+            // Fixed stride: decode in parallel
+            mesh.vertices.assign(element.count * MeshData::stride, 0.f);
+            const size_t verticesPerTask = 1 << 16;
+            size_t numTasks = (element.count + verticesPerTask - 1) / verticesPerTask;
+            const char *data = p;
+            int numAttribs = hasNormals ? 6 : 3;
+
+            parallelFor(numTasks, numThreads, [&](size_t task)
+            {
+                size_t first = task * verticesPerTask, last = std::min(element.count, first + verticesPerTask);
+                for(size_t i = first; i < last; ++i)
+                {
+                    const char *src = data + i * stride;
+                    float *dst = &mesh.vertices[i * MeshData::stride];
+                    for(int k = 0; k < numAttribs; ++k)
+                        dst[k] = (float)readPly(src + offsets[k], types[k], swap);
+                }
+            });
+
+            p += stride * element.count;
+        }
+        else if(element.name == "face")
+        {
+            // Smallest face (empty lists): the header's count must fit in the rest of the file
+            size_t minFaceSize = 0;
+            for(const PlyProperty &prop : element.properties)
+                minFaceSize += prop.countType == PLY_NONE ? plySize(prop.type) : plySize(prop.countType);
+            if(element.count && (minFaceSize == 0 || element.count > (size_t)(end - p) / minFaceSize))
+            {
+                std::cout << "ERROR::MESH::PLY_BAD_FACE_ELEMENT" << std::endl;
+                return false;
+            }
+
+            // Variable size lists: sequential scan
+            mesh.indices.reserve(element.count * 3);
+            for(size_t i = 0; i < element.count; ++i)
+                for(const PlyProperty &prop : element.properties)
+                {
+                    if(prop.countType == PLY_NONE)
+                    {
+                        if((size_t)(end - p) < plySize(prop.type)) { std::cout << "ERROR::MESH::PLY_TRUNCATED" << std::endl; return false; }
+                        p += plySize(prop.type);
+                        continue;
+                    }
+
+                    size_t count;
+                    if(!readPlyCount(p, end, prop, swap, count)) { std::cout << "ERROR::MESH::PLY_TRUNCATED" << std::endl; return false; }
+                    size_t itemSize = plySize(prop.type);
+
+                    if(prop.name == "vertex_indices" || prop.name == "vertex_index")
+                    {
+                        uint32_t first = 0, previous = 0;
+                        for(size_t k = 0; k < count; ++k)
+                        {
+                            double value = readPly(p + k * itemSize, prop.type, swap);
+                            if(value < 0 || value >= (double)numVertices)
+                            {
+                                std::cout << "ERROR::MESH::PLY_INDEX_OUT_OF_RANGE" << std::endl;
+                                return false;
+                            }
+
+                            uint32_t index = (uint32_t)value;
+                            if(k == 0) first = index;
+                            else if(k >= 2)                     // triangle fan
+                            {
+                                mesh.indices.push_back(first);
+                                mesh.indices.push_back(previous);
+                                mesh.indices.push_back(index);
+                            }
+                            previous = index;
+                        }
+                    }
+                    p += count * itemSize;
+                }
+        }
+        else
+        {
+            // Skip unknown elements, checking every size against the end of the file
+            bool truncated = false;
+            if(fixedSize)
+            {
+                truncated = stride && element.count > (size_t)(end - p) / stride;
+                if(!truncated) p += stride * element.count;
+            }
+            else
+                for(size_t i = 0; i < element.count && !truncated; ++i)
+                    for(const PlyProperty &prop : element.properties)
+                    {
+                        size_t count = 1;
+                        if(prop.countType == PLY_NONE) truncated = (size_t)(end - p) < plySize(prop.type);
+                        else truncated = !readPlyCount(p, end, prop, swap, count);
+                        if(truncated) break;
+                        p += count * plySize(prop.type);
+                    }
+
+            if(truncated)
+            {
+                std::cout << "ERROR::MESH::PLY_TRUNCATED" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if(mesh.numVertices() == 0 || mesh.indices.empty())
+    {
+        std::cout << "ERROR::MESH::PLY_WITHOUT_FACES" << std::endl;
+        return false;
+    }
+
+    if(!hasNormals) generateNormals(mesh);
+    return true;
+}
+
+void MeshImporter::generateNormals(MeshData &mesh)
+{
+    const unsigned s = MeshData::stride;
+    float *v = mesh.vertices.data();
+    size_t numVertices = mesh.numVertices();
+
+    // Accumulate area weighted face normals (the cross product length is twice the triangle area)
+    for(size_t i = 0; i < numVertices; ++i)
+        v[i * s + 3] = v[i * s + 4] = v[i * s + 5] = 0.f;
+
+    for(size_t t = 0; t < mesh.indices.size(); t += 3)
+    {
+        unsigned i0 = mesh.indices[t], i1 = mesh.indices[t + 1], i2 = mesh.indices[t + 2];
+        glm::vec3 a(v[i0 * s], v[i0 * s + 1], v[i0 * s + 2]);
+        glm::vec3 b(v[i1 * s], v[i1 * s + 1], v[i1 * s + 2]);
+        glm::vec3 c(v[i2 * s], v[i2 * s + 1], v[i2 * s + 2]);
+        glm::vec3 n = glm::cross(b - a, c - a);
+
+        for(unsigned i : { i0, i1, i2 })
+        {
+            v[i * s + 3] += n.x;
+            v[i * s + 4] += n.y;
+            v[i * s + 5] += n.z;
+        }
+    }
+
+    // Normalize
+    const size_t verticesPerTask = 1 << 16;
+    parallelFor((numVertices + verticesPerTask - 1) / verticesPerTask, numThreads, [&](size_t task)
+    {
+        size_t last = std::min(numVertices, (task + 1) * verticesPerTask);
+        for(size_t i = task * verticesPerTask; i < last; ++i)
+        {
+            glm::vec3 n(v[i * s + 3], v[i * s + 4], v[i * s + 5]);
+            float length = glm::length(n);
+            n = length > 0.f ? n / length : glm::vec3(0.f, 1.f, 0.f);
+            v[i * s + 3] = n.x;
+            v[i * s + 4] = n.y;
+            v[i * s + 5] = n.z;
+        }
+    });
+}
+
+void MeshImporter::computeBounds(MeshData &mesh)
+{
+    for(size_t i = 0; i < mesh.vertices.size(); i += MeshData::stride)
+    {
+        glm::vec3 pos(mesh.vertices[i], mesh.vertices[i + 1], mesh.vertices[i + 2]);
+        mesh.minBound = glm::min(mesh.minBound, pos);
+        mesh.maxBound = glm::max(mesh.maxBound, pos);
+    }
+}
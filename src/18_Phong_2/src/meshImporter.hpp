@@ -0,0 +1,51 @@
+#ifndef MESHIMPORTER_HPP
+#define MESHIMPORTER_HPP
+
+#include "glm/glm.hpp"
+
+#include <string>
+#include <vector>
+
+// Mesh ready to be uploaded. Vertices are interleaved as in vertexShader.vs: position (location 0) + normal (location 3)
+struct MeshData
+{
+    std::vector<float>    vertices;     // x, y, z, nx, ny, nz
+    std::vector<unsigned> indices;      // triangle list
+
+    glm::vec3 minBound = glm::vec3( 1e30f);
+    glm::vec3 maxBound = glm::vec3(-1e30f);
+
+    static const unsigned stride = 6;   // floats per vertex
+
+    size_t numVertices()  const { return vertices.size() / stride; }
+    size_t numTriangles() const { return indices.size() / 3; }
+    void   clear();
+};
+
+// Procedural UV sphere of radius 0.5 (useful as a test mesh when no model is loaded)
+void makeSphere(MeshData &mesh, unsigned rings, unsigned sectors);
+
+// Cube of side 1 centered at the origin, with flat normals (24 vertices)
+void makeBox(MeshData &mesh);
+
+// Multithreaded importer for Wavefront OBJ and binary PLY files. The file is read at once, split into chunks that are
+// parsed on worker threads, and merged. Normals are generated (area weighted) if the file has none.
+class MeshImporter
+{
+    unsigned numThreads;
+
+    bool loadOBJ(const std::vector<char> &file, MeshData &mesh);
+    bool loadPLY(const std::vector<char> &file, MeshData &mesh);
+
+    void generateNormals(MeshData &mesh);
+    void computeBounds(MeshData &mesh);
+
+public:
+    MeshImporter(unsigned threads = 0);     // 0: use std::thread::hardware_concurrency()
+
+    bool load(const std::string &path, MeshData &mesh);        // Format is chosen by file extension (.obj, .ply)
+
+    double lastLoadTime;                    // seconds spent in the last call to load()
+};
+
+#endif
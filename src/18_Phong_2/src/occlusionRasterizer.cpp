@@ -0,0 +1,167 @@
+#include "occlusionRasterizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+
+const float MIN_W = 1e-4f;          // triangles with a vertex closer than this to the camera plane are not rasterized
+
+// Box triangles (corner i: x = i & 1, y = i & 2, z = i & 4)
+const int boxTriangles[12][3] = {
+    { 0, 1, 3 }, { 0, 3, 2 },       // -z
+    { 4, 6, 7 }, { 4, 7, 5 },       // +z
+    { 0, 4, 5 }, { 0, 5, 1 },       // -y
+    { 2, 3, 7 }, { 2, 7, 6 },       // +y
+    { 0, 2, 6 }, { 0, 6, 4 },       // -x
+    { 1, 5, 7 }, { 1, 7, 3 }        // +x
+};
+
+float edge(const glm::vec3 &a, const glm::vec3 &b, float x, float y)
+{
+    return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+} // anonymous namespace end
+
+OcclusionRasterizer::OcclusionRasterizer(int width, int height)
+    : width(std::max(width, 1)), height(std::max(height, 1)), viewProjection(1.0f), stats{ 0, 0, 0, 0, 0 }
+{
+    glm::ivec2 size(this->width, this->height);
+    levelSizes.push_back(size);
+    while(size.x > 1 || size.y > 1)
+    {
+        size = glm::max(size / 2, glm::ivec2(1));
+        levelSizes.push_back(size);
+    }
+
+    levels.resize(levelSizes.size());
+    for(size_t l = 0; l < levels.size(); ++l) levels[l].resize(levelSizes[l].x * levelSizes[l].y);
+}
+
+void OcclusionRasterizer::clear(const glm::mat4 &frameViewProjection)
+{
+    viewProjection = frameViewProjection;
+    std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+    stats = Stats{ 0, 0, 0, 0, 0 };
+}
+
+void OcclusionRasterizer::addOccluder(const glm::mat4 &model, const glm::vec3 &boxMin, const glm::vec3 &boxMax)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    glm::mat4 mvp = viewProjection * model;
+
+    // Corners in window coordinates (pixels, depth 0..1)
+    glm::vec3 corners[8];
+    bool behind[8];
+    for(int i = 0; i < 8; ++i)
+    {
+        glm::vec4 clip = mvp * glm::vec4(i & 1 ? boxMax.x : boxMin.x, i & 2 ? boxMax.y : boxMin.y, i & 4 ? boxMax.z : boxMin.z, 1.0f);
+        behind[i] = clip.w < MIN_W;
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        corners[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+    }
+
+    for(const int *t : boxTriangles)
+        if(!behind[t[0]] && !behind[t[1]] && !behind[t[2]])
+        {
+            rasterizeTriangle(corners[t[0]], corners[t[1]], corners[t[2]]);
+            ++stats.triangles;
+        }
+
+    ++stats.occluders;
+    stats.rasterTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+}
+
+void OcclusionRasterizer::rasterizeTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    float area = edge(a, b, c.x, c.y);
+    if(std::abs(area) < 1e-8f) return;
+
+    int minX = std::max((int)std::floor(std::min({ a.x, b.x, c.x })), 0);
+    int maxX = std::min((int)std::ceil (std::max({ a.x, b.x, c.x })), width - 1);
+    int minY = std::max((int)std::floor(std::min({ a.y, b.y, c.y })), 0);
+    int maxY = std::min((int)std::ceil (std::max({ a.y, b.y, c.y })), height - 1);
+
+    // Both windings are drawn (occluders are closed boxes, so drawing the back faces changes nothing)
+    for(int y = minY; y <= maxY; ++y)
+    {
+        float *row = &levels[0][y * width];
+        for(int x = minX; x <= maxX; ++x)
+        {
+            float px = x + 0.5f, py = y + 0.5f;
+            float w0 = edge(b, c, px, py) / area;
+            float w1 = edge(c, a, px, py) / area;
+            float w2 = 1.0f - w0 - w1;
+            if(w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+            float depth = w0 * a.z + w1 * b.z + w2 * c.z;       // window depth is affine in screen space
+            if(depth >= 0.0f && depth < row[x]) row[x] = depth;
+        }
+    }
+}
+
+void OcclusionRasterizer::build()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Each texel keeps the farthest depth of the texels it covers (as hiZBuild.cs)
+    for(size_t l = 1; l < levels.size(); ++l)
+    {
+        glm::ivec2 src = levelSizes[l - 1], dst = levelSizes[l];
+        for(int y = 0; y < dst.y; ++y)
+            for(int x = 0; x < dst.x; ++x)
+            {
+                int lastX = std::min(2 * x + 1 + (x == dst.x - 1 ? (src.x & 1) : 0), src.x - 1);
+                int lastY = std::min(2 * y + 1 + (y == dst.y - 1 ? (src.y & 1) : 0), src.y - 1);
+
+                float farthest = 0.0f;
+                for(int sy = 2 * y; sy <= lastY; ++sy)
+                    for(int sx = 2 * x; sx <= lastX; ++sx)
+                        farthest = std::max(farthest, levels[l - 1][sy * src.x + sx]);
+                levels[l][y * dst.x + x] = farthest;
+            }
+    }
+
+    stats.rasterTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+}
+
+bool OcclusionRasterizer::visible(const glm::vec3 &center, float radius)
+{
+    ++stats.tested;
+
+    glm::vec3 boxMin(1.0f), boxMax(0.0f);
+    for(int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner = center + radius * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+        if(clip.w <= 0.0f) return true;                 // crosses the camera plane
+        glm::vec3 window = glm::vec3(clip) / clip.w * 0.5f + 0.5f;
+        boxMin = glm::min(boxMin, window);
+        boxMax = glm::max(boxMax, window);
+    }
+
+    // Pixels covered, and the level where they are at most 2x2 texels
+    glm::ivec2 first(glm::clamp(glm::vec2(boxMin), 0.0f, 1.0f) * glm::vec2(width, height));
+    glm::ivec2 last = glm::min(glm::ivec2(glm::clamp(glm::vec2(boxMax), 0.0f, 1.0f) * glm::vec2(width, height)), glm::ivec2(width - 1, height - 1));
+    int size = std::max(last.x - first.x, last.y - first.y) + 1;
+    int level = std::min((int)std::ceil(std::log2((float)size)), (int)levels.size() - 1);
+
+    glm::ivec2 levelSize = levelSizes[level];
+    first = glm::min(first >> level, levelSize - 1);
+    last  = glm::min(last >> level, levelSize - 1);
+
+    float farthest = 0.0f;
+    for(int y = first.y; y <= last.y; ++y)
+        for(int x = first.x; x <= last.x; ++x)
+            farthest = std::max(farthest, levels[level][y * levelSize.x + x]);
+
+    if(boxMin.z > farthest)
+    {
+        ++stats.occluded;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef OCCLUSIONRASTERIZER_HPP
+#define OCCLUSIONRASTERIZER_HPP
+
+#include "glm/glm.hpp"
+
+#include <vector>
+
+// CPU occlusion culling (fallback for HiZBuffer when compute shaders aren't available). Occluders (solid boxes) are
+// rasterized into a small depth buffer, which is reduced into a max-depth pyramid. Objects are then tested like in
+// gpuCull.cs: the box of their bounding sphere is rejected if its nearest depth is behind the pyramid texels it covers.
+// Unlike the Hi-Z path it uses the current frame's occluders, so there is no latency.
+//      rasterizer.clear(projection * view);
+//      rasterizer.addOccluder(model);      // for each occluder
+//      rasterizer.build();
+//      rasterizer.visible(center, radius); // for each object
+class OcclusionRasterizer
+{
+public:
+    struct Stats
+    {
+        unsigned occluders, triangles;      // triangles rasterized (those crossing the near plane are skipped)
+        unsigned tested, occluded;
+        double   rasterTime;                // ms spent in addOccluder() + build()
+    };
+
+    OcclusionRasterizer(int width = 256, int height = 144);
+
+    void clear(const glm::mat4 &viewProjection);
+
+    // Rasterize the box [boxMin, boxMax] (object space). Only pass boxes that are completely filled by the object.
+    void addOccluder(const glm::mat4 &model, const glm::vec3 &boxMin = glm::vec3(-0.5f), const glm::vec3 &boxMax = glm::vec3(0.5f));
+
+    void build();
+
+    bool visible(const glm::vec3 &center, float radius);       // world space bounding sphere
+
+    const Stats &getStats() const { return stats; }
+    int getWidth()  const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    int       width, height;
+    glm::mat4 viewProjection;
+    std::vector<std::vector<float>> levels;     // level 0: depth buffer (window depth, 1 = far)
+    std::vector<glm::ivec2>         levelSizes;
+    Stats     stats;
+
+    void rasterizeTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+};
+
+#endif
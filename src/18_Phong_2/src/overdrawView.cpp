@@ -0,0 +1,130 @@
+#include "overdrawView.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+
+#include "imgui.h"
+
+#include <algorithm>
+
+namespace
+{
+
+const std::string shadersDir = "../../../src/18_Phong_2/shaders/";
+
+const unsigned COUNT_UNIT = 15;                 // after the G-buffer units (see DeferredRenderer)
+const float    MAX_COUNT  = 12.0f;              // white in the heatmap
+
+} // anonymous namespace end
+
+OverdrawView::OverdrawView()
+    : mode(OFF), width(0), height(0), emptyVAO(VertexArrayHandle::generate()), objectSamples(GL_SAMPLES_PASSED)
+{
+    heatmapProgram = new Shader((shadersDir + "fullscreenVS.vs").c_str(), (shadersDir + "overdrawHeatmapFragS.fs").c_str());
+
+    glState.useProgram(heatmapProgram->ID);
+    heatmapProgram->setInt("overdrawCount", COUNT_UNIT);
+    heatmapProgram->setFloat("maxCount", MAX_COUNT);
+}
+
+OverdrawView::~OverdrawView()
+{
+    delete heatmapProgram;
+}
+
+void OverdrawView::begin(Mode newMode, int newWidth, int newHeight)
+{
+    mode = newMode;
+    width = newWidth;
+    height = newHeight;
+    objects.clear();
+
+    glState.depthMask(true);
+    glState.clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glState.setCapability(GL_DEPTH_TEST, mode == SHADED);
+    glState.enable(GL_BLEND);
+    glState.blendFunc(GL_ONE, GL_ONE);
+}
+
+void OverdrawView::beginObject(const std::string &name)
+{
+    objects.push_back(name);
+    objectSamples.begin(name);
+}
+
+void OverdrawView::endObject()
+{
+    objectSamples.end();
+}
+
+void OverdrawView::end()
+{
+    glState.disable(GL_BLEND);
+    glState.enable(GL_DEPTH_TEST);
+}
+
+void OverdrawView::drawHeatmap(unsigned countTexture)
+{
+    glState.useProgram(heatmapProgram->ID);
+    glState.bindTexture(COUNT_UNIT, GL_TEXTURE_2D, countTexture);
+    glState.disable(GL_DEPTH_TEST);
+    glState.bindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glState.enable(GL_DEPTH_TEST);
+}
+
+void OverdrawView::endFrame()
+{
+    objectSamples.endFrame();
+    lastObjects.swap(objects);
+    objects.clear();
+}
+
+void OverdrawView::drawOverlay(double forwardTime) const
+{
+    // Sample counts are a few frames old (GpuTimer), but the objects don't change between frames
+    std::vector<std::pair<double, const std::string *>> rows;
+    double total = 0;
+    for(const std::string &name : lastObjects)
+    {
+        double samples = objectSamples.get(name);
+        rows.push_back({ samples, &name });
+        total += samples;
+    }
+    std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    double pixels = (double)width * height;
+
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Overdraw", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("%s fragments (O: next mode)", modeName(mode));
+    ImGui::Text("%.0f fragments | %.2f per pixel", total, pixels ? total / pixels : 0.0);
+    ImGui::Separator();
+
+    ImGui::Columns(4, "objects");
+    ImGui::Text("object");  ImGui::NextColumn();
+    ImGui::Text("pixels");  ImGui::NextColumn();
+    ImGui::Text("screen");  ImGui::NextColumn();
+    ImGui::Text("~ms");     ImGui::NextColumn();     // share of the forward pass, by fragments
+    ImGui::Separator();
+    for(const auto &row : rows)
+    {
+        ImGui::Text("%s", row.second->c_str());                                     ImGui::NextColumn();
+        ImGui::Text("%.0f", row.first);                                             ImGui::NextColumn();
+        ImGui::Text("%.1f%%", pixels ? 100.0 * row.first / pixels : 0.0);            ImGui::NextColumn();
+        ImGui::Text("%.3f", total ? forwardTime * row.first / total : 0.0);          ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::End();
+}
+
+const char *OverdrawView::modeName(Mode mode)
+{
+    switch(mode)
+    {
+    case SHADED: return "Shaded";
+    case ALL:    return "All rasterized";
+    default:     return "Off";
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef OVERDRAWVIEW_HPP
+#define OVERDRAWVIEW_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+
+#include "glHandle.hpp"
+#include "gpuTimer.hpp"
+
+#include <string>
+#include <vector>
+
+class Shader;
+
+// Overdraw debug view (O key, see main.cpp). The scene is drawn again, after the frame, with programs using
+// overdrawFragS.fs into a float target where each fragment adds 1 (additive blending); the count per pixel is then
+// shown over the frame as a heatmap. Each object is drawn inside its own GL_SAMPLES_PASSED query, so drawOverlay() can
+// list the pixels every object costs, and its share of the time of the lit scene pass ("forward lit", or "geometry").
+//      SHADED: depth test as in the forward pass (front to back): the fragments that get shaded
+//      ALL:    no depth test: every rasterized fragment (depth complexity)
+// The count and depth targets are transient textures of the render graph (see main.cpp). R16F counts exactly up to 2048
+// and, unlike 32 bit float targets, can always be blended; the depth has the G-buffer's format, so they can share a target.
+class OverdrawView
+{
+public:
+    enum Mode { OFF, SHADED, ALL };
+
+    static const GLenum COUNT_FORMAT = GL_R16F, DEPTH_FORMAT = GL_DEPTH24_STENCIL8;
+
+    OverdrawView();
+    ~OverdrawView();
+
+    OverdrawView(const OverdrawView &) = delete;
+    OverdrawView &operator=(const OverdrawView &) = delete;
+
+    void begin(Mode mode, int width, int height);  // Clear the bound count target, additive blending
+    void beginObject(const std::string &name);      // Draw one object (flushed) between beginObject() and endObject()
+    void endObject();
+    void end();
+    void drawHeatmap(unsigned countTexture);        // Into the bound framebuffer
+    void endFrame();
+
+    // ImGui window with the fragments of each object, most expensive first. forwardTime: ms of the pass that
+    // drew the scene objects (it must not include other draws, e.g. the light sources)
+    void drawOverlay(double forwardTime) const;
+
+    static const char *modeName(Mode mode);
+
+private:
+    Mode     mode;
+    int      width, height;
+    VertexArrayHandle emptyVAO;
+    Shader           *heatmapProgram;
+
+    GpuTimer objectSamples;                         // GL_SAMPLES_PASSED of each object
+    std::vector<std::string> objects;               // drawn this frame
+    std::vector<std::string> lastObjects;           // drawn last frame (listed by the overlay)
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "perfOverlay.hpp"
+#include "gpuTimer.hpp"
+#include "gpuMemory.hpp"
+
+#include "imgui.h"
+#include "examples/imgui_impl_glfw.h"
+#include "examples/imgui_impl_opengl3.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+
+const double AVERAGE_WEIGHT = 0.1;              // weight of the new frame in the moving averages of the scopes
+
+double gpuTime(const GpuTimer &gpuTimer, const std::string &name)
+{
+    const std::vector<std::string> &names = gpuTimer.getNames();
+    return std::find(names.begin(), names.end(), name) == names.end() ? -1 : gpuTimer.get(name);
+}
+
+} // anonymous namespace end
+
+PerfOverlay::PerfOverlay(GLFWwindow *window)
+    : open(-1), historyIndex(0)
+{
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::GetIO().IniFilename = nullptr;       // no imgui.ini next to the executable
+    ImGui_ImplGlfw_InitForOpenGL(window, false);        // no callbacks: main's own handle the input, ImGui polls the mouse
+    ImGui_ImplOpenGL3_Init("#version 330 core");
+}
+
+PerfOverlay::~PerfOverlay()
+{
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+}
+
+void PerfOverlay::beginScope(const std::string &name)
+{
+    auto it = std::find_if(scopes.begin(), scopes.end(), [&](const Scope &scope) { return scope.parent == open && scope.name == name; });
+    if(it == scopes.end())
+    {
+        scopes.push_back(Scope{ name, open });
+        it = scopes.end() - 1;
+    }
+
+    open = (int)(it - scopes.begin());
+    it->start = std::chrono::steady_clock::now();
+}
+
+void PerfOverlay::endScope()
+{
+    if(open < 0)
+    {
+        std::cout << "ERROR::PERFOVERLAY::END_WITHOUT_BEGIN" << std::endl;
+        return;
+    }
+
+    Scope &scope = scopes[open];
+    scope.time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scope.start).count();
+    open = scope.parent;
+}
+
+void PerfOverlay::endFrame(const GpuTimer &gpuTimer)
+{
+    double cpu = 0;
+    for(Scope &scope : scopes)
+    {
+        if(scope.parent < 0) cpu += scope.time;
+        scope.average += (scope.time - scope.average) * AVERAGE_WEIGHT;
+        scope.time = 0;                         // scopes not entered in a frame fade out
+    }
+
+    // GpuTimer scopes don't overlap: their sum is the GPU time of the frame
+    double gpu = 0;
+    for(const std::string &name : gpuTimer.getNames()) gpu += gpuTimer.get(name);
+
+    cpuHistory[historyIndex] = (float)cpu;
+    gpuHistory[historyIndex] = (float)gpu;
+    historyIndex = (historyIndex + 1) % PERF_HISTORY;
+}
+
+void PerfOverlay::setControls(std::function<void()> controls)
+{
+    drawControls = std::move(controls);
+}
+
+void PerfOverlay::newFrame(bool mouseInput)
+{
+    ImGuiIO &io = ImGui::GetIO();
+    if(mouseInput) io.ConfigFlags &= ~ImGuiConfigFlags_NoMouse;
+    else io.ConfigFlags |= ImGuiConfigFlags_NoMouse;
+
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+}
+
+void PerfOverlay::draw(const Counters &counters, const GpuTimer &gpuTimer)
+{
+    unsigned last = (historyIndex + PERF_HISTORY - 1) % PERF_HISTORY;
+    float maxTime = 1.0f;
+    for(unsigned i = 0; i < PERF_HISTORY; ++i) maxTime = std::max(maxTime, std::max(cpuHistory[i], gpuHistory[i]));
+
+    ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - 330, 10), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(320, 0), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Performance (F1: hide, Tab: cursor)");
+
+    // Frame times: both graphs share the scale
+    char text[64];
+    ImGui::PushItemWidth(-1);                   // full width
+    snprintf(text, sizeof(text), "CPU %.2f ms", cpuHistory[last]);
+    ImGui::PlotLines("##cpu", cpuHistory, PERF_HISTORY, historyIndex, text, 0.0f, maxTime, ImVec2(0, 50));
+    snprintf(text, sizeof(text), "GPU %.2f ms", gpuHistory[last]);
+    ImGui::PlotLines("##gpu", gpuHistory, PERF_HISTORY, historyIndex, text, 0.0f, maxTime, ImVec2(0, 50));
+    ImGui::PopItemWidth();
+
+    // Profiler tree
+    if(ImGui::CollapsingHeader("Scopes (ms)", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Columns(3, "scopes");
+        ImGui::SetColumnWidth(0, 160);
+        ImGui::Text("scope"); ImGui::NextColumn();
+        ImGui::Text("CPU");   ImGui::NextColumn();
+        ImGui::Text("GPU");   ImGui::NextColumn();
+        ImGui::Separator();
+        for(int i = 0; i < (int)scopes.size(); ++i)
+            if(scopes[i].parent < 0) drawScope(i, gpuTimer);
+        ImGui::Columns(1);
+    }
+
+    if(ImGui::CollapsingHeader("Counters", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Text("Draws %u | triangles %u", counters.draws, counters.triangles);
+        ImGui::Text("Binds: program %u | VAO %u | texture %u", counters.programBinds, counters.vaoBinds, counters.textureBinds);
+        ImGui::Text("GL state calls %u (%u redundant filtered)", counters.stateCalls, counters.stateCallsFiltered);
+        ImGui::Text("Frame arena: %u allocs, %.1f KB, %u heap", counters.arenaAllocations, counters.arenaBytes / 1024.0, counters.arenaHeapAllocations);
+    }
+
+    if(ImGui::CollapsingHeader("GPU memory", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const GpuMemory::Totals &totals = gpuMemory.getTotals();
+        ImGui::Text("Buffers %.2f MB (%u) | textures %.2f MB (%u)", totals.bytes[GpuMemory::BUFFER] / 1048576.0,
+                    totals.count[GpuMemory::BUFFER], totals.bytes[GpuMemory::TEXTURE] / 1048576.0, totals.count[GpuMemory::TEXTURE]);
+        ImGui::Text("Renderbuffers %.2f MB (%u)", totals.bytes[GpuMemory::RENDERBUFFER] / 1048576.0, totals.count[GpuMemory::RENDERBUFFER]);
+        if(gpuMemory.getBudget())
+            ImGui::Text("Total %.2f / %.2f MB budget | %u evictions", totals.total() / 1048576.0, gpuMemory.getBudget() / 1048576.0, totals.evictions);
+        else
+            ImGui::Text("Total %.2f MB (no budget)", totals.total() / 1048576.0);
+
+        size_t driverTotal, driverAvailable;
+        if(gpuMemory.driverMemory(driverTotal, driverAvailable))
+            ImGui::Text("Driver: %.0f MB available of %.0f MB", driverAvailable / 1048576.0, driverTotal / 1048576.0);
+
+        std::vector<std::pair<std::string, size_t>> owners = gpuMemory.getOwners();
+        for(size_t i = 0; i < owners.size() && i < 6; ++i)
+            ImGui::BulletText("%-20s %8.2f MB", owners[i].first.c_str(), owners[i].second / 1048576.0);
+    }
+
+    if(drawControls && ImGui::CollapsingHeader("Modes", ImGuiTreeNodeFlags_DefaultOpen))
+        drawControls();
+
+    ImGui::End();
+}
+
+void PerfOverlay::drawScope(int index, const GpuTimer &gpuTimer) const
+{
+    const Scope &scope = scopes[index];
+    bool leaf = std::none_of(scopes.begin(), scopes.end(), [&](const Scope &child) { return child.parent == index; });
+
+    bool expanded = ImGui::TreeNodeEx(scope.name.c_str(), ImGuiTreeNodeFlags_DefaultOpen | (leaf ? ImGuiTreeNodeFlags_Leaf : 0));
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", scope.average);
+    ImGui::NextColumn();
+    double gpu = gpuTime(gpuTimer, scope.name);
+    if(gpu >= 0) ImGui::Text("%.3f", gpu);
+    ImGui::NextColumn();
+
+    if(expanded)
+    {
+        for(int i = index + 1; i < (int)scopes.size(); ++i)
+            if(scopes[i].parent == index) drawScope(i, gpuTimer);
+        ImGui::TreePop();
+    }
+}
+
+void PerfOverlay::render()
+{
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
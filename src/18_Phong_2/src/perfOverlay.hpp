@@ -0,0 +1,72 @@
+#ifndef PERFOVERLAY_HPP
+#define PERFOVERLAY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct GLFWwindow;
+class GpuTimer;
+
+#define PERF_HISTORY 120        // frames in the frame time graphs
+
+// In-app performance overlay drawn with ImGui (see main.cpp: F1 shows/hides it, Tab gives it the cursor):
+//  - CPU and GPU frame time graphs
+//  - profiler tree: nested CPU scopes (beginScope/endScope) with the GPU time of the GpuTimer scope of the same name
+//  - counters of the frame (draws, triangles, state changes), filled by the caller
+//  - GPU memory: totals, budget and largest owners of gpuMemory, plus the driver's figures when available
+//  - the caller's controls (setControls), e.g. toggles of the optimization modes
+// It owns the ImGui context: other debug windows (e.g. OverdrawView) are drawn between newFrame() and render().
+class PerfOverlay
+{
+public:
+    struct Counters
+    {
+        unsigned draws = 0, triangles = 0;
+        unsigned programBinds = 0, vaoBinds = 0, textureBinds = 0;
+        unsigned stateCalls = 0, stateCallsFiltered = 0;    // GLState
+        unsigned arenaAllocations = 0, arenaHeapAllocations = 0;   // FrameArena, last frame
+        size_t   arenaBytes = 0;
+    };
+
+    explicit PerfOverlay(GLFWwindow *window);
+    ~PerfOverlay();
+
+    PerfOverlay(const PerfOverlay &) = delete;
+    PerfOverlay &operator=(const PerfOverlay &) = delete;
+
+    void beginScope(const std::string &name);       // CPU scopes, can be nested. The outermost one is the frame.
+    void endScope();
+    void endFrame(const GpuTimer &gpuTimer);        // After the outermost scope: adds the frame to the graphs
+
+    void setControls(std::function<void()> drawControls);
+
+    void newFrame(bool mouseInput);                 // mouseInput: false while the cursor drives the camera
+    void draw(const Counters &counters, const GpuTimer &gpuTimer);
+    void render();
+
+private:
+    struct Scope
+    {
+        std::string name;
+        int      parent;
+        double   time = 0;                          // ms, this frame
+        double   average = 0;                       // ms, exponential moving average
+        std::chrono::steady_clock::time_point start = {};      // set by beginScope()
+    };
+
+    std::vector<Scope> scopes;                      // tree: each scope after its parent; kept between frames
+    int      open;                                  // innermost open scope (-1: none)
+
+    float    cpuHistory[PERF_HISTORY] = { 0 };      // ms
+    float    gpuHistory[PERF_HISTORY] = { 0 };
+    unsigned historyIndex;
+
+    std::function<void()> drawControls;
+
+    void drawScope(int index, const GpuTimer &gpuTimer) const;
+};
+
+#endif
@@ -0,0 +1,463 @@
+#include "regressionTest.hpp"
+#include "camera.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+const unsigned WARM_UP_FRAMES   = 10;           // not included in the frame time percentiles
+const int      IMAGE_TOLERANCE  = 8;            // max. difference per channel (0-255) of a matching pixel
+const double   MAX_BAD_PIXELS   = 0.001;        // fraction of pixels allowed above the tolerance (rasterization differences)
+const double   PERF_THRESHOLD   = 0.20;         // frame time increase that counts as a regression (llvmpipe is noisy)
+
+double now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 1e3;
+}
+
+uint32_t crc32(const unsigned char *data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256] = { 0 };
+    if(!table[1])
+        for(uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for(int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+
+    crc = ~crc;
+    for(size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+void put32(std::vector<unsigned char> &out, uint32_t value)
+{
+    for(int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char)(value >> shift));
+}
+
+void pngChunk(std::ofstream &file, const char *type, const std::vector<unsigned char> &data)
+{
+    std::vector<unsigned char> chunk;
+    put32(chunk, (uint32_t)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    put32(chunk, crc32(&chunk[4], chunk.size() - 4));
+    file.write((const char *)chunk.data(), chunk.size());
+}
+
+// Bits of a deflate stream, least significant first (Huffman codes are packed most significant bit first)
+struct BitWriter
+{
+    std::vector<unsigned char> &out;
+    uint32_t bits = 0;
+    int      count = 0;
+
+    explicit BitWriter(std::vector<unsigned char> &out) : out(out) { }
+
+    void put(uint32_t value, int length)
+    {
+        bits |= value << count;
+        count += length;
+        while(count >= 8) { out.push_back((unsigned char)bits); bits >>= 8; count -= 8; }
+    }
+
+    void putCode(uint32_t code, int length)
+    {
+        uint32_t reversed = 0;
+        for(int i = 0; i < length; ++i) reversed |= ((code >> i) & 1) << (length - 1 - i);
+        put(reversed, length);
+    }
+
+    void flush() { if(count) out.push_back((unsigned char)bits); bits = 0; count = 0; }
+};
+
+// Fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6)
+void putLiteral(BitWriter &writer, unsigned symbol)
+{
+    if(symbol < 144)      writer.putCode(0x30 + symbol, 8);
+    else if(symbol < 256) writer.putCode(0x190 + symbol - 144, 9);
+    else if(symbol < 280) writer.putCode(symbol - 256, 7);
+    else                  writer.putCode(0xc0 + symbol - 280, 8);
+}
+
+// One deflate block with fixed Huffman codes; matches are found with hash chains over the 32 KB window (greedy)
+void deflateFixed(const std::vector<unsigned char> &data, std::vector<unsigned char> &out)
+{
+    static const unsigned short lengthBase[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+                                                    131, 163, 195, 227, 258 };
+    static const unsigned char  lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const unsigned short distBase[30]    = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+                                                    2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const unsigned char  distExtra[30]   = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const size_t WINDOW = 32768, MAX_LENGTH = 258, MAX_CHAIN = 32;
+    const unsigned HASH_BITS = 15;
+
+    BitWriter writer(out);
+    writer.put(1, 1);                           // last block
+    writer.put(1, 2);                           // fixed Huffman codes
+
+    std::vector<int> head((size_t)1 << HASH_BITS, -1), prev(WINDOW, -1);
+    auto hash = [&](size_t i) { return ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & ((1u << HASH_BITS) - 1); };
+    auto insert = [&](size_t i) { if(i + 2 < data.size()) { unsigned h = hash(i); prev[i % WINDOW] = head[h]; head[h] = (int)i; } };
+
+    size_t i = 0;
+    while(i < data.size())
+    {
+        size_t bestLength = 0, bestDistance = 0;
+        if(i + 2 < data.size())
+        {
+            size_t maxLength = std::min(MAX_LENGTH, data.size() - i);
+            int candidate = head[hash(i)];
+            for(size_t chain = 0; candidate >= 0 && i - candidate <= WINDOW - 1 && chain < MAX_CHAIN; ++chain)
+            {
+                size_t length = 0;
+                while(length < maxLength && data[candidate + length] == data[i + length]) ++length;
+                if(length > bestLength) { bestLength = length; bestDistance = i - candidate; }
+                if(length == maxLength) break;
+                candidate = prev[candidate % WINDOW];
+            }
+        }
+
+        if(bestLength < 3)
+        {
+            putLiteral(writer, data[i]);
+            insert(i++);
+            continue;
+        }
+
+        unsigned code = 0;
+        while(code < 28 && lengthBase[code + 1] <= bestLength) ++code;
+        putLiteral(writer, 257 + code);
+        writer.put((uint32_t)(bestLength - lengthBase[code]), lengthExtra[code]);
+
+        code = 0;
+        while(code < 29 && distBase[code + 1] <= bestDistance) ++code;
+        writer.putCode(code, 5);
+        writer.put((uint32_t)(bestDistance - distBase[code]), distExtra[code]);
+
+        for(size_t end = i + bestLength; i < end; ++i) insert(i);
+    }
+
+    putLiteral(writer, 256);                    // end of block
+    writer.flush();
+}
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if(sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))];
+}
+
+// Value of "key": number in a flat JSON object (-1 if missing)
+double jsonNumber(const std::string &json, const std::string &key)
+{
+    size_t pos = json.find("\"" + key + "\"");
+    if(pos == std::string::npos) return -1;
+    pos = json.find(':', pos);
+    return pos == std::string::npos ? -1 : std::atof(json.c_str() + pos + 1);
+}
+
+} // anonymous namespace end
+
+const double RegressionTest::TIME_STEP = 1.0 / 30.0;
+
+bool writePNG(const std::string &path, int width, int height, const unsigned char *rgba, bool compress)
+{
+    std::ofstream file(path, std::ios::binary);
+    if(!file.is_open()) return false;
+
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write((const char *)signature, 8);
+
+    std::vector<unsigned char> header;
+    put32(header, width);
+    put32(header, height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });        // 8 bit RGBA, deflate, no interlace
+    pngChunk(file, "IHDR", header);
+
+    // Scanlines in a zlib stream. Compressed: each row with the filter (none, sub or up) whose bytes add up to the least,
+    // as signed values (the usual heuristic). Stored: filter 0.
+    std::vector<unsigned char> raw;
+    size_t rowSize = (size_t)width * 4;
+    raw.reserve((size_t)height * (rowSize + 1));
+    for(int y = 0; y < height; ++y)
+    {
+        const unsigned char *row = rgba + y * rowSize, *above = y ? row - rowSize : nullptr;
+        unsigned long sums[3] = { 0, 0, 0 };
+        for(size_t x = 0; compress && x < rowSize; ++x)
+        {
+            sums[0] += std::abs((signed char)row[x]);
+            sums[1] += std::abs((signed char)(row[x] - (x >= 4 ? row[x - 4] : 0)));
+            sums[2] += std::abs((signed char)(row[x] - (above ? above[x] : 0)));
+        }
+        unsigned char filter = 0;
+        if(compress) filter = (unsigned char)(std::min_element(sums, sums + 3) - sums);
+
+        raw.push_back(filter);
+        for(size_t x = 0; x < rowSize; ++x)
+            raw.push_back((unsigned char)(row[x] - (filter == 1 ? (x >= 4 ? row[x - 4] : 0) : filter == 2 ? (above ? above[x] : 0) : 0)));
+    }
+
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    if(compress) deflateFixed(raw, zlib);
+    else
+    {
+        size_t pos = 0;
+        do
+        {
+            size_t size = std::min<size_t>(raw.size() - pos, 65535);
+            zlib.push_back(pos + size == raw.size() ? 1 : 0);       // last block flag
+            zlib.insert(zlib.end(), { (unsigned char)(size & 0xff), (unsigned char)(size >> 8), (unsigned char)(~size & 0xff), (unsigned char)((~size >> 8) & 0xff) });
+            zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + size);
+            pos += size;
+        } while(pos < raw.size());
+    }
+
+    uint32_t a = 1, b = 0;                                  // Adler-32
+    for(unsigned char c : raw) { a = (a + c) % 65521; b = (b + a) % 65521; }
+    put32(zlib, (b << 16) | a);
+
+    pngChunk(file, "IDAT", zlib);
+    pngChunk(file, "IEND", std::vector<unsigned char>());
+    return file.good();
+}
+
+RegressionTest::RegressionTest(const std::string &dir, const std::string &name, unsigned frames, bool update, bool compareTimes,
+                               const std::string &outDir)
+    : dir(dir), outDir(outDir), name(name), frames(std::max(frames, 1u)), frame(0), update(update), compareTimes(compareTimes), failures(0), lastEnd(0)
+{
+    for(unsigned i = 1; i <= 4; ++i) checkpoints.push_back(this->frames * i / 4 - 1);
+
+    for(std::string *path : { &this->dir, &this->outDir })
+        if(!path->empty() && path->back() != '/' && path->back() != '\\') *path += '/';
+}
+
+RegressionTest::~RegressionTest()
+{
+    for(Capture &capture : pending)
+    {
+        glDeleteSync(capture.fence);
+        glDeleteBuffers(1, &capture.pbo);
+        glState.deletedBuffer(capture.pbo);
+        gpuMemory.deletedBuffer(capture.pbo);
+    }
+}
+
+void RegressionTest::setCamera(Camera &cam) const
+{
+    // Arc of 50 degrees around the cubes, looking at them
+    float t = frames > 1 ? (float)frame / (frames - 1) : 0.0f;
+    float angle = glm::radians(-25.0f + 50.0f * t);
+    glm::vec3 center(0.0f, 0.0f, -2.0f);
+
+    glm::vec3 position = center + 5.0f * glm::vec3(std::sin(angle), 0.2f, std::cos(angle));
+    glm::vec3 front = glm::normalize(center - position);
+    cam.Position = position;
+    cam.Yaw   = glm::degrees(std::atan2(front.z, front.x));
+    cam.Pitch = glm::degrees(std::asin(front.y));
+    cam.ProcessMouseMovement(0.0f, 0.0f, true);             // clamps the pitch
+}
+
+void RegressionTest::endFrame(int width, int height)
+{
+    if(done()) return;
+
+    if(std::find(checkpoints.begin(), checkpoints.end(), frame) != checkpoints.end())
+    {
+        Capture capture = { frame, width, height, 0, nullptr };
+        glGenBuffers(1, &capture.pbo);
+        glState.bindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbo);
+        gpuMemory.bufferData(capture.pbo, GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, nullptr, GL_STREAM_READ, "regression test");
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        capture.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pending.push_back(capture);
+    }
+    collect(false);
+
+    double end = now();
+    if(frame > WARM_UP_FRAMES) frameTimes.push_back(end - lastEnd);
+    lastEnd = end;
+    ++frame;
+}
+
+void RegressionTest::collect(bool wait)
+{
+    for(size_t i = 0; i < pending.size(); )
+    {
+        Capture &capture = pending[i];
+        GLenum status = glClientWaitSync(capture.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 10000000000ull : 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            ++i;
+            continue;
+        }
+
+        // Copy out, with the rows flipped (glReadPixels returns the bottom row first)
+        std::vector<unsigned char> rgba((size_t)capture.width * capture.height * 4);
+        size_t rowSize = (size_t)capture.width * 4;
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbo);
+        const unsigned char *data = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rgba.size(), GL_MAP_READ_BIT);
+        if(data)
+        {
+            for(int y = 0; y < capture.height; ++y)
+                std::memcpy(&rgba[(capture.height - 1 - y) * rowSize], data + y * rowSize, rowSize);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glDeleteSync(capture.fence);
+        glDeleteBuffers(1, &capture.pbo);
+        glState.deletedBuffer(capture.pbo);
+        gpuMemory.deletedBuffer(capture.pbo);
+
+        Capture done = capture;
+        pending.erase(pending.begin() + i);
+        if(data) checkImage(done.frame, done.width, done.height, rgba);
+        else
+        {
+            std::cout << "ERROR::REGRESSIONTEST::READBACK_FAILED (frame " << done.frame << ")" << std::endl;
+            ++failures;
+        }
+    }
+}
+
+void RegressionTest::checkImage(unsigned frame, int width, int height, std::vector<unsigned char> &rgba)
+{
+    for(size_t i = 3; i < rgba.size(); i += 4) rgba[i] = 255;       // alpha isn't part of the image
+    std::string golden = dir + name + "_" + std::to_string(frame) + ".png";
+
+    std::string base = outDir + name + "_" + std::to_string(frame);
+    if(update)
+    {
+        if(writePNG(golden, width, height, rgba.data())) std::cout << "Regression: golden image written: " << golden << std::endl;
+        else
+        {
+            std::cout << "ERROR::REGRESSIONTEST::CANNOT_WRITE: " << golden << std::endl;
+            ++failures;
+        }
+        return;
+    }
+
+    int goldenWidth = 0, goldenHeight = 0, channels;
+    unsigned char *expected = stbi_load(golden.c_str(), &goldenWidth, &goldenHeight, &channels, 4);
+    if(!expected)
+    {
+        std::cout << "ERROR::REGRESSIONTEST::MISSING_GOLDEN: " << golden << " (written with --regress-update)" << std::endl;
+        writePNG(base + "_actual.png", width, height, rgba.data());
+        ++failures;
+        return;
+    }
+
+    size_t bad = (size_t)width * height;
+    int maxDifference = 255;
+    std::vector<unsigned char> mask(rgba.size(), 0);
+    if(goldenWidth == width && goldenHeight == height)
+    {
+        bad = 0;
+        maxDifference = 0;
+        for(size_t p = 0; p < (size_t)width * height; ++p)
+        {
+            int difference = 0;
+            for(int c = 0; c < 3; ++c) difference = std::max(difference, std::abs(rgba[4 * p + c] - expected[4 * p + c]));
+            maxDifference = std::max(maxDifference, difference);
+
+            bool mismatch = difference > IMAGE_TOLERANCE;
+            if(mismatch) ++bad;
+            unsigned char gray = (unsigned char)((expected[4 * p] + expected[4 * p + 1] + expected[4 * p + 2]) / 12);
+            mask[4 * p]     = mismatch ? 255 : gray;
+            mask[4 * p + 1] = mismatch ? 0 : gray;
+            mask[4 * p + 2] = mismatch ? 0 : gray;
+            mask[4 * p + 3] = 255;
+        }
+    }
+    stbi_image_free(expected);
+
+    bool passed = bad <= MAX_BAD_PIXELS * width * height;
+    std::cout << "Regression: frame " << frame << " " << (passed ? "matches" : "DIFFERS FROM") << " " << golden << " (" << bad <<
+                 " pixels above tolerance, max. difference " << maxDifference << ")" << std::endl;
+    if(passed) return;
+
+    ++failures;
+    writePNG(base + "_actual.png", width, height, rgba.data());
+    if(goldenWidth == width && goldenHeight == height) writePNG(base + "_diff.png", width, height, mask.data());
+}
+
+void RegressionTest::checkTimes()
+{
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double p50 = percentile(sorted, 0.5), p90 = percentile(sorted, 0.9), p99 = percentile(sorted, 0.99);
+    double maxTime = sorted.empty() ? 0 : sorted.back();
+
+    std::cout << "Regression: frame times (" << sorted.size() << " frames): p50 " << p50 << " ms | p90 " << p90 << " ms | p99 " << p99 <<
+                 " ms | max " << maxTime << " ms" << std::endl;
+    if(!compareTimes) return;
+
+    std::string path = dir + name + ".json";
+    if(!update)
+    {
+        std::ifstream in(path);
+        if(!in.is_open())
+        {
+            std::cout << "ERROR::REGRESSIONTEST::MISSING_BASELINE: " << path << " (written with --regress-update)" << std::endl;
+            ++failures;
+            return;
+        }
+
+        std::stringstream json;
+        json << in.rdbuf();
+        double baseP50 = jsonNumber(json.str(), "p50"), baseP90 = jsonNumber(json.str(), "p90");
+        if(baseP50 <= 0 || baseP90 <= 0)
+        {
+            std::cout << "ERROR::REGRESSIONTEST::BAD_BASELINE: " << path << std::endl;
+            ++failures;
+            return;
+        }
+
+        bool slower = p50 > baseP50 * (1 + PERF_THRESHOLD) || p90 > baseP90 * (1 + PERF_THRESHOLD);
+        std::cout << "Regression: baseline p50 " << baseP50 << " ms | p90 " << baseP90 << " ms: " <<
+                     (slower ? "PERFORMANCE REGRESSION" : "ok") << " (threshold " << PERF_THRESHOLD * 100 << " %)" << std::endl;
+        if(slower) ++failures;
+        return;
+    }
+
+    std::ofstream out(path);
+    out << "{\n    \"name\": \"" << name << "\",\n    \"frames\": " << sorted.size() << ",\n    \"p50\": " << p50 << ",\n    \"p90\": " << p90 <<
+           ",\n    \"p99\": " << p99 << ",\n    \"max\": " << maxTime << "\n}\n";
+    if(out.good()) std::cout << "Regression: baseline written: " << path << std::endl;
+    else
+    {
+        std::cout << "ERROR::REGRESSIONTEST::CANNOT_WRITE: " << path << std::endl;
+        ++failures;
+    }
+}
+
+int RegressionTest::finish()
+{
+    collect(true);
+    checkTimes();
+    if(frame < frames)                          // e.g. window closed: the later checkpoints were never compared
+    {
+        std::cout << "ERROR::REGRESSIONTEST::INCOMPLETE: " << frame << " of " << frames << " frames" << std::endl;
+        ++failures;
+    }
+
+    std::cout << "Regression: " << (failures ? "FAILED" : "passed") << " (" << name << ", " << frame << " frames)" << std::endl;
+    return failures ? 1 : 0;
+}
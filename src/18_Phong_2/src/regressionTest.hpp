@@ -0,0 +1,73 @@
+#ifndef REGRESSIONTEST_HPP
+#define REGRESSIONTEST_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+
+#include <string>
+#include <vector>
+
+class Camera;
+
+// Golden image and frame time regression test of the render loop (--regress, see main.cpp).
+// The loop runs a fixed number of frames with a fixed time step and a fixed camera path, so every run draws the same images:
+//  - At 4 checkpoints the back buffer is read into a pixel pack buffer and fenced; the copy is mapped some frames later,
+//    when the fence has signaled, so the readback doesn't stall the loop. Each image is compared with
+//    <dir>/<name>_<frame>.png (channel difference above IMAGE_TOLERANCE counts as a bad pixel). Failures write the
+//    actual image and a difference mask to outDir (default: the working directory), never to dir.
+//  - Frame times (wall clock between endFrame() calls, warm up frames excluded) are reduced to percentiles and compared
+//    with <dir>/<name>.json. p50 or p90 slower than the baseline by more than PERF_THRESHOLD is a regression.
+// Goldens and baseline are only written with update = true (--regress-update); otherwise a missing one is a failure.
+// With compareTimes = false (e.g. ctest, on machines without a baseline of their own) frame times are only reported.
+class RegressionTest
+{
+public:
+    RegressionTest(const std::string &dir, const std::string &name, unsigned frames = 120, bool update = false, bool compareTimes = true,
+                   const std::string &outDir = "");
+    ~RegressionTest();
+
+    RegressionTest(const RegressionTest &) = delete;
+    RegressionTest &operator=(const RegressionTest &) = delete;
+
+    double getTime() const { return frame * TIME_STEP; }           // Animation time of the current frame
+    void   setCamera(Camera &cam) const;                           // Camera path position of the current frame
+
+    void   endFrame(int width, int height);                        // Call before swapping buffers
+    bool   done() const { return frame >= frames; }
+    int    finish();                                               // Waits for the readbacks, reports; 0: passed
+
+    static const double TIME_STEP;
+
+private:
+    struct Capture
+    {
+        unsigned frame;
+        int      width, height;
+        unsigned pbo;
+        GLsync   fence;
+    };
+
+    std::string dir, outDir, name;
+    unsigned    frames, frame;
+    bool        update, compareTimes;
+    int         failures;
+
+    std::vector<unsigned> checkpoints;
+    std::vector<Capture>  pending;
+    std::vector<double>   frameTimes;          // ms
+    double lastEnd;
+
+    void collect(bool wait);                    // Map the captures whose fence signaled (all of them if wait)
+    void checkImage(unsigned frame, int width, int height, std::vector<unsigned char> &rgba);
+    void checkTimes();
+};
+
+// PNG writer, RGBA8, first row at the top. Compressed with fixed Huffman codes, or stored (faster, ~4 bytes/pixel).
+// Returns false if the file can't be written.
+bool writePNG(const std::string &path, int width, int height, const unsigned char *rgba, bool compress = true);
+
+#endif
@@ -0,0 +1,392 @@
+#include "renderGraph.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+#include "gpuTimer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+double now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 1e3;
+}
+
+// Format and type for glTexImage2D (no data is uploaded, but they must be compatible with the internal format)
+void pixelFormat(GLenum internalFormat, GLenum &format, GLenum &type)
+{
+    switch(internalFormat)
+    {
+    case GL_DEPTH24_STENCIL8:   format = GL_DEPTH_STENCIL;   type = GL_UNSIGNED_INT_24_8; break;
+    case GL_DEPTH_COMPONENT24:  format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; break;
+    case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+    case GL_R16F:
+    case GL_R32F:               format = GL_RED;  type = GL_FLOAT; break;
+    case GL_RG16F:
+    case GL_RG32F:              format = GL_RG;   type = GL_FLOAT; break;
+    case GL_R11F_G11F_B10F:     format = GL_RGB;  type = GL_FLOAT; break;
+    case GL_RGBA16F:
+    case GL_RGBA32F:            format = GL_RGBA; type = GL_FLOAT; break;
+    case GL_RGB10_A2:           format = GL_RGBA; type = GL_UNSIGNED_INT_2_10_10_10_REV; break;
+    default:                    format = GL_RGBA; type = GL_UNSIGNED_BYTE; break;
+    }
+}
+
+GLenum attachmentPoint(GLenum internalFormat)
+{
+    switch(internalFormat)
+    {
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:  return GL_DEPTH_STENCIL_ATTACHMENT;
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F: return GL_DEPTH_ATTACHMENT;
+    default:                    return GL_COLOR_ATTACHMENT0;
+    }
+}
+
+size_t textureBytes(const RenderGraph::TextureDesc &desc)
+{
+    return (size_t)desc.width * desc.height * GpuMemory::bytesPerTexel(desc.internalFormat);
+}
+
+} // anonymous namespace end
+
+// ----- Builder ---------------
+
+void RenderGraph::Builder::read(Resource resource)
+{
+    if(resource >= 0 && resource < (Resource)graph.resources.size())
+        graph.passes[pass].reads.push_back(resource);
+}
+
+void RenderGraph::Builder::write(Resource resource)
+{
+    if(resource >= 0 && resource < (Resource)graph.resources.size())
+        graph.passes[pass].writes.push_back(resource);
+}
+
+// ----- RenderGraph ---------------
+
+RenderGraph::RenderGraph()
+    : frame(0)
+{ }
+
+void RenderGraph::setPassCallbacks(std::function<void(const char *)> begin, std::function<void()> end)
+{
+    beginCallback = std::move(begin);
+    endCallback = std::move(end);
+}
+
+void RenderGraph::reset()
+{
+    resources.clear();
+    passes.clear();
+    order.clear();
+}
+
+RenderGraph::Resource RenderGraph::importBackbuffer(int width, int height)
+{
+    ResourceNode node;
+    node.name = "backbuffer";
+    node.desc = { GL_RGBA8, width, height };
+    node.backbuffer = node.output = true;
+    resources.push_back(node);
+    return (Resource)resources.size() - 1;
+}
+
+RenderGraph::Resource RenderGraph::importTexture(const char *name, unsigned texture, bool output)
+{
+    ResourceNode node;
+    node.name = name;
+    node.texture = texture;
+    node.output = output;
+    resources.push_back(node);
+    return (Resource)resources.size() - 1;
+}
+
+RenderGraph::Resource RenderGraph::createTexture(const char *name, const TextureDesc &desc)
+{
+    ResourceNode node;
+    node.name = name;
+    node.desc = desc;
+    node.transient = true;
+    resources.push_back(node);
+    return (Resource)resources.size() - 1;
+}
+
+RenderGraph::Builder RenderGraph::newPass(const char *name, void *callable, void (*run)(void *))
+{
+    passes.push_back(PassNode());
+    passes.back().name = name;
+    passes.back().run = run;
+    passes.back().callable = callable;
+    return Builder(*this, (unsigned)passes.size() - 1);
+}
+
+void RenderGraph::compile()
+{
+    ++frame;
+    cull();
+    std::string invalidRead = sort();
+    allocate();
+
+    if(changed())                               // only when the frame's structure changes
+    {
+        std::cout << summary() << std::endl;
+        if(!invalidRead.empty()) std::cout << "ERROR::RENDERGRAPH::READ_BEFORE_WRITE: " << invalidRead << std::endl;
+
+        lastPasses.clear();
+        for(const PassNode &pass : passes) lastPasses.push_back(pass.culled ? nullptr : pass.name);
+        lastStats = stats;
+    }
+}
+
+bool RenderGraph::changed() const
+{
+    if(passes.size() != lastPasses.size() || stats.transients != lastStats.transients || stats.pooled != lastStats.pooled ||
+       stats.transientBytes != lastStats.transientBytes || stats.pooledBytes != lastStats.pooledBytes)
+        return true;
+
+    for(size_t p = 0; p < passes.size(); ++p)
+        if(passes[p].culled != !lastPasses[p] || (lastPasses[p] && std::strcmp(passes[p].name, lastPasses[p])))
+            return true;
+    return false;
+}
+
+void RenderGraph::cull()
+{
+    // Backwards: a pass is needed if it writes something needed later (or after the frame); then what it reads is needed.
+    // Writes are assumed to keep the previous contents (passes drawing on top), so all the writers of a needed resource stay.
+    std::pmr::vector<bool> needed(resources.size(), false, frameArena.resource());
+    for(size_t r = 0; r < resources.size(); ++r) needed[r] = resources[r].output;
+
+    for(int p = (int)passes.size() - 1; p >= 0; --p)
+    {
+        PassNode &pass = passes[p];
+        pass.culled = std::none_of(pass.writes.begin(), pass.writes.end(), [&](Resource r) { return needed[r]; });
+        if(!pass.culled)
+            for(Resource r : pass.reads) needed[r] = true;
+    }
+}
+
+std::string RenderGraph::sort()
+{
+    // A pass sees the writes of the passes declared before it, so the declaration order follows the dependencies. The
+    // only invalid graphs read a transient texture before any pass wrote it (returned: "pass reads texture").
+    std::pmr::vector<bool> written(resources.size(), false, frameArena.resource());
+    std::string invalidRead;
+    order.clear();
+    for(unsigned p = 0; p < passes.size(); ++p)
+    {
+        const PassNode &pass = passes[p];
+        if(pass.culled) continue;
+
+        for(Resource r : pass.reads)
+            if(resources[r].transient && !written[r] && invalidRead.empty())
+                invalidRead = std::string(pass.name) + " reads " + resources[r].name;
+        for(Resource r : pass.writes) written[r] = true;
+        order.push_back(p);
+    }
+    return invalidRead;
+}
+
+void RenderGraph::allocate()
+{
+    // Lifetimes of the transients, in execution indices
+    for(unsigned i = 0; i < order.size(); ++i)
+    {
+        const PassNode &pass = passes[order[i]];
+        for(const std::pmr::vector<Resource> *list : { &pass.reads, &pass.writes })
+            for(Resource r : *list)
+            {
+                ResourceNode &resource = resources[r];
+                if(resource.firstPass < 0) resource.firstPass = (int)i;
+                resource.lastPass = std::max(resource.lastPass, (int)i);
+            }
+    }
+
+    std::pmr::vector<Resource> transients(frameArena.resource());
+    for(size_t r = 0; r < resources.size(); ++r)
+        if(resources[r].transient && resources[r].firstPass >= 0) transients.push_back((Resource)r);
+    std::sort(transients.begin(), transients.end(), [&](Resource a, Resource b) { return resources[a].firstPass < resources[b].firstPass; });
+
+    // Each transient takes a pooled target of the same format and size that is free by its first pass (its previous user
+    // this frame is done with it), or a new one
+    for(PoolTarget &target : pool) target.busyUntil = -1;
+
+    stats = Stats();
+    for(Resource r : transients)
+    {
+        ResourceNode &resource = resources[r];
+        auto target = std::find_if(pool.begin(), pool.end(), [&](const PoolTarget &candidate)
+                                   { return candidate.desc == resource.desc && candidate.busyUntil < resource.firstPass; });
+        unsigned index = target == pool.end() ? newTarget(resource.desc) : (unsigned)(target - pool.begin());
+
+        PoolTarget &chosen = pool[index];
+        if(chosen.busyUntil < 0)
+        {
+            ++stats.pooled;
+            stats.pooledBytes += textureBytes(chosen.desc);
+        }
+        chosen.busyUntil = resource.lastPass;
+        chosen.lastFrame = frame;
+        resource.texture = chosen.texture;
+
+        ++stats.transients;
+        stats.transientBytes += textureBytes(resource.desc);
+    }
+
+    for(const PassNode &pass : passes) pass.culled ? ++stats.culled : ++stats.passes;
+
+    // Targets nobody wanted for a while (e.g. the G-buffer after switching to forward shading) go back to the driver
+    for(size_t i = 0; i < pool.size(); )
+    {
+        if(frame - pool[i].lastFrame <= RENDERGRAPH_POOL_FRAMES) { ++i; continue; }
+
+        unsigned texture = pool[i].texture;
+        for(auto it = framebuffers.begin(); it != framebuffers.end(); )
+            it = std::find(it->first.begin(), it->first.end(), texture) != it->first.end() ? framebuffers.erase(it) : std::next(it);
+        pool.erase(pool.begin() + i);
+    }
+}
+
+unsigned RenderGraph::newTarget(const TextureDesc &desc)
+{
+    PoolTarget target;
+    target.desc = desc;
+    target.texture = TextureHandle::generate();
+    target.busyUntil = -1;
+    target.lastFrame = frame;
+
+    GLenum format, type;
+    pixelFormat(desc.internalFormat, format, type);
+    glState.bindTexture(0, GL_TEXTURE_2D, target.texture);
+    gpuMemory.texImage2D(target.texture, GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, format, type, nullptr, "render graph");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    pool.push_back(std::move(target));
+    return (unsigned)pool.size() - 1;
+}
+
+void RenderGraph::execute()
+{
+    for(unsigned p : order)
+    {
+        PassNode &pass = passes[p];
+        if(beginCallback) beginCallback(pass.name);
+
+        double start = now();
+        bindTargets(pass);
+        pass.run(pass.callable);
+        pass.cpuTime = now() - start;
+
+        if(endCallback) endCallback();
+    }
+    glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderGraph::bindTargets(const PassNode &pass)
+{
+    std::pmr::vector<Resource> attachments(frameArena.resource());
+    for(Resource r : pass.writes)
+    {
+        const ResourceNode &resource = resources[r];
+        if(resource.backbuffer)
+        {
+            glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+            glState.viewport(0, 0, resource.desc.width, resource.desc.height);
+            return;
+        }
+        if(resource.transient) attachments.push_back(r);
+    }
+    if(attachments.empty()) return;             // only imported targets: the pass binds them
+
+    framebuffer(attachments.data(), attachments.size());
+    const TextureDesc &desc = resources[attachments[0]].desc;
+    glState.viewport(0, 0, desc.width, desc.height);
+}
+
+unsigned RenderGraph::getTexture(Resource resource) const
+{
+    return resource >= 0 && resource < (Resource)resources.size() ? resources[resource].texture : 0;
+}
+
+unsigned RenderGraph::getFramebuffer(std::initializer_list<Resource> attachments)
+{
+    return framebuffer(attachments.begin(), attachments.size());
+}
+
+unsigned RenderGraph::framebuffer(const Resource *attachments, size_t count)
+{
+    framebufferKey.clear();
+    for(size_t i = 0; i < count; ++i) framebufferKey.push_back(getTexture(attachments[i]));
+
+    auto it = framebuffers.find(framebufferKey);
+    if(it != framebuffers.end())
+    {
+        glState.bindFramebuffer(GL_FRAMEBUFFER, it->second);
+        return it->second;
+    }
+
+    FramebufferHandle handle = FramebufferHandle::generate();
+    glState.bindFramebuffer(GL_FRAMEBUFFER, handle);
+
+    std::vector<GLenum> drawBuffers;
+    for(size_t i = 0; i < count; ++i)
+    {
+        Resource r = attachments[i];
+        GLenum point = attachmentPoint(resources[r].desc.internalFormat);
+        if(point == GL_COLOR_ATTACHMENT0)
+        {
+            point += (GLenum)drawBuffers.size();
+            drawBuffers.push_back(point);
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, point, GL_TEXTURE_2D, resources[r].texture, 0);
+    }
+    if(drawBuffers.empty()) glDrawBuffer(GL_NONE);
+    else glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::RENDERGRAPH::FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+    unsigned name = handle;
+    framebuffers[framebufferKey] = std::move(handle);
+    return name;
+}
+
+std::string RenderGraph::summary() const
+{
+    std::ostringstream out;
+    out << "Render graph:";
+    for(unsigned p : order) out << (p == order[0] ? " " : " -> ") << passes[p].name;
+    if(stats.culled)
+    {
+        out << " (culled:";
+        for(const PassNode &pass : passes)
+            if(pass.culled) out << " " << pass.name;
+        out << ")";
+    }
+    out << std::fixed << std::setprecision(2) << " | " << stats.transients << " transient targets (" << stats.transientBytes / 1048576.0 <<
+           " MB) in " << stats.pooled << " pooled (" << stats.pooledBytes / 1048576.0 << " MB): aliasing saves " << stats.savedBytes() / 1048576.0 << " MB";
+    return out.str();
+}
+
+void RenderGraph::print(const GpuTimer &gpuTimer) const
+{
+    std::cout << summary() << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for(unsigned p : order)
+        std::cout << "    " << std::left << std::setw(17) << passes[p].name << std::right << " CPU " << std::setw(7) << passes[p].cpuTime <<
+                     " ms | GPU " << std::setw(7) << gpuTimer.get(passes[p].name) << " ms" << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
@@ -0,0 +1,174 @@
+#ifndef RENDERGRAPH_HPP
+#define RENDERGRAPH_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "frameArena.hpp"
+#include "glHandle.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class GpuTimer;
+
+#define RENDERGRAPH_POOL_FRAMES 60      // pooled targets not used for this many frames are released
+
+// Frame graph. Every frame the passes are declared again, with the resources they read and write:
+//      RenderGraph::Resource gDepth = graph.createTexture("depth", { GL_DEPTH24_STENCIL8, width, height });
+//      graph.addPass("geometry", [&](RenderGraph::Builder &pass) { pass.write(gAlbedo); pass.write(gDepth); },
+//                                [&]() { ... });
+//      graph.compile();
+//      graph.execute();
+// compile() culls the passes whose writes nobody uses (the backbuffer and imported outputs are used), checks that
+// the passes run in a valid order (declaration order, which is also the order of their dependencies), and gives each
+// transient texture a target from a pool that lives across frames. Transient textures with the same format and size
+// whose lifetimes (first to last pass using them) don't overlap share one pooled target. execute() binds, for each pass,
+// a framebuffer with the transients it writes (or the default framebuffer if it writes the backbuffer) and sets the
+// viewport; passes that only write imported textures bind their own targets.
+// The nodes of a frame live in frameArena: declaring and compiling a frame makes no heap allocations once the pool and
+// the framebuffers exist. Names must outlive the frame (string literals).
+class RenderGraph
+{
+public:
+    typedef int Resource;
+    static const Resource NONE = -1;
+
+    struct TextureDesc
+    {
+        GLenum internalFormat;
+        int    width, height;
+
+        bool operator==(const TextureDesc &other) const
+        {
+            return internalFormat == other.internalFormat && width == other.width && height == other.height;
+        }
+    };
+
+    class Builder
+    {
+    public:
+        void read(Resource resource);
+        void write(Resource resource);
+
+    private:
+        friend class RenderGraph;
+        Builder(RenderGraph &graph, unsigned pass) : graph(graph), pass(pass) { }
+
+        RenderGraph &graph;
+        unsigned     pass;
+    };
+
+    struct Stats
+    {
+        unsigned passes = 0, culled = 0;
+        unsigned transients = 0, pooled = 0;        // transient textures used / pool targets they were given
+        size_t   transientBytes = 0;                // one target per transient texture
+        size_t   pooledBytes = 0;                   // aliased
+
+        size_t savedBytes() const { return transientBytes - pooledBytes; }
+    };
+
+    RenderGraph();
+
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+
+    // Called around each executed pass (e.g. profiler and GPU timer scopes with the pass name)
+    void setPassCallbacks(std::function<void(const char *)> begin, std::function<void()> end);
+
+    // Declaration, every frame
+    void     reset();                                   // Forgets the passes and resources of the previous frame
+    Resource importBackbuffer(int width, int height);   // Default framebuffer, an output
+    Resource importTexture(const char *name, unsigned texture, bool output = false);    // Owned elsewhere. output: used after the frame
+    Resource createTexture(const char *name, const TextureDesc &desc);                  // Transient
+
+    // setup(Builder &) is called now; execute() when the pass runs. execute is copied into frameArena and never
+    // destroyed, so it can only capture trivially destructible things (references, resources, lambdas capturing those)
+    template<typename Setup, typename Execute>
+    void addPass(const char *name, Setup &&setup, Execute &&execute)
+    {
+        typedef typename std::decay<Execute>::type Callable;
+        static_assert(std::is_trivially_destructible<Callable>::value, "RenderGraph::addPass: execute must be trivially destructible");
+
+        void *callable = new(frameArena.allocate(sizeof(Callable), alignof(Callable))) Callable(std::forward<Execute>(execute));
+        Builder builder = newPass(name, callable, [](void *callable) { (*static_cast<Callable *>(callable))(); });
+        setup(builder);
+    }
+
+    void     compile();
+    void     execute();
+
+    // During execute()
+    unsigned getTexture(Resource resource) const;
+    unsigned getFramebuffer(std::initializer_list<Resource> attachments);  // e.g. to blit from a target
+
+    const Stats &getStats() const { return stats; }
+    void print(const GpuTimer &gpuTimer) const;         // Memory saved by aliasing, passes with their CPU and GPU times
+
+private:
+    struct ResourceNode
+    {
+        const char *name = nullptr;
+        TextureDesc desc = { 0, 0, 0 };
+        bool        transient = false, backbuffer = false, output = false;
+        unsigned    texture = 0;                        // imported, or the pooled target
+        int         firstPass = -1, lastPass = -1;      // execution indices
+    };
+
+    struct PassNode
+    {
+        PassNode() : reads(frameArena.resource()), writes(frameArena.resource()) { }
+
+        const char                *name = nullptr;
+        std::pmr::vector<Resource> reads, writes;
+        void                     (*run)(void *callable) = nullptr;
+        void                      *callable = nullptr;  // execute, in frameArena
+        bool                       culled = false;
+        double                     cpuTime = 0;         // ms, last execution
+    };
+
+    struct PoolTarget
+    {
+        TextureDesc   desc;
+        TextureHandle texture;
+        int           busyUntil;                        // last pass (execution index) of its current user this frame
+        uint64_t      lastFrame;                        // last frame it was used
+    };
+
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode>     passes;
+    std::vector<unsigned>     order;                    // executed passes
+    std::vector<PoolTarget>   pool;
+    std::map<std::vector<unsigned>, FramebufferHandle> framebuffers;     // by attached textures
+    std::vector<unsigned>     framebufferKey;           // lookups (reused)
+    std::function<void(const char *)> beginCallback;
+    std::function<void()>             endCallback;
+
+    Stats       stats, lastStats;
+    uint64_t    frame;
+    std::vector<const char *> lastPasses;               // the summary is printed when the graph changes
+
+    Builder  newPass(const char *name, void *callable, void (*run)(void *));
+    void     cull();
+    std::string sort();
+    void     allocate();
+    bool     changed() const;
+    unsigned newTarget(const TextureDesc &desc);
+    void     bindTargets(const PassNode &pass);
+    unsigned framebuffer(const Resource *attachments, size_t count);
+    std::string summary() const;
+};
+
+#endif
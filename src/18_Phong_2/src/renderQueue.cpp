@@ -0,0 +1,169 @@
+#include "renderQueue.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+#include "frameArena.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+RenderQueue::RenderQueue()
+    : items(frameArena.resource()), entries(frameArena.resource()), scratch(frameArena.resource()), maxItems(0), view(1.0f), farPlane(100.0f)
+{
+    std::memset(&stats, 0, sizeof(stats));
+    beginFrame();
+}
+
+void RenderQueue::setProgramCallback(Shader *program, std::function<void(Shader &)> onBind)
+{
+    programData(program).onBind = std::move(onBind);
+}
+
+void RenderQueue::setView(const glm::mat4 &viewMatrix, float farDistance)
+{
+    view = viewMatrix;
+    farPlane = farDistance;
+}
+
+void RenderQueue::submit(const DrawItem &item, unsigned pass)
+{
+    entries.push_back({ makeKey(item, pass), (uint32_t)items.size() });
+    items.push_back(item);
+}
+
+uint64_t RenderQueue::makeKey(const DrawItem &item, unsigned pass) const
+{
+    float depth = -(view * item.model[3]).z / farPlane;                     // 0 (camera) .. 1 (far plane)
+    uint64_t depthBits = (uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * 0xFFFFF);
+
+    uint64_t key = 0;
+    key |= (uint64_t)(pass & 0xF)                                  << 60;
+    key |= (uint64_t)(item.program->ID & 0xFFF)                    << 48;
+    key |= (uint64_t)((item.material ? item.material->id : 0) & 0xFFFF) << 32;
+    key |= (uint64_t)(item.VAO & 0xFFF)                            << 20;
+    key |= depthBits;
+    return key;
+}
+
+void RenderQueue::radixSort()
+{
+    // LSD radix sort, 8 bits per pass. Passes where every key has the same digit are skipped.
+    size_t n = entries.size();
+    scratch.resize(n);
+
+    for(unsigned shift = 0; shift < 64; shift += 8)
+    {
+        size_t count[256] = { 0 };
+        for(const SortEntry &e : entries) ++count[(e.key >> shift) & 0xFF];
+
+        if(count[(entries[0].key >> shift) & 0xFF] == n) continue;
+
+        size_t offset = 0;
+        for(size_t &c : count)
+        {
+            size_t tmp = c;
+            c = offset;
+            offset += tmp;
+        }
+
+        for(const SortEntry &e : entries) scratch[count[(e.key >> shift) & 0xFF]++] = e;
+        entries.swap(scratch);
+    }
+}
+
+RenderQueue::ProgramData &RenderQueue::programData(Shader *program)
+{
+    auto it = programs.find(program->ID);
+    if(it != programs.end()) return it->second;
+
+    ProgramData &data = programs[program->ID];
+    data.modelLoc        = glGetUniformLocation(program->ID, "model");
+    data.normalMatrixLoc = glGetUniformLocation(program->ID, "normalMatrix");
+    data.colorLoc        = glGetUniformLocation(program->ID, "objectColor");
+    return data;
+}
+
+void RenderQueue::flush()
+{
+    std::memset(&stats, 0, sizeof(stats));
+    programsUsed.clear();
+
+    if(!entries.empty())
+    {
+        radixSort();
+        for(const SortEntry &e : entries) execute(items[e.index]);
+    }
+
+    maxItems = std::max(maxItems, items.size());
+    items.clear();
+    entries.clear();
+
+    frameStats.draws               += stats.draws;
+    frameStats.triangles           += stats.triangles;
+    frameStats.programBinds        += stats.programBinds;
+    frameStats.programBindsAvoided += stats.programBindsAvoided;
+    frameStats.vaoBinds            += stats.vaoBinds;
+    frameStats.vaoBindsAvoided     += stats.vaoBindsAvoided;
+    frameStats.textureBinds        += stats.textureBinds;
+    frameStats.textureBindsAvoided += stats.textureBindsAvoided;
+}
+
+void RenderQueue::beginFrame()
+{
+    std::memset(&frameStats, 0, sizeof(frameStats));
+
+    // The last frame's lists stay in their arena buffer
+    items   = std::pmr::vector<DrawItem>(frameArena.resource());
+    entries = std::pmr::vector<SortEntry>(frameArena.resource());
+    scratch = std::pmr::vector<SortEntry>(frameArena.resource());
+    items.reserve(maxItems);
+    entries.reserve(maxItems);
+    scratch.reserve(maxItems);
+}
+
+void RenderQueue::execute(const DrawItem &item)
+{
+    ProgramData &data = programData(item.program);
+
+    // Program
+    if(glState.useProgram(item.program->ID)) ++stats.programBinds;
+    else ++stats.programBindsAvoided;
+
+    if(std::find(programsUsed.begin(), programsUsed.end(), item.program->ID) == programsUsed.end())
+    {
+        programsUsed.push_back(item.program->ID);
+        if(data.onBind) data.onBind(*item.program);         // once per flush: passes may change them in between (shadow cascades)
+    }
+
+    // Textures
+    if(item.material)
+        for(unsigned unit = 0; unit < RQ_MAX_TEXTURE_UNITS; ++unit)
+        {
+            if(item.material->textures[unit] == 0) continue;
+
+            if(glState.bindTexture(unit, GL_TEXTURE_2D, item.material->textures[unit])) ++stats.textureBinds;
+            else ++stats.textureBindsAvoided;
+        }
+
+    // VAO
+    if(glState.bindVertexArray(item.VAO)) ++stats.vaoBinds;
+    else ++stats.vaoBindsAvoided;
+
+    // Per draw uniforms
+    if(data.modelLoc >= 0)
+        glUniformMatrix4fv(data.modelLoc, 1, GL_FALSE, &item.model[0][0]);
+    if(data.normalMatrixLoc >= 0)
+    {
+        glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(item.model)));
+        glUniformMatrix3fv(data.normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
+    }
+    if(data.colorLoc >= 0 && item.material)
+        glUniform3fv(data.colorLoc, 1, &item.material->color[0]);
+
+    // Draw
+    if(item.indexed)
+        glDrawElements(item.mode, item.count, GL_UNSIGNED_INT, (void *)(size_t)(item.first * sizeof(unsigned)));
+    else
+        glDrawArrays(item.mode, item.first, item.count);
+    ++stats.draws;
+    if(item.mode == GL_TRIANGLES) stats.triangles += item.count / 3;
+}
@@ -0,0 +1,99 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+class Shader;
+
+#define RQ_MAX_TEXTURE_UNITS 4
+
+// Textures and per-object constants shared by several draws
+struct Material
+{
+    unsigned  id = 0;                               // used in the sort key (draws with equal id are assumed to share the material)
+    unsigned  textures[RQ_MAX_TEXTURE_UNITS] = { 0, 0, 0, 0 };     // GL_TEXTURE_2D names bound to units 0..3 (0: none)
+    glm::vec3 color = glm::vec3(1.0f);              // "objectColor" uniform, if the program has it
+};
+
+struct DrawItem
+{
+    Shader         *program;
+    const Material *material = nullptr;
+    unsigned        VAO;
+    GLenum          mode = GL_TRIANGLES;
+    GLint           first = 0;
+    GLsizei         count;
+    bool            indexed = false;                // glDrawElements (GL_UNSIGNED_INT) instead of glDrawArrays
+    glm::mat4       model = glm::mat4(1.0f);        // "model" and "normalMatrix" uniforms
+};
+
+// Collects the draws of a frame and executes them sorted by a 64 bit key:
+//      pass (4 bits) | program (12) | material (16) | VAO (12) | depth (20)
+// so draws sharing program, textures and VAO are consecutive, and opaque draws of a state group go front to back.
+// Keys are sorted with a LSD radix sort. State changes go through glState, which skips the redundant ones.
+// The draw list lives in frameArena: beginFrame() (after frameArena.beginFrame()) starts a new one.
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        unsigned draws, triangles;
+        unsigned programBinds, programBindsAvoided;
+        unsigned vaoBinds,     vaoBindsAvoided;
+        unsigned textureBinds, textureBindsAvoided;
+    };
+
+    RenderQueue();
+
+    // Called when program is bound for the first time in a flush() (set view, projection, lights...)
+    void setProgramCallback(Shader *program, std::function<void(Shader &)> onBind);
+
+    void setView(const glm::mat4 &view, float farPlane);    // Used to compute the depth of each draw
+    void submit(const DrawItem &item, unsigned pass = 0);  // pass: lower passes are drawn first
+    void flush();                                           // Sort, draw and clear the queue
+
+    void beginFrame();                                      // New draw list and per-frame counters
+    const Stats &getStats() const { return stats; }        // Counters of the last flush()
+    const Stats &getFrameStats() const { return frameStats; }   // Counters of all the flush()es since beginFrame()
+
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    struct ProgramData
+    {
+        int modelLoc = -1, normalMatrixLoc = -1, colorLoc = -1;
+        std::function<void(Shader &)> onBind;
+    };
+
+    std::pmr::vector<DrawItem>  items;
+    std::pmr::vector<SortEntry> entries, scratch;   // scratch: radix sort double buffer
+    size_t                      maxItems;           // largest flush() so far (capacity reserved each frame)
+    std::unordered_map<unsigned, ProgramData> programs;
+    std::vector<unsigned>  programsUsed;            // programs bound during the current flush()
+
+    glm::mat4 view;
+    float     farPlane;
+    Stats     stats, frameStats;
+
+    uint64_t     makeKey(const DrawItem &item, unsigned pass) const;
+    void         radixSort();
+    ProgramData &programData(Shader *program);
+    void         execute(const DrawItem &item);
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "shader.hpp"
+#include "glState.hpp"
 
 void Shader::checkCompileErrors(unsigned int shaderID, std::string type)
 {
@@ -27,7 +28,20 @@ void Shader::checkCompileErrors(unsigned int shaderID, std::string type)
     }
 }
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath)
+namespace
+{
+
+void insertPrelude(std::string &source, const std::string &prelude)
+{
+    if(prelude.empty()) return;
+    size_t version = source.find("#version");
+    size_t versionEnd = version == std::string::npos ? 0 : source.find('\n', version) + 1;
+    source.insert(versionEnd, prelude);
+}
+
+} // anonymous namespace end
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath, const std::string &vertexPrelude, const std::string &fragmentPrelude)
 {
     // 1) Retrieve the shaders source code the paths
 
@@ -42,15 +56,18 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
 
     try
     {
-        vertexFile.open(vertexPath);
-        fragmentFile.open(fragmentPath);
-
         std::stringstream vertexStream, fragmentStream;
-        vertexStream << vertexFile.rdbuf();
-        fragmentStream << fragmentFile.rdbuf();
 
+        vertexFile.open(vertexPath);
+        vertexStream << vertexFile.rdbuf();
         vertexFile.close();
-        fragmentFile.close();
+
+        if(fragmentPath)
+        {
+            fragmentFile.open(fragmentPath);
+            fragmentStream << fragmentFile.rdbuf();
+            fragmentFile.close();
+        }
 
         vertexString = vertexStream.str();
         fragmentString = fragmentStream.str();
@@ -60,36 +77,76 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
 
+    insertPrelude(vertexString, vertexPrelude);
+    insertPrelude(fragmentString, fragmentPrelude);
+
     const char *vertexCode = vertexString.c_str();
     const char *fragmentCode = fragmentString.c_str();
 
     // 2) Compile the shaders and the program
 
-    unsigned int vertexID, fragmentID;
+    unsigned int vertexID, fragmentID = 0;
 
     vertexID = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexID, 1, &vertexCode, nullptr);
     glCompileShader(vertexID);
     checkCompileErrors(vertexID, "VERTEX");
 
-    fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentID, 1, &fragmentCode, nullptr);
-    glCompileShader(fragmentID);
-    checkCompileErrors(fragmentID, "FRAGMENT");
+    if(fragmentPath)
+    {
+        fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentID, 1, &fragmentCode, nullptr);
+        glCompileShader(fragmentID);
+        checkCompileErrors(fragmentID, "FRAGMENT");
+    }
 
-    ID = glCreateProgram();
+    ID = ProgramHandle::generate();
     glAttachShader(ID, vertexID);
-    glAttachShader(ID, fragmentID);
+    if(fragmentID) glAttachShader(ID, fragmentID);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
 
     glDeleteShader(vertexID);
-    glDeleteShader(fragmentID);
+    if(fragmentID) glDeleteShader(fragmentID);
+}
+
+Shader::Shader(const char *computePath)
+{
+    std::ifstream computeFile;
+    std::string computeString;
+    computeFile.exceptions( std::ifstream::failbit | std::ifstream::badbit );
+
+    try
+    {
+        computeFile.open(computePath);
+        std::stringstream computeStream;
+        computeStream << computeFile.rdbuf();
+        computeFile.close();
+        computeString = computeStream.str();
+    }
+    catch( std::ifstream::failure &e )
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+    }
+
+    const char *computeCode = computeString.c_str();
+
+    unsigned int computeID = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(computeID, 1, &computeCode, nullptr);
+    glCompileShader(computeID);
+    checkCompileErrors(computeID, "COMPUTE");
+
+    ID = ProgramHandle::generate();
+    glAttachShader(ID, computeID);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+
+    glDeleteShader(computeID);
 }
 
 void Shader::UseProgram()
 {
-    glUseProgram(ID);
+    glState.useProgram(ID);
 }
 
 // Uniforms setting ---------------
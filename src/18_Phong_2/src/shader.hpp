@@ -6,6 +6,7 @@
 #elif IMGUI_IMPL_OPENGL_LOADER_GLAD
 #include <glad/glad.h>
 #endif
+#include "glHandle.hpp"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
@@ -20,9 +21,14 @@ class Shader
     void checkCompileErrors(unsigned int shaderID, std::string type);
 
 public:
-    unsigned int ID;
+    ProgramHandle ID;       // the program is released to deletionQueue with the Shader
 
-    Shader(const char *vertexPath, const char *fragmentPath);
+    // fragmentPath: nullptr for depth only programs. vertexPrelude, fragmentPrelude: GLSL inserted after the #version line.
+    Shader(const char *vertexPath, const char *fragmentPath, const std::string &vertexPrelude = "", const std::string &fragmentPrelude = "");
+    explicit Shader(const char *computePath);      // Compute program (GL 4.3)
+
+    Shader(Shader &&) = default;
+    Shader &operator=(Shader &&) = default;
     void UseProgram();
 
     // >> Uniforms << --------------------------------------------
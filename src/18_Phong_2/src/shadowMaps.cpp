@@ -0,0 +1,156 @@
+#include "shadowMaps.hpp"
+#include "shader.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+const float CASTER_DISTANCE = 30.0f;        // casters up to this distance towards the light (from a cascade's sphere) are kept
+
+} // anonymous namespace end
+
+CascadedShadowMaps::CascadedShadowMaps(unsigned resolution, unsigned numCascades, float shadowDistance)
+    : resolution(std::max(resolution, 16u)), numCascades(glm::clamp(numCascades, 1u, (unsigned)CSM_MAX_CASCADES)),
+      shadowDistance(shadowDistance), lightDir(0.0f, -1.0f, 0.0f)
+{
+    for(unsigned c = 0; c < CSM_MAX_CASCADES; ++c)
+    {
+        lightView[c] = lightSpace[c] = glm::mat4(1.0f);
+        splits[c] = radius[c] = depthRange[c] = 0.0f;
+    }
+
+    depthArray = TextureHandle::generate();
+    glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, depthArray);
+    gpuMemory.texImage3D(depthArray, GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, this->resolution, this->resolution, this->numCascades,
+                         GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr, "shadow maps");
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);        // with comparison: 2x2 hardware PCF
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    FBO = FramebufferHandle::generate();
+    glState.bindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::SHADOWS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+    glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void CascadedShadowMaps::update(const glm::vec3 &direction, const glm::mat4 &view, float fovy, float aspect, float nearPlane,
+                                const glm::vec3 &anchor, float lambda)
+{
+    lightDir = glm::normalize(direction);
+    glm::mat4 invView = glm::inverse(view);
+    float tanHalfY = std::tan(fovy / 2.0f);
+    float tanHalfX = tanHalfY * aspect;
+    glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+    float sliceNear = nearPlane;
+    for(unsigned c = 0; c < numCascades; ++c)
+    {
+        // Practical split: blend of logarithmic and uniform splits
+        float t = (float)(c + 1) / numCascades;
+        float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, t);
+        float uniformSplit = nearPlane + (shadowDistance - nearPlane) * t;
+        splits[c] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+
+        // Bounding sphere of the slice (world space)
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for(unsigned i = 0; i < 8; ++i)
+        {
+            float depth = (i & 4) ? splits[c] : sliceNear;
+            glm::vec4 viewCorner((i & 1 ? 1.0f : -1.0f) * tanHalfX * depth, (i & 2 ? 1.0f : -1.0f) * tanHalfY * depth, -depth, 1.0f);
+            corners[i] = glm::vec3(invView * viewCorner);
+            center += corners[i] / 8.0f;
+        }
+
+        float r = 0.0f;
+        for(const glm::vec3 &corner : corners) r = std::max(r, glm::length(corner - center));
+        r = std::ceil(r * 16.0f) / 16.0f;           // constant size for a given split, whatever the camera orientation
+        radius[c] = r;
+        depthRange[c] = 2.0f * r + CASTER_DISTANCE;
+
+        // Light camera
+        lightView[c] = glm::lookAt(center - lightDir * (r + CASTER_DISTANCE), center, up);
+        glm::mat4 projection = glm::ortho(-r, r, -r, r, 0.0f, depthRange[c]);
+
+        // Snap to whole texels: moving the light camera by fractions of a texel makes the edges shimmer
+        glm::vec4 origin = projection * lightView[c] * glm::vec4(anchor, 1.0f);
+        origin *= resolution / 2.0f;
+        glm::vec2 offset = (glm::round(glm::vec2(origin)) - glm::vec2(origin)) * (2.0f / resolution);
+        projection[3][0] += offset.x;
+        projection[3][1] += offset.y;
+
+        lightSpace[c] = projection * lightView[c];
+        sliceNear = splits[c];
+    }
+}
+
+bool CascadedShadowMaps::casts(unsigned cascade, const glm::vec3 &center, float sphereRadius) const
+{
+    glm::vec3 p = glm::vec3(lightView[cascade] * glm::vec4(center, 1.0f));
+    float r = radius[cascade] + sphereRadius;
+    return std::abs(p.x) <= r && std::abs(p.y) <= r && -p.z + sphereRadius >= 0.0f && -p.z - sphereRadius <= depthRange[cascade];
+}
+
+void CascadedShadowMaps::beginCascade(unsigned cascade)
+{
+    glState.bindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, cascade);
+    glState.viewport(0, 0, resolution, resolution);
+    glState.enable(GL_DEPTH_TEST);
+    glState.depthMask(true);
+    glState.enable(GL_POLYGON_OFFSET_FILL);         // slope scaled bias against shadow acne
+    glPolygonOffset(2.0f, 4.0f);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void CascadedShadowMaps::endPass()
+{
+    glState.disable(GL_POLYGON_OFFSET_FILL);
+    glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void CascadedShadowMaps::bind(const Shader &program, unsigned unit) const
+{
+    glState.bindTexture(unit, GL_TEXTURE_2D_ARRAY, depthArray);
+
+    program.setBool("shadowsEnabled", true);
+    program.setInt("shadowMap", unit);
+    program.setInt("numCascades", numCascades);
+    program.setVec3("sunDirection", lightDir);
+    program.setFloat("shadowTexel", 1.0f / resolution);
+    glUniformMatrix4fv(glGetUniformLocation(program.ID, "lightSpace"), numCascades, GL_FALSE, &lightSpace[0][0][0]);     // arrays in one call
+    glUniform1fv(glGetUniformLocation(program.ID, "cascadeSplits"), numCascades, splits);
+}
+
+std::string CascadedShadowMaps::shaderPrelude(const std::string &shadersDir)
+{
+    std::ifstream file(shadersDir + "shadows.glsl");
+    if(!file.is_open())
+    {
+        std::cout << "ERROR::SHADOWS::FILE_NOT_SUCCESFULLY_READ: " << shadersDir << "shadows.glsl" << std::endl;
+        return "";
+    }
+
+    std::stringstream source;
+    source << file.rdbuf();
+    return source.str();
+}
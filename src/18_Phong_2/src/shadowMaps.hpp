@@ -0,0 +1,70 @@
+#ifndef SHADOWMAPS_HPP
+#define SHADOWMAPS_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+#include "glHandle.hpp"
+
+#include <string>
+
+class Shader;
+
+#define CSM_MAX_CASCADES 4
+
+// Cascaded shadow maps for a directional light. The view frustum (up to shadowDistance) is split in numCascades
+// slices (practical split scheme); each one gets a layer of a depth texture array, rendered with an orthographic
+// light camera that encloses the slice's bounding sphere. The sphere keeps the size constant while the camera
+// rotates and the light camera moves in whole texels, so shadow edges don't shimmer.
+// Usage per frame:
+//      update(...);
+//      for each cascade:  beginCascade(c);  draw casters with casts(c, ...) using a depth program;  (lightSpace uniform = getLightSpace(c))
+//      endPass();
+//      bind(litProgram, unit);         // receivers sample with 3x3 PCF (see shadows.glsl)
+class CascadedShadowMaps
+{
+public:
+    CascadedShadowMaps(unsigned resolution = 2048, unsigned numCascades = 4, float shadowDistance = 50.0f);
+
+    CascadedShadowMaps(const CascadedShadowMaps &) = delete;
+    CascadedShadowMaps &operator=(const CascadedShadowMaps &) = delete;
+
+    // lightDir: direction the light travels. Same frustum as glm::perspective(fovy, aspect, nearPlane, ...).
+    // anchor: a fixed world point, in the space of view (e.g. the site origin in render space); cascades snap to texels
+    // relative to it, so they stay put while the render origin follows the camera.
+    void update(const glm::vec3 &lightDir, const glm::mat4 &view, float fovy, float aspect, float nearPlane,
+                const glm::vec3 &anchor = glm::vec3(0.0f), float lambda = 0.75f);
+
+    // Whether a caster (bounding sphere) can throw shadow inside the cascade
+    bool casts(unsigned cascade, const glm::vec3 &center, float radius) const;
+
+    void beginCascade(unsigned cascade);        // Bind the cascade's layer, clear it, set the depth state
+    void endPass();                             // Back to the default framebuffer and normal depth state
+
+    void bind(const Shader &program, unsigned unit) const;     // Shadow map and uniforms for the receivers
+
+    // GLSL of the receivers (shaders/shadows.glsl: uniforms and sunVisibility()), the fragment prelude of the lit programs
+    static std::string shaderPrelude(const std::string &shadersDir);
+
+    const glm::mat4 &getLightSpace(unsigned cascade) const { return lightSpace[cascade]; }
+    unsigned getNumCascades() const { return numCascades; }
+    unsigned getResolution()  const { return resolution; }
+    unsigned getTexture()     const { return depthArray; }
+
+private:
+    unsigned  resolution, numCascades;
+    float     shadowDistance;
+    glm::vec3 lightDir;
+
+    FramebufferHandle FBO;
+    TextureHandle     depthArray;
+    glm::mat4 lightView[CSM_MAX_CASCADES], lightSpace[CSM_MAX_CASCADES];
+    float     splits[CSM_MAX_CASCADES];         // far view depth of each cascade
+    float     radius[CSM_MAX_CASCADES];
+    float     depthRange[CSM_MAX_CASCADES];     // light camera far plane (near is 0)
+};
+
+#endif
@@ -0,0 +1,425 @@
+#include "softRasterizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+const size_t MIN_VERTICES_PER_THREAD  = 4096;   // below this, threads cost more than they save
+const size_t MIN_TRIANGLES_PER_THREAD = 512;
+
+// Run func(first, last) over [0, count) split in one contiguous range per thread
+template<typename F>
+void parallelRanges(size_t count, unsigned threads, F func)
+{
+    if(threads <= 1)
+    {
+        func(0, count, 0);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    for(unsigned t = 0; t < threads; ++t)
+        pool.emplace_back(func, count * t / threads, count * (t + 1) / threads, t);
+    for(std::thread &thread : pool) thread.join();
+}
+
+// Coverage of the pixel centers (x, y), (x + 1, y), (x + 2, y), (x + 3, y): bit i set if pixel i is inside all 3 edges
+int coverage4(const float a[3], const float b[3], const float c[3], const bool topLeft[3], float x, float y)
+{
+#ifdef SOFT_SSE2
+    __m128 px = _mm_add_ps(_mm_set1_ps(x), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+    __m128 py = _mm_set1_ps(y);
+    __m128 zero = _mm_setzero_ps();
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+    for(int e = 0; e < 3; ++e)
+    {
+        __m128 edge = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[e]), px), _mm_mul_ps(_mm_set1_ps(b[e]), py)), _mm_set1_ps(c[e]));
+        inside = _mm_and_ps(inside, topLeft[e] ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero));
+    }
+    return _mm_movemask_ps(inside);
+#else
+    int mask = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        bool inside = true;
+        for(int e = 0; e < 3; ++e)
+        {
+            float edge = a[e] * (x + i) + b[e] * y + c[e];
+            inside = inside && (topLeft[e] ? edge >= 0.0f : edge > 0.0f);
+        }
+        if(inside) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+uint32_t packColor(const glm::vec3 &color)
+{
+    glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return (uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | 0xff000000u;
+}
+
+double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e3;
+}
+
+} // anonymous namespace end
+
+// ----- SoftTexture ---------------
+
+SoftTexture::SoftTexture(int width, int height, const unsigned char *rgba)
+    : width(std::max(width, 1)), height(std::max(height, 1)), texels(rgba, rgba + (size_t)width * height * 4) { }
+
+glm::vec4 SoftTexture::texel(int x, int y) const
+{
+    x = ((x % width) + width) % width;          // GL_REPEAT
+    y = ((y % height) + height) % height;
+    const unsigned char *t = &texels[((size_t)y * width + x) * 4];
+    return glm::vec4(t[0], t[1], t[2], t[3]) / 255.0f;
+}
+
+glm::vec4 SoftTexture::sample(const glm::vec2 &texCoord, SoftFilter filter) const
+{
+    glm::vec2 p = texCoord * glm::vec2(width, height);
+    if(filter == SOFT_NEAREST) return texel((int)std::floor(p.x), (int)std::floor(p.y));
+
+    p -= 0.5f;                                  // texel centers
+    glm::vec2 base = glm::floor(p), f = p - base;
+    int x = (int)base.x, y = (int)base.y;
+    return glm::mix(glm::mix(texel(x, y), texel(x + 1, y), f.x), glm::mix(texel(x, y + 1), texel(x + 1, y + 1), f.x), f.y);
+}
+
+// ----- PhongShading ---------------
+
+glm::vec3 PhongShading::operator()(const SoftFragment &fragment) const
+{
+    float ambientStrength = 0.1f;
+    glm::vec3 ambient = ambientStrength * lightColor;
+
+    glm::vec3 norm = glm::normalize(fragment.normal);
+    glm::vec3 lightDir = glm::normalize(lightPos - fragment.position);
+    float diff = std::max(glm::dot(norm, lightDir), 0.0f);
+    glm::vec3 diffuse = diff * lightColor;
+
+    float specularStrength = 0.5f;
+    glm::vec3 viewDir = glm::normalize(camPos - fragment.position);
+    glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+    float spec = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), 32.0f);
+    glm::vec3 specular = specularStrength * spec * lightColor;
+
+    glm::vec3 color = objectColor;
+    if(texture) color *= glm::vec3(texture->sample(fragment.texCoord, filter));
+    return (ambient + diffuse + specular) * color;
+}
+
+// ----- SoftRasterizer ---------------
+
+SoftRasterizer::SoftRasterizer(int width, int height, unsigned threads, int tileSize)
+    : width(std::max(width, 1)), height(std::max(height, 1)), tileSize(std::max(tileSize, 4)),
+      numThreads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      cullBackFaces(false), viewProjection(1.0f),
+      color((size_t)this->width * this->height), depth((size_t)this->width * this->height)
+{
+    tilesX = (this->width + this->tileSize - 1) / this->tileSize;
+    tilesY = (this->height + this->tileSize - 1) / this->tileSize;
+    clear(glm::vec3(0.0f));
+}
+
+void SoftRasterizer::clear(const glm::vec3 &clearColor)
+{
+    std::fill(color.begin(), color.end(), packColor(clearColor));
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    draws.clear();
+    batches.clear();
+    stats = Stats{ 0, 0, 0, 0, 0, 0 };
+}
+
+void SoftRasterizer::setCamera(const glm::mat4 &view, const glm::mat4 &projection)
+{
+    viewProjection = projection * view;
+}
+
+void SoftRasterizer::submit(const VertexInput &vertices, const unsigned *indices, size_t count, const glm::mat4 &model,
+                            const void *shader, ShadeFunction shade)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    unsigned draw = (unsigned)draws.size();
+    draws.push_back(Draw{ shader, shade });
+
+    // Vertex stage (as vertexShader.vs)
+    size_t numVertices = indices ? vertices.numVertices : std::min(count, vertices.numVertices);
+    glm::mat4 mvp = viewProjection * model;
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    vertexCache.resize(numVertices);
+
+    unsigned threads = (unsigned)std::min<size_t>(numThreads, std::max<size_t>(1, numVertices / MIN_VERTICES_PER_THREAD));
+    parallelRanges(numVertices, threads, [&](size_t first, size_t last, unsigned)
+    {
+        for(size_t i = first; i < last; ++i)
+        {
+            const float *src = vertices.data + i * vertices.stride;
+            glm::vec4 position(src[vertices.positionOffset], src[vertices.positionOffset + 1], src[vertices.positionOffset + 2], 1.0f);
+            glm::vec3 world = glm::vec3(model * position);
+            glm::vec3 normal = vertices.normalOffset < 0 ? glm::vec3(0.0f) :
+                               normalMatrix * glm::vec3(src[vertices.normalOffset], src[vertices.normalOffset + 1], src[vertices.normalOffset + 2]);
+            glm::vec2 texCoord = vertices.texCoordOffset < 0 ? glm::vec2(0.0f) :
+                                 glm::vec2(src[vertices.texCoordOffset], src[vertices.texCoordOffset + 1]);
+
+            Vertex &v = vertexCache[i];
+            v.clip = mvp * position;
+            float varyings[NUM_VARYINGS] = { world.x, world.y, world.z, normal.x, normal.y, normal.z, texCoord.x, texCoord.y };
+            std::copy(varyings, varyings + NUM_VARYINGS, v.varyings);
+        }
+    });
+
+    // Setup and binning: one batch per range of triangles
+    size_t numTriangles = count / 3;
+    stats.triangles += numTriangles;
+    threads = (unsigned)std::min<size_t>(numThreads, std::max<size_t>(1, numTriangles / MIN_TRIANGLES_PER_THREAD));
+
+    size_t firstBatch = batches.size();
+    batches.resize(firstBatch + threads);
+    for(size_t b = firstBatch; b < batches.size(); ++b) batches[b].bins.resize(tilesX * tilesY);
+
+    parallelRanges(numTriangles, threads, [&](size_t first, size_t last, unsigned t)
+    {
+        setupRange(indices, first, last, draw, batches[firstBatch + t]);
+    });
+
+    for(size_t b = firstBatch; b < batches.size(); ++b)
+    {
+        stats.trianglesSetUp += batches[b].triangles.size();
+        for(const std::vector<unsigned> &bin : batches[b].bins) stats.binEntries += bin.size();
+    }
+    stats.setupTime += elapsedMs(start);
+}
+
+void SoftRasterizer::setupRange(const unsigned *indices, size_t firstTriangle, size_t lastTriangle, unsigned draw, Batch &batch) const
+{
+    for(size_t t = firstTriangle; t < lastTriangle; ++t)
+    {
+        const Vertex *in[3];
+        for(int k = 0; k < 3; ++k) in[k] = &vertexCache[indices ? indices[3 * t + k] : 3 * t + k];
+
+        // Near plane clipping (z >= -w). The other planes are handled by the screen bounds and the depth test.
+        float dist[3];
+        int inside = 0;
+        for(int k = 0; k < 3; ++k)
+        {
+            dist[k] = in[k]->clip.z + in[k]->clip.w;
+            if(dist[k] >= 0.0f) ++inside;
+        }
+
+        if(inside == 3)
+        {
+            setupTriangle(*in[0], *in[1], *in[2], draw, batch);
+            continue;
+        }
+        if(inside == 0) continue;
+
+        Vertex polygon[4];
+        int size = 0;
+        for(int k = 0; k < 3; ++k)
+        {
+            int next = (k + 1) % 3;
+            if(dist[k] >= 0.0f) polygon[size++] = *in[k];
+            if((dist[k] >= 0.0f) != (dist[next] >= 0.0f))
+            {
+                float s = dist[k] / (dist[k] - dist[next]);
+                Vertex &v = polygon[size++];
+                v.clip = glm::mix(in[k]->clip, in[next]->clip, s);
+                for(int i = 0; i < NUM_VARYINGS; ++i) v.varyings[i] = in[k]->varyings[i] + s * (in[next]->varyings[i] - in[k]->varyings[i]);
+            }
+        }
+
+        for(int k = 1; k + 1 < size; ++k) setupTriangle(polygon[0], polygon[k], polygon[k + 1], draw, batch);
+    }
+}
+
+void SoftRasterizer::setupTriangle(const Vertex &v0, const Vertex &v1, const Vertex &v2, unsigned draw, Batch &batch) const
+{
+    const Vertex *v[3] = { &v0, &v1, &v2 };
+    float x[3], y[3], z[3], invW[3];
+    for(int k = 0; k < 3; ++k)
+    {
+        invW[k] = 1.0f / v[k]->clip.w;
+        x[k] = (v[k]->clip.x * invW[k] * 0.5f + 0.5f) * width;
+        y[k] = (v[k]->clip.y * invW[k] * 0.5f + 0.5f) * height;
+        z[k] =  v[k]->clip.z * invW[k] * 0.5f + 0.5f;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if(!(std::abs(area) > 1e-8f)) return;       // degenerate (or NaN)
+    if(area < 0.0f)                             // clockwise: back face
+    {
+        if(cullBackFaces) return;
+        std::swap(v[1], v[2]);
+        std::swap(x[1], x[2]); std::swap(y[1], y[2]); std::swap(z[1], z[2]); std::swap(invW[1], invW[2]);
+        area = -area;
+    }
+
+    // Pixel centers (px + 0.5) inside the bounding box
+    Triangle tri;
+    tri.minX = std::max(0,          (int)std::ceil (std::min({ x[0], x[1], x[2] }) - 0.5f));
+    tri.maxX = std::min(width - 1,  (int)std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f));
+    tri.minY = std::max(0,          (int)std::ceil (std::min({ y[0], y[1], y[2] }) - 0.5f));
+    tri.maxY = std::min(height - 1, (int)std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f));
+    if(tri.minX > tri.maxX || tri.minY > tri.maxY) return;
+
+    // Edge e is opposite to vertex e, so E_e / area is the barycentric weight of vertex e
+    for(int e = 0; e < 3; ++e)
+    {
+        int a = (e + 1) % 3, b = (e + 2) % 3;
+        tri.edgeA[e] = y[a] - y[b];
+        tri.edgeB[e] = x[b] - x[a];
+        // C from the same end point for both directions of a shared edge, so adjacent triangles get exactly opposite values
+        int base = (x[a] < x[b] || (x[a] == x[b] && y[a] < y[b])) ? a : b;
+        tri.edgeC[e] = -(tri.edgeA[e] * x[base] + tri.edgeB[e] * y[base]);
+        tri.topLeft[e] = tri.edgeA[e] > 0.0f || (tri.edgeA[e] == 0.0f && tri.edgeB[e] < 0.0f);
+    }
+
+    // Plane through the 3 vertex values: f(x, y) = sum(E_e(x, y) * f_e) / area
+    auto plane = [&](const float f[3], float out[3])
+    {
+        out[0] = (tri.edgeA[0] * f[0] + tri.edgeA[1] * f[1] + tri.edgeA[2] * f[2]) / area;
+        out[1] = (tri.edgeB[0] * f[0] + tri.edgeB[1] * f[1] + tri.edgeB[2] * f[2]) / area;
+        out[2] = (tri.edgeC[0] * f[0] + tri.edgeC[1] * f[1] + tri.edgeC[2] * f[2]) / area;
+    };
+    plane(z, tri.depth);
+    plane(invW, tri.invW);
+    for(int i = 0; i < NUM_VARYINGS; ++i)
+    {
+        float f[3] = { v[0]->varyings[i] * invW[0], v[1]->varyings[i] * invW[1], v[2]->varyings[i] * invW[2] };
+        plane(f, tri.varyings[i]);
+    }
+    tri.draw = draw;
+
+    // Binning: skip the tiles of the bounding box that are completely outside an edge
+    unsigned index = (unsigned)batch.triangles.size();
+    batch.triangles.push_back(tri);
+    for(int ty = tri.minY / tileSize; ty <= tri.maxY / tileSize; ++ty)
+        for(int tx = tri.minX / tileSize; tx <= tri.maxX / tileSize; ++tx)
+        {
+            float minPx = std::max(tx * tileSize, tri.minX) + 0.5f, maxPx = std::min((tx + 1) * tileSize - 1, tri.maxX) + 0.5f;
+            float minPy = std::max(ty * tileSize, tri.minY) + 0.5f, maxPy = std::min((ty + 1) * tileSize - 1, tri.maxY) + 0.5f;
+
+            bool outside = false;
+            for(int e = 0; e < 3 && !outside; ++e)
+                outside = tri.edgeA[e] * (tri.edgeA[e] > 0.0f ? maxPx : minPx) + tri.edgeB[e] * (tri.edgeB[e] > 0.0f ? maxPy : minPy) + tri.edgeC[e] < 0.0f;
+
+            if(!outside) batch.bins[ty * tilesX + tx].push_back(index);
+        }
+}
+
+void SoftRasterizer::finish()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    unsigned numTiles = tilesX * tilesY;
+    unsigned threads = std::min(numThreads, numTiles);
+    std::vector<size_t> pixels(threads, 0);
+    std::atomic<unsigned> nextTile(0);
+
+    auto worker = [&](unsigned t)
+    {
+        for(unsigned tile = nextTile++; tile < numTiles; tile = nextTile++)
+            rasterizeTile(tile, pixels[t]);
+    };
+
+    if(threads <= 1) worker(0);
+    else
+    {
+        std::vector<std::thread> pool;
+        for(unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+        for(std::thread &thread : pool) thread.join();
+    }
+
+    for(size_t count : pixels) stats.pixelsShaded += count;
+    draws.clear();
+    batches.clear();
+    stats.rasterTime += elapsedMs(start);
+}
+
+void SoftRasterizer::rasterizeTile(unsigned tile, size_t &pixelsShaded)
+{
+    int tileX0 = (tile % tilesX) * tileSize, tileY0 = (tile / tilesX) * tileSize;
+    int tileX1 = std::min(tileX0 + tileSize, width) - 1, tileY1 = std::min(tileY0 + tileSize, height) - 1;
+
+    for(const Batch &batch : batches)
+        for(unsigned index : batch.bins[tile])
+        {
+            const Triangle &tri = batch.triangles[index];
+            const Draw &draw = draws[tri.draw];
+            int x0 = std::max(tileX0, tri.minX), x1 = std::min(tileX1, tri.maxX);
+            int y0 = std::max(tileY0, tri.minY), y1 = std::min(tileY1, tri.maxY);
+
+            for(int y = y0; y <= y1; ++y)
+            {
+                float py = y + 0.5f;
+                for(int x = x0; x <= x1; x += 4)
+                {
+                    int mask = coverage4(tri.edgeA, tri.edgeB, tri.edgeC, tri.topLeft, x + 0.5f, py);
+                    if(x1 - x < 3) mask &= (1 << (x1 - x + 1)) - 1;
+
+                    for(int i = 0; mask; ++i, mask >>= 1)
+                    {
+                        if(!(mask & 1)) continue;
+
+                        float px = x + i + 0.5f;
+                        size_t pixel = (size_t)y * width + x + i;
+                        float z = tri.depth[0] * px + tri.depth[1] * py + tri.depth[2];
+                        if(!(z < depth[pixel]) || z < 0.0f) continue;       // GL_LESS; beyond the far plane z > 1 fails too
+
+                        // Perspective correct varyings
+                        float w = 1.0f / (tri.invW[0] * px + tri.invW[1] * py + tri.invW[2]);
+                        float varyings[NUM_VARYINGS];
+                        for(int k = 0; k < NUM_VARYINGS; ++k)
+                            varyings[k] = (tri.varyings[k][0] * px + tri.varyings[k][1] * py + tri.varyings[k][2]) * w;
+
+                        SoftFragment fragment;
+                        fragment.position = glm::vec3(varyings[0], varyings[1], varyings[2]);
+                        fragment.normal   = glm::vec3(varyings[3], varyings[4], varyings[5]);
+                        fragment.texCoord = glm::vec2(varyings[6], varyings[7]);
+
+                        depth[pixel] = z;
+                        color[pixel] = packColor(draw.shade(draw.shader, fragment));
+                        ++pixelsShaded;
+                    }
+                }
+            }
+        }
+}
+
+bool SoftRasterizer::savePPM(const std::string &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if(!file.is_open()) return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row(width * 3);
+    for(int y = height - 1; y >= 0; --y)            // PPM rows go top to bottom
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            uint32_t c = color[(size_t)y * width + x];
+            row[3 * x] = c & 0xff;
+            row[3 * x + 1] = (c >> 8) & 0xff;
+            row[3 * x + 2] = (c >> 16) & 0xff;
+        }
+        file.write((const char *)row.data(), row.size());
+    }
+    return file.good();
+}
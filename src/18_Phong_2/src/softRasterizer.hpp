@@ -0,0 +1,149 @@
+#ifndef SOFTRASTERIZER_HPP
+#define SOFTRASTERIZER_HPP
+
+#include "glm/glm.hpp"
+#include "vertexFormat.hpp"         // VertexInput
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum SoftFilter { SOFT_NEAREST, SOFT_BILINEAR };
+
+// RGBA8 texture sampled with GL_REPEAT wrapping (texture coordinate (0, 0) is the first texel, as in OpenGL)
+class SoftTexture
+{
+public:
+    SoftTexture(int width, int height, const unsigned char *rgba);     // copies width * height * 4 bytes
+
+    glm::vec4 sample(const glm::vec2 &texCoord, SoftFilter filter) const;
+
+    int getWidth()  const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    int width, height;
+    std::vector<unsigned char> texels;
+
+    glm::vec4 texel(int x, int y) const;
+};
+
+// Interpolated fragment inputs (the outputs of vertexShader.vs, plus texture coordinates)
+struct SoftFragment
+{
+    glm::vec3 position;             // world space (FragPos)
+    glm::vec3 normal;               // world space, not normalized (Normal)
+    glm::vec2 texCoord;
+};
+
+// lightingFragS.fs (without the shadowed sun) as a functor. The texture, if any, multiplies objectColor.
+struct PhongShading
+{
+    glm::vec3 objectColor = glm::vec3(1.0f);
+    glm::vec3 lightColor  = glm::vec3(1.0f);
+    glm::vec3 lightPos    = glm::vec3(0.0f);
+    glm::vec3 camPos      = glm::vec3(0.0f);
+    const SoftTexture *texture = nullptr;
+    SoftFilter filter = SOFT_BILINEAR;
+
+    glm::vec3 operator()(const SoftFragment &fragment) const;
+};
+
+// CPU rendering backend for machines without GPU. It covers what the examples use from OpenGL: indexed and non indexed
+// triangle lists, depth test (GL_LESS), perspective correct interpolation and a fragment shader written as a functor.
+//  - draw(): vertex stage, near plane clipping, triangle setup and binning into screen tiles. Big draws are split in
+//    ranges of triangles set up on several threads; each range keeps its own bins, so the submission order is kept.
+//  - finish(): threads take tiles from a shared counter and rasterize each tile's bins in order. Edge functions are
+//    evaluated for 4 pixels at a time (SSE2 if available) and pixel centers follow the top-left fill rule.
+// The color buffer is RGBA8 with the bottom row first, like glReadPixels.
+class SoftRasterizer
+{
+public:
+    struct Stats
+    {
+        size_t triangles;           // submitted
+        size_t trianglesSetUp;      // after clipping and culling
+        size_t binEntries;          // triangle-tile pairs
+        size_t pixelsShaded;        // fragments that passed the depth test
+        double setupTime;           // ms in draw() (vertex stage, setup, binning)
+        double rasterTime;          // ms in finish()
+    };
+
+    SoftRasterizer(int width, int height, unsigned threads = 0, int tileSize = 64);     // threads 0: hardware_concurrency
+
+    void clear(const glm::vec3 &color);                         // color and depth (1.0); resets the stats
+    void setCamera(const glm::mat4 &view, const glm::mat4 &projection);
+    void setCullBackFaces(bool cull) { cullBackFaces = cull; }  // counter-clockwise triangles are front faces
+
+    // Queue triangles (indices: count indices, or nullptr: count vertices). FragmentShader: glm::vec3 operator()(const
+    // SoftFragment &) const, which must stay alive until finish().
+    template<class FragmentShader>
+    void draw(const VertexInput &vertices, const unsigned *indices, size_t count, const glm::mat4 &model, const FragmentShader &shader)
+    {
+        submit(vertices, indices, count, model, &shader,
+               [](const void *s, const SoftFragment &fragment) { return (*(const FragmentShader *)s)(fragment); });
+    }
+
+    void finish();                                              // Rasterize everything drawn since the last finish()
+
+    const std::vector<uint32_t> &getColor() const { return color; }
+    bool savePPM(const std::string &path) const;
+
+    const Stats &getStats() const { return stats; }
+    int getWidth()  const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    typedef glm::vec3 (*ShadeFunction)(const void *shader, const SoftFragment &fragment);
+
+    enum { NUM_VARYINGS = 8 };              // position (3), normal (3), texture coordinates (2)
+
+    struct Vertex
+    {
+        glm::vec4 clip;
+        float     varyings[NUM_VARYINGS];
+    };
+
+    struct Triangle                         // E(x, y) = a x + b y + c for the edges, planes for the interpolated values
+    {
+        float    edgeA[3], edgeB[3], edgeC[3];
+        bool     topLeft[3];                // pixel centers exactly on the edge are inside
+        float    depth[3];                  // window depth plane
+        float    invW[3];                   // 1 / w plane
+        float    varyings[NUM_VARYINGS][3]; // varying / w planes
+        int      minX, minY, maxX, maxY;
+        unsigned draw;
+    };
+
+    struct Batch                            // triangles of one draw range, binned per tile
+    {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<unsigned>> bins;
+    };
+
+    struct Draw
+    {
+        const void   *shader;
+        ShadeFunction shade;
+    };
+
+    int       width, height, tileSize, tilesX, tilesY;
+    unsigned  numThreads;
+    bool      cullBackFaces;
+    glm::mat4 viewProjection;
+
+    std::vector<uint32_t> color;
+    std::vector<float>    depth;
+    std::vector<Draw>     draws;
+    std::vector<Batch>    batches;
+    std::vector<Vertex>   vertexCache;
+    Stats     stats;
+
+    void submit(const VertexInput &vertices, const unsigned *indices, size_t count, const glm::mat4 &model,
+                const void *shader, ShadeFunction shade);
+    void setupRange(const unsigned *indices, size_t firstTriangle, size_t lastTriangle, unsigned draw, Batch &batch) const;
+    void setupTriangle(const Vertex &v0, const Vertex &v1, const Vertex &v2, unsigned draw, Batch &batch) const;
+    void rasterizeTile(unsigned tile, size_t &pixelsShaded);
+};
+
+#endif
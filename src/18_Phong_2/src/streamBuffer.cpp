@@ -0,0 +1,131 @@
+#include "streamBuffer.hpp"
+#include "glState.hpp"
+#include "gpuMemory.hpp"
+
+#include <chrono>
+#include <iostream>
+
+StreamBuffer::StreamBuffer(size_t regionSize, unsigned numRegions, bool allowPersistent)
+    : regionSize(regionSize), numRegions(numRegions), persistent(false), mapped(nullptr),
+      fences(numRegions, nullptr), currentRegion(0), head(0), flushed(0), ID(0), waitTime(0), bytesWritten(0)
+{
+    glGenBuffers(1, &ID);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLAD
+    persistent = allowPersistent && GLAD_GL_VERSION_4_4;
+#elif IMGUI_IMPL_OPENGL_LOADER_GLEW
+    persistent = allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+#endif
+
+    if(persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gpuMemory.bufferStorage(ID, GL_COPY_WRITE_BUFFER, regionSize * numRegions, nullptr, flags, "stream buffer");
+        mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * numRegions, flags);
+
+        if(!mapped)
+        {
+            std::cout << "StreamBuffer: persistent mapping failed, using glBufferSubData" << std::endl;
+            glDeleteBuffers(1, &ID);
+            glState.deletedBuffer(ID);
+            gpuMemory.deletedBuffer(ID);
+            glGenBuffers(1, &ID);
+            glState.bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            persistent = false;
+        }
+    }
+
+    if(!persistent)
+    {
+        this->numRegions = 1;           // the driver does the buffering when the storage is orphaned
+        fences.assign(1, nullptr);
+        staging.resize(regionSize);
+        gpuMemory.bufferData(ID, GL_COPY_WRITE_BUFFER, regionSize, nullptr, GL_STREAM_DRAW, "stream buffer");
+    }
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for(GLsync fence : fences)
+        if(fence) glDeleteSync(fence);
+
+    if(mapped)
+    {
+        glState.bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+
+    glDeleteBuffers(1, &ID);
+    glState.deletedBuffer(ID);
+    gpuMemory.deletedBuffer(ID);
+}
+
+void StreamBuffer::beginFrame()
+{
+    head = flushed = 0;
+    bytesWritten = 0;
+    waitTime = 0;
+
+    if(persistent)
+    {
+        GLsync &fence = fences[currentRegion];
+        if(!fence) return;
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while(result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);     // 1 ms steps
+        if(result == GL_WAIT_FAILED)
+            std::cout << "StreamBuffer: glClientWaitSync failed" << std::endl;
+
+        glDeleteSync(fence);
+        fence = nullptr;
+
+        waitTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1e9;
+    }
+    else
+    {
+        glState.bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        gpuMemory.bufferData(ID, GL_COPY_WRITE_BUFFER, regionSize, nullptr, GL_STREAM_DRAW, "stream buffer");     // orphan: the GPU keeps reading the old storage
+    }
+}
+
+void *StreamBuffer::allocate(size_t size, size_t &offset, size_t alignment)
+{
+    size_t start = (head + alignment - 1) / alignment * alignment;
+    if(start + size > regionSize) return nullptr;
+
+    head = start + size;
+    bytesWritten += size;
+
+    if(persistent)
+    {
+        offset = currentRegion * regionSize + start;
+        return mapped + offset;
+    }
+
+    offset = start;
+    return staging.data() + start;
+}
+
+void StreamBuffer::flush()
+{
+    if(persistent || head == flushed) return;       // coherent mapping: writes are visible without flushing
+
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, flushed, head - flushed, staging.data() + flushed);
+    flushed = head;
+}
+
+void StreamBuffer::endFrame()
+{
+    flush();
+
+    if(persistent)
+    {
+        fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        currentRegion = (currentRegion + 1) % numRegions;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+
+#include <cstddef>
+#include <vector>
+
+// Buffer for data rewritten every frame (dynamic vertices, per-frame uniforms...). It is split into numRegions frame
+// regions: the CPU writes one region while the GPU reads the previous ones, and each region is fenced (glFenceSync)
+// so it is not overwritten before the GPU finishes with it.
+//  - GL 4.4+: a single glBufferStorage allocation, persistently and coherently mapped (no map/unmap, no copies).
+//  - GL 3.3: the region is staged in CPU memory and uploaded with glBufferSubData after orphaning the buffer.
+// The buffer is updated through GL_COPY_WRITE_BUFFER (via glState), so it never disturbs the VAO or ARRAY_BUFFER bindings.
+// Usage per frame: beginFrame(), allocate() + write + flush() (as many times as needed), draw, endFrame().
+class StreamBuffer
+{
+    size_t   regionSize;
+    unsigned numRegions;
+    bool     persistent;
+
+    unsigned char       *mapped;        // persistent path: whole buffer
+    std::vector<unsigned char> staging; // fallback path: current region
+    std::vector<GLsync>  fences;        // one per region
+
+    unsigned currentRegion;
+    size_t   head;                      // bytes used in the current region
+    size_t   flushed;                   // bytes of the current region already uploaded (fallback path)
+
+public:
+    StreamBuffer(size_t regionSize, unsigned numRegions = 3, bool allowPersistent = true);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    unsigned ID;
+
+    void  beginFrame();                     // Waits (if needed) until the GPU is done with the region to write
+    void *allocate(size_t size, size_t &offset, size_t alignment = 16);    // offset: from the buffer start (for draws/attrib pointers). nullptr if the region is full.
+    void  flush();                          // Makes the data written since the last flush visible to the GPU
+    void  endFrame();                       // Fences the region and advances to the next one
+
+    bool   isPersistent()  const { return persistent; }
+    size_t getRegionSize() const { return regionSize; }
+
+    // Statistics of the last frame
+    double waitTime;                        // seconds blocked in beginFrame() waiting for a fence
+    size_t bytesWritten;
+};
+
+#endif
@@ -0,0 +1,234 @@
+#include "vertexFormat.hpp"
+#include "shader.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/packing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ----- Encoding helpers ---------------
+
+namespace
+{
+
+inline uint32_t packSnorm10(float value)
+{
+    int v = (int)std::round(glm::clamp(value, -1.0f, 1.0f) * 511.0f);
+    return (uint32_t)v & 0x3FF;
+}
+
+inline float unpackSnorm10(uint32_t bits)
+{
+    int v = (int)(bits & 0x3FF);
+    if(v & 0x200) v -= 0x400;                   // sign extension
+    return std::max(v / 511.0f, -1.0f);
+}
+
+} // anonymous namespace end
+
+uint32_t packOctahedral2_10_10_10(const glm::vec3 &normal)
+{
+    // Project onto the octahedron |x|+|y|+|z| = 1 and fold the lower hemisphere over the upper one
+    glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) + 1e-20f);
+    glm::vec2 oct(n.x, n.y);
+    if(n.z < 0.0f)
+    {
+        oct.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        oct.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    return packSnorm10(oct.x) | (packSnorm10(oct.y) << 10);     // z and w fields unused
+}
+
+glm::vec3 unpackOctahedral2_10_10_10(uint32_t packed)
+{
+    glm::vec2 oct(unpackSnorm10(packed), unpackSnorm10(packed >> 10));
+    glm::vec3 n(oct.x, oct.y, 1.0f - std::abs(oct.x) - std::abs(oct.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+// ----- PackedVertices ---------------
+
+PackedVertices::PackedVertices()
+    : stride(0), positionOffset(-1), normalOffset(-1), texCoordOffset(-1), dequantization(1.0f) { }
+
+PackedVertices::PackedVertices(const VertexInput &input, const VertexFormat &vertexFormat) : PackedVertices()
+{
+    compile(input, vertexFormat);
+}
+
+void PackedVertices::computeDequantization(const VertexInput &input)
+{
+    glm::vec3 minBound(1e30f), maxBound(-1e30f);
+    for(size_t i = 0; i < input.numVertices; ++i)
+    {
+        const float *p = input.data + i * input.stride + input.positionOffset;
+        minBound = glm::min(minBound, glm::vec3(p[0], p[1], p[2]));
+        maxBound = glm::max(maxBound, glm::vec3(p[0], p[1], p[2]));
+    }
+    if(input.numVertices == 0) minBound = maxBound = glm::vec3(0.0f);
+
+    glm::vec3 extent = glm::max(maxBound - minBound, glm::vec3(1e-20f));
+    dequantization = glm::scale(glm::translate(glm::mat4(1.0f), minBound), extent);
+}
+
+void PackedVertices::compile(const VertexInput &input, const VertexFormat &vertexFormat)
+{
+    format = vertexFormat;
+
+    // Layout (every attribute 4-byte aligned)
+    stride = 0;
+    positionOffset = normalOffset = texCoordOffset = -1;
+
+    positionOffset = stride;
+    stride += format.position == ATTRIB_UNORM16 ? 4 * sizeof(uint16_t) : 3 * sizeof(float);   // 4th ushort is padding
+
+    if(input.normalOffset >= 0)
+    {
+        normalOffset = stride;
+        stride += format.normal == ATTRIB_OCT_2_10_10_10 ? sizeof(uint32_t) : 3 * sizeof(float);
+    }
+
+    if(input.texCoordOffset >= 0)
+    {
+        texCoordOffset = stride;
+        stride += format.texCoord == ATTRIB_HALF ? 2 * sizeof(uint16_t) : 2 * sizeof(float);
+    }
+
+    if(format.position == ATTRIB_UNORM16) computeDequantization(input);
+    else dequantization = glm::mat4(1.0f);
+
+    glm::mat4 quantization = glm::inverse(dequantization);
+
+    // Encode
+    data.assign(input.numVertices * stride, 0);
+
+    for(size_t i = 0; i < input.numVertices; ++i)
+    {
+        const float *src = input.data + i * input.stride;
+        uint8_t *dst = data.data() + i * stride;
+
+        const float *p = src + input.positionOffset;
+        if(format.position == ATTRIB_UNORM16)
+        {
+            glm::vec3 q = glm::vec3(quantization * glm::vec4(p[0], p[1], p[2], 1.0f));
+            uint16_t packed[4] = { 0, 0, 0, 0 };
+            for(int k = 0; k < 3; ++k)
+                packed[k] = (uint16_t)std::round(glm::clamp(q[k], 0.0f, 1.0f) * 65535.0f);
+            std::memcpy(dst + positionOffset, packed, sizeof(packed));
+        }
+        else std::memcpy(dst + positionOffset, p, 3 * sizeof(float));
+
+        if(normalOffset >= 0)
+        {
+            const float *n = src + input.normalOffset;
+            if(format.normal == ATTRIB_OCT_2_10_10_10)
+            {
+                uint32_t packed = packOctahedral2_10_10_10(glm::vec3(n[0], n[1], n[2]));
+                std::memcpy(dst + normalOffset, &packed, sizeof(packed));
+            }
+            else std::memcpy(dst + normalOffset, n, 3 * sizeof(float));
+        }
+
+        if(texCoordOffset >= 0)
+        {
+            const float *t = src + input.texCoordOffset;
+            if(format.texCoord == ATTRIB_HALF)
+            {
+                uint16_t packed[2] = { glm::packHalf1x16(t[0]), glm::packHalf1x16(t[1]) };
+                std::memcpy(dst + texCoordOffset, packed, sizeof(packed));
+            }
+            else std::memcpy(dst + texCoordOffset, t, 2 * sizeof(float));
+        }
+    }
+}
+
+void PackedVertices::setupAttributes() const
+{
+    if(format.position == ATTRIB_UNORM16)
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void *)(size_t)positionOffset);
+    else
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)(size_t)positionOffset);
+    glEnableVertexAttribArray(0);
+
+    if(normalOffset >= 0)
+    {
+        if(format.normal == ATTRIB_OCT_2_10_10_10)
+            glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void *)(size_t)normalOffset);
+        else
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void *)(size_t)normalOffset);
+        glEnableVertexAttribArray(3);
+    }
+
+    if(texCoordOffset >= 0)
+    {
+        if(format.texCoord == ATTRIB_HALF)
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void *)(size_t)texCoordOffset);
+        else
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *)(size_t)texCoordOffset);
+        glEnableVertexAttribArray(2);
+    }
+}
+
+std::vector<uint8_t> PackedVertices::positionStream() const
+{
+    size_t positionSize = format.position == ATTRIB_UNORM16 ? 3 * sizeof(uint16_t) : 3 * sizeof(float);
+    size_t numVertices = stride ? data.size() / stride : 0;
+
+    std::vector<uint8_t> positions(numVertices * positionSize);
+    for(size_t v = 0; v < numVertices; ++v)
+        std::memcpy(&positions[v * positionSize], &data[v * stride + positionOffset], positionSize);
+    return positions;
+}
+
+void PackedVertices::setupPositionAttribute() const
+{
+    if(format.position == ATTRIB_UNORM16)
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 3 * sizeof(uint16_t), (void *)nullptr);
+    else
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)nullptr);
+    glEnableVertexAttribArray(0);
+}
+
+std::string PackedVertices::shaderPrelude() const
+{
+    std::string code;
+
+    if(format.position == ATTRIB_UNORM16)
+        code += "layout (location = 0) in vec3 aPosQ;\n"
+                "uniform mat4 posDequant;\n"
+                "vec3 decodePosition() { return vec3(posDequant * vec4(aPosQ, 1.0)); }\n";
+    else
+        code += "layout (location = 0) in vec3 aPos;\n"
+                "vec3 decodePosition() { return aPos; }\n";
+
+    if(format.normal == ATTRIB_OCT_2_10_10_10)
+        code += "layout (location = 3) in vec4 aNormalOct;\n"
+                "vec3 decodeNormal()\n"
+                "{\n"
+                "    vec3 n = vec3(aNormalOct.xy, 1.0 - abs(aNormalOct.x) - abs(aNormalOct.y));\n"
+                "    float t = max(-n.z, 0.0);\n"
+                "    n.x += n.x >= 0.0 ? -t : t;\n"
+                "    n.y += n.y >= 0.0 ? -t : t;\n"
+                "    return normalize(n);\n"
+                "}\n";
+    else
+        code += "layout (location = 3) in vec3 aNormal;\n"
+                "vec3 decodeNormal() { return aNormal; }\n";
+
+    code += "layout (location = 2) in vec2 aTexCoord;\n"      // half floats are converted by the vertex fetch
+            "vec2 decodeTexCoord() { return aTexCoord; }\n";
+
+    return code;
+}
+
+void PackedVertices::setUniforms(const Shader &program) const
+{
+    if(format.position == ATTRIB_UNORM16)
+        program.setMat4("posDequant", dequantization);
+}
@@ -0,0 +1,78 @@
+#ifndef VERTEXFORMAT_HPP
+#define VERTEXFORMAT_HPP
+
+#ifdef IMGUI_IMPL_OPENGL_LOADER_GLEW
+#include <GL/glew.h>
+#elif IMGUI_IMPL_OPENGL_LOADER_GLAD
+#include <glad/glad.h>
+#endif
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Shader;
+
+// Storage of each vertex attribute
+enum AttribEncoding
+{
+    ATTRIB_FLOAT32,         // 32 bit float per component (default layout of the examples)
+    ATTRIB_UNORM16,         // positions: 16 bit normalized, decoded with a per-mesh dequantization matrix
+    ATTRIB_OCT_2_10_10_10,  // normals: octahedral encoding stored in GL_INT_2_10_10_10_REV
+    ATTRIB_HALF             // texture coordinates: 16 bit float
+};
+
+struct VertexFormat
+{
+    AttribEncoding position = ATTRIB_FLOAT32;
+    AttribEncoding normal   = ATTRIB_FLOAT32;
+    AttribEncoding texCoord = ATTRIB_FLOAT32;
+
+    static VertexFormat floats()  { return VertexFormat(); }
+    static VertexFormat packed()  { return { ATTRIB_UNORM16, ATTRIB_OCT_2_10_10_10, ATTRIB_HALF }; }
+};
+
+// Float vertex data as used by the examples (e.g. 6 floats: position + normal; 5 floats: position + texture coords).
+// Offsets are in floats; -1 means the attribute is not present.
+struct VertexInput
+{
+    const float *data;
+    size_t       numVertices;
+    unsigned     stride;            // floats per vertex
+    int          positionOffset = 0;
+    int          normalOffset   = -1;
+    int          texCoordOffset = -1;
+};
+
+// Vertex data compiled to a given VertexFormat. Attribute locations follow the examples: position 0, texture coords 2, normal 3.
+class PackedVertices
+{
+    void computeDequantization(const VertexInput &input);
+
+public:
+    VertexFormat         format;
+    std::vector<uint8_t> data;
+    unsigned             stride;                            // bytes per vertex
+    int                  positionOffset, normalOffset, texCoordOffset;   // bytes; -1 if absent
+    glm::mat4            dequantization;                    // maps quantized [0,1] positions to object space (identity for floats)
+
+    PackedVertices();
+    PackedVertices(const VertexInput &input, const VertexFormat &vertexFormat);
+
+    void compile(const VertexInput &input, const VertexFormat &vertexFormat);
+
+    void        setupAttributes() const;                    // glVertexAttribPointer calls for the bound VAO and VBO
+    std::string shaderPrelude() const;                      // GLSL inputs + decodePosition(), decodeNormal(), decodeTexCoord()
+    void        setUniforms(const Shader &program) const;   // Uniforms needed by shaderPrelude()
+
+    // Position-only stream (depth-only passes fetch 6 or 12 bytes per vertex instead of the whole vertex)
+    std::vector<uint8_t> positionStream() const;            // the positions of data, tightly packed
+    void        setupPositionAttribute() const;             // glVertexAttribPointer for a VBO holding positionStream()
+};
+
+// Encoding helpers
+uint32_t packOctahedral2_10_10_10(const glm::vec3 &normal);
+glm::vec3 unpackOctahedral2_10_10_10(uint32_t packed);
+
+#endif